@@ -0,0 +1,191 @@
+// ============================================================================
+// BENCH_ACCEL : scene accelerators on sphere scenes of growing size
+// ============================================================================
+//
+// Scenes of 1k, 10k, 100k and 1M spheres (or RAYT_BENCH_SPHERES only) of
+// similar radii, spread evenly in a cube, each one a sphere object as
+// main.cpp makes them for --accel. For each accelerator:
+//   build         from the object list (grid, lbvh: on every hardware thread)
+//   first tile    build, then a 32x32 tile of camera rays from outside the
+//                 cube: how long before the first pixels (lazy: the top
+//                 levels and the subtrees the tile reaches); not for the
+//                 linear scan, which has nothing to build
+//   rays          random rays from inside the cube, closest hit, 1 thread
+//   memory        bytes of acceleration data after the rays, per sphere
+// and every ray's hit (t, object id) is checked against the bvh's. The
+// linear scan is the sphere_set of --accel linear (dispatched kernels, own t
+// formula, hence the tolerance); it gets fewer rays on large scenes.
+//
+//     make -f Makefile.bench bench/bench_accel && ./bench/bench_accel
+//
+// ============================================================================
+
+#include "bench_common.hpp"
+#include "core/cpu_dispatch.hpp"
+#include "core/thread_pool.hpp"
+#include "geometry/bvh_accel.hpp"
+#include "geometry/grid_accel.hpp"
+#include "geometry/lazy_bvh_accel.hpp"
+#include "geometry/sphere.hpp"
+#include "geometry/sphere_set.hpp"
+#include "materials/diffuse.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <string>
+
+namespace {
+
+constexpr int repeats = 3;
+constexpr int ray_count = 200000;
+constexpr int tile_size = 32;
+
+// Sphere tests allowed for the linear scan's rays, per size
+constexpr double linear_budget = 2e8;
+
+struct ray_batch {
+    std::vector<vec3> origins, directions;
+};
+
+struct accel_result {
+    std::vector<real> t;
+    std::vector<int> ids;
+};
+
+// Casts the first count rays of the batch, returns the best time and fills result
+double cast(const hittable& accel, const ray_batch& rays, int count, accel_result& result, int times = repeats) {
+    result.t.assign(count, 0);
+    result.ids.assign(count, -1);
+    return bench::best_of(times, [&] {
+        hit_record rec;
+        for (int i = 0; i < count; ++i) {
+            if (accel.hit(rays.origins[i], rays.directions[i], real(1e30), rec)) {
+                result.t[i] = rec.t;
+                result.ids[i] = rec.object_id;
+            }
+        }
+    });
+}
+
+// Same hit, or one at the same distance (the linear kernel rounds differently)
+bool same_hit(const accel_result& a, const accel_result& b, int i) {
+    if (a.ids[i] == b.ids[i] && a.t[i] == b.t[i]) return true;
+    return a.ids[i] >= 0 && b.ids[i] >= 0 && std::abs(a.t[i] - b.t[i]) <= real(1e-3) * std::max(a.t[i], real(1));
+}
+
+void run(const std::string& name, const std::vector<std::shared_ptr<hittable>>& objects, const ray_batch& rays,
+         int count, const ray_batch& tile,
+         const std::function<std::shared_ptr<hittable>(std::vector<std::shared_ptr<hittable>>)>& make,
+         const std::function<std::size_t(const hittable&)>& bytes, const accel_result* reference,
+         accel_result& result) {
+    std::shared_ptr<hittable> accel;
+    const double build_ms = bench::best_of(repeats, [&] { accel = make(objects); });
+    bench::report(name + ": build", build_ms, objects.size());
+
+    if (!tile.origins.empty()) {
+        accel_result tile_result;
+        const double tile_ms = bench::best_of(repeats, [&] {
+            std::shared_ptr<hittable> fresh = make(objects);
+            cast(*fresh, tile, tile_size * tile_size, tile_result, 1);
+        });
+        std::printf("  %-36s %10.3f ms\n", (name + ": first tile").c_str(), tile_ms);
+    }
+
+    const double ray_ms = cast(*accel, rays, count, result);
+    long hits = 0, mismatches = 0;
+    for (int i = 0; i < count; ++i) {
+        hits += result.ids[i] >= 0;
+        if (reference && !same_hit(result, *reference, i)) ++mismatches;
+    }
+    std::printf("  %-36s %10.3f ms  %8.2f Mrays/s (%d rays, %ld hits, %ld differ)\n", (name + ": rays").c_str(),
+                ray_ms, count / (ray_ms * 1e3), count, hits, mismatches);
+    if (bytes) {
+        std::printf("  %-36s %10.1f MB  %8.2f bytes per sphere\n", (name + ": memory").c_str(),
+                    bytes(*accel) / 1048576.0, double(bytes(*accel)) / objects.size());
+    }
+}
+
+void run_size(int count, thread_pool& pool) {
+    // One sphere per unit cell: a ray travels about 8 units before a hit
+    const real side = real(std::cbrt(double(count)));
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<real> along(0, side), radius(real(0.1), real(0.3)), unit(-1, 1);
+    auto mat = std::make_shared<diffuse>(vec3(0.5, 0.5, 0.5));
+    std::vector<std::shared_ptr<hittable>> objects;
+    objects.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        auto s = std::make_shared<sphere>(vec3(along(gen), along(gen), along(gen)), radius(gen), mat);
+        s->object_id = i;
+        objects.push_back(s);
+    }
+    ray_batch rays;
+    for (int i = 0; i < ray_count; ++i) {
+        rays.origins.push_back(vec3(along(gen), along(gen), along(gen)));
+        rays.directions.push_back(vec3(unit(gen), unit(gen), unit(gen)).normalize());
+    }
+
+    // Central tile of a 1024x1024 view of the cube's front face, from outside
+    ray_batch tile;
+    const vec3 eye(side / 2, side / 2, -side);
+    for (int y = 0; y < tile_size; ++y) {
+        for (int x = 0; x < tile_size; ++x) {
+            const real u = (real(512 - tile_size / 2 + x) + real(0.5)) / 1024, v = (real(512 - tile_size / 2 + y) + real(0.5)) / 1024;
+            tile.origins.push_back(eye);
+            tile.directions.push_back((vec3(u * side, v * side, 0) - eye).normalize());
+        }
+    }
+
+    std::printf("%d spheres\n", count);
+    auto node_bytes = [](const hittable& accel) { return static_cast<const bvh_accel&>(accel).node_memory_bytes(); };
+    accel_result full, other;
+    run("bvh", objects, rays, ray_count, tile, [](auto list) { return std::make_shared<bvh_accel>(std::move(list)); },
+        node_bytes, nullptr, full);
+    run("bvh, quantized nodes", objects, rays, ray_count, tile,
+        [](auto list) { return std::make_shared<bvh_accel>(std::move(list), true); }, node_bytes, &full, other);
+    for (int bits : {30, 63}) {
+        for (int rounds : {0, 2}) {
+            const std::string name = "lbvh, " + std::to_string(bits) + "-bit" + (rounds ? ", treelets x" + std::to_string(rounds) : "");
+            run(name, objects, rays, ray_count, tile,
+                [&](auto list) { return std::make_shared<bvh_accel>(std::move(list), pool, bits, rounds); }, node_bytes,
+                &full, other);
+        }
+    }
+    run("lazy bvh", objects, rays, ray_count, tile,
+        [](auto list) { return std::make_shared<lazy_bvh_accel>(std::move(list)); },
+        [](const hittable& accel) { return static_cast<const lazy_bvh_accel&>(accel).node_memory_bytes(); }, &full,
+        other);
+    run("grid", objects, rays, ray_count, tile,
+        [&](auto list) { return std::make_shared<grid_accel>(std::move(list), pool); },
+        [](const hittable& accel) { return static_cast<const grid_accel&>(accel).memory_bytes(); }, &full, other);
+
+    const int linear_rays = static_cast<int>(std::clamp(linear_budget / count, 100.0, double(ray_count)));
+    run("linear (sphere_set)", objects, rays, linear_rays, ray_batch{},
+        [](const std::vector<std::shared_ptr<hittable>>& list) {
+            auto set = std::make_shared<sphere_set>();
+            for (const std::shared_ptr<hittable>& object : list) {
+                const sphere& s = static_cast<const sphere&>(*object);
+                set->add(s.origin, s.radius, s.mat, s.object_id);
+            }
+            return set;
+        },
+        nullptr, &full, other);
+    std::printf("\n");
+}
+
+} // namespace
+
+int main() {
+    const char* spheres_env = std::getenv("RAYT_BENCH_SPHERES");
+    std::vector<int> sizes = {1000, 10000, 100000, 1000000};
+    if (spheres_env) sizes = {std::atoi(spheres_env)};
+
+    select_kernels(isa::automatic);
+    thread_pool pool;
+    std::printf("accelerators, %d rays, best of %d, grid and lbvh built on %d threads (ns/op = per sphere for builds)\n\n",
+                ray_count, repeats, pool.size());
+    for (int count : sizes) run_size(count, pool);
+    return 0;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+// Minimal timing helpers shared by the micro-benchmarks in bench/
+namespace bench {
+
+// Keep a value alive so the optimizer cannot drop the work producing it
+template <typename T>
+inline void do_not_optimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Run fn() 'repeats' times and return the best wall time in milliseconds
+template <typename Fn>
+double best_of(int repeats, Fn&& fn) {
+    double best = 1e300;
+    for (int i = 0; i < repeats; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto end = std::chrono::steady_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        if (ms < best) best = ms;
+    }
+    return best;
+}
+
+inline void report(const std::string& name, double ms, double ops) {
+    std::printf("  %-36s %10.3f ms  %8.2f ns/op\n", name.c_str(), ms, ms * 1e6 / ops);
+}
+
+} // namespace bench
@@ -0,0 +1,142 @@
+// ============================================================================
+// BENCH_DENOISE : box blur and bilateral filters cost at 4K
+// ============================================================================
+//
+// Sweeps radius 1..16 on a 3840x2160 frame. denoise::box_blur (running sums)
+// should stay flat; the original (2r+1)^2 window ("before") grows with r^2 and
+// is only run up to radius 4 to keep the sweep short.
+//
+// Then the bilateral filter for the editor's strengths (sigma_space 1..3).
+// The original per-pixel version takes minutes at sigma 3, so "before" runs
+// at sigma 1 only. The bilateral grid runs on the same linear HDR frame (flat
+// regions, a gradient, an emissive strip and noise) and its output is compared
+// to the exact filter as a PSNR in their shared v / (1 + v) range metric;
+// larger sigmas show its cost does not grow. Filters use every hardware
+// thread; set RAYT_BENCH_THREADS to pin the count.
+//
+//     make -f Makefile.bench bench/bench_denoise && ./bench/bench_denoise
+//
+// ============================================================================
+
+#include "bench_common.hpp"
+#include "legacy_denoise.hpp"
+#include "core/cpu_dispatch.hpp"
+#include "core/denoise.hpp"
+#include "core/thread_pool.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int width = 3840;
+constexpr int height = 2160;
+constexpr int repeats = 3;
+constexpr int legacy_max_radius = 4;
+constexpr float sigma_color = 0.1f;
+
+// Two color regions split at mid-width, a brighter lower part, a gradient, an
+// emissive strip well above 1 at the bottom left and gaussian noise growing
+// with the value: edges the bilateral filters should keep
+std::vector<vec3> make_edge_frame() {
+    std::mt19937 gen(7);
+    std::normal_distribution<float> noise(0.0f, 0.05f);
+    std::vector<vec3> frame(static_cast<std::size_t>(width) * height);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            float side = x > width / 2 ? 0.7f : 0.1f;
+            float lower = y > height / 3 ? 0.3f : 0.0f;
+            float ramp = 0.2f * x / width;
+            float emissive = y > 3 * height / 4 && x < width / 4 ? 6.0f : 0.0f;
+            float gain = 1.0f + emissive;
+            frame[static_cast<std::size_t>(y) * width + x] =
+                vec3(side + ramp + emissive + gain * noise(gen), 0.2f + lower + gain * noise(gen),
+                     0.5f * side + lower + emissive + gain * noise(gen));
+        }
+    }
+    return frame;
+}
+
+// Range metric of the bilateral filters (core/denoise.hpp), in [0, 1)
+double compress(double v) {
+    return v / (1.0 + std::abs(v));
+}
+
+// PSNR of b against a, both compressed by the range metric
+double psnr(const std::vector<vec3>& a, const std::vector<vec3>& b) {
+    double error = 0.0;
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        double dx = compress(a[i].x) - compress(b[i].x);
+        double dy = compress(a[i].y) - compress(b[i].y);
+        double dz = compress(a[i].z) - compress(b[i].z);
+        error += dx * dx + dy * dy + dz * dz;
+    }
+    return 10.0 * std::log10(3.0 * a.size() / error);
+}
+
+} // namespace
+
+int main() {
+    select_kernels(isa::automatic);
+
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+    std::vector<vec3> pixels(static_cast<std::size_t>(width) * height);
+    for (vec3& p : pixels) p = vec3(dist(gen), dist(gen), dist(gen));
+    const double pixel_count = double(width) * height;
+
+    const char* threads_env = std::getenv("RAYT_BENCH_THREADS");
+    thread_pool pool(threads_env ? std::atoi(threads_env) : 0);
+    denoise::workspace scratch;
+    std::vector<vec3> out;
+
+    std::printf("box blur, %dx%d, %d threads, best of %d (ns/op = per pixel)\n\n",
+                width, height, pool.size(), repeats);
+    for (int radius = 1; radius <= 16; ++radius) {
+        double ms = bench::best_of(repeats, [&] {
+            out = pixels;
+            denoise::box_blur(out, width, height, radius, pool, scratch);
+            bench::do_not_optimize(out[out.size() / 2]);
+        });
+        bench::report("after: running sums, r = " + std::to_string(radius), ms, pixel_count);
+
+        if (radius <= legacy_max_radius) {
+            double legacy_ms = bench::best_of(1, [&] {
+                std::vector<vec3> result = legacy::box_blur(pixels, width, height, radius);
+                bench::do_not_optimize(result[result.size() / 2]);
+            });
+            bench::report("before: full window, r = " + std::to_string(radius), legacy_ms, pixel_count);
+        }
+    }
+
+    const std::vector<vec3> frame = make_edge_frame();
+    std::vector<vec3> exact;
+    std::printf("\nbilateral filter, sigma_color = %g\n\n", sigma_color);
+    for (int sigma = 1; sigma <= 16; sigma = sigma < 3 ? sigma + 1 : sigma * 2) {
+        if (sigma <= 3) {
+            double ms = bench::best_of(1, [&] {
+                exact = frame;
+                denoise::bilateral_filter(exact, width, height, float(sigma), sigma_color, pool, scratch);
+                bench::do_not_optimize(exact[exact.size() / 2]);
+            });
+            bench::report("after: float planes, sigma = " + std::to_string(sigma), ms, pixel_count);
+        }
+
+        double grid_ms = bench::best_of(repeats, [&] {
+            out = frame;
+            denoise::bilateral_grid(out, width, height, float(sigma), sigma_color, pool, scratch);
+            bench::do_not_optimize(out[out.size() / 2]);
+        });
+        bench::report("grid, sigma = " + std::to_string(sigma), grid_ms, pixel_count);
+        if (sigma <= 3) std::printf("  %-36s %10.2f dB\n", "grid PSNR against exact", psnr(exact, out));
+    }
+    double legacy_ms = bench::best_of(1, [&] {
+        std::vector<vec3> result = legacy::bilateral_filter(frame, width, height, 1.0f, sigma_color);
+        bench::do_not_optimize(result[result.size() / 2]);
+    });
+    bench::report("before: per pixel, sigma = 1", legacy_ms, pixel_count);
+    return 0;
+}
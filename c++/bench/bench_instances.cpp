@@ -0,0 +1,129 @@
+// ============================================================================
+// BENCH_INSTANCES : two-level acceleration, 1M instances of a 10k-triangle mesh
+// ============================================================================
+//
+// One UV sphere of about 10k triangles (its own BVH, the bottom level) is
+// placed RAYT_BENCH_INSTANCES times (default 1M) with random positions,
+// rotations about y and scales, then:
+//   build         instance_set: inverse matrices, boxes, top-level BVH
+//   memory        geometry + instances + top level, against the same
+//                 scene with every copy flattened into its own mesh (at the
+//                 mesh's bytes per triangle)
+//   rays          random rays through the field, closest hit
+//   check         rays aimed at instance centers from outside the field:
+//                 the hit distance must match a direct test of that one
+//                 instance's sphere
+//
+//     make -f Makefile.bench bench/bench_instances && ./bench/bench_instances
+//
+// ============================================================================
+
+#include "bench_common.hpp"
+#include "geometry/instance_set.hpp"
+#include "geometry/triangle_mesh.hpp"
+#include "materials/diffuse.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+namespace {
+
+constexpr int repeats = 3;
+constexpr int ray_count = 200000;
+
+// Unit UV sphere of 2 * rings * (segments - 1) triangles, counter-clockwise
+// seen from outside
+std::shared_ptr<triangle_mesh> make_sphere(int rings, int segments) {
+    const double pi = 3.14159265358979323846;
+    std::vector<real> positions;
+    for (int r = 0; r <= rings; ++r) {
+        const double theta = pi * r / rings;
+        for (int s = 0; s < segments; ++s) {
+            const double phi = 2 * pi * s / segments;
+            positions.push_back(real(std::sin(theta) * std::cos(phi)));
+            positions.push_back(real(std::cos(theta)));
+            positions.push_back(real(std::sin(theta) * std::sin(phi)));
+        }
+    }
+    std::vector<std::uint32_t> indices;
+    for (int r = 0; r < rings; ++r) {
+        for (int s = 0; s < segments; ++s) {
+            const std::uint32_t a = r * segments + s, b = r * segments + (s + 1) % segments;
+            const std::uint32_t c = a + segments, d = b + segments;
+            if (r > 0) indices.insert(indices.end(), {a, b, c});
+            if (r < rings - 1) indices.insert(indices.end(), {b, d, c});
+        }
+    }
+    return std::make_shared<triangle_mesh>(std::move(positions), std::move(indices), nullptr);
+}
+
+} // namespace
+
+int main() {
+    const char* instances_env = std::getenv("RAYT_BENCH_INSTANCES");
+    const int count = instances_env ? std::atoi(instances_env) : 1000000;
+    std::shared_ptr<triangle_mesh> ball = make_sphere(71, 71);
+    auto mat = std::make_shared<diffuse>(vec3(0.5, 0.5, 0.5));
+
+    // Instances in a cube whose side keeps the density constant
+    const real side = real(4 * std::cbrt(double(count)));
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<real> along(0, side), angle(0, 360), size(real(0.3), real(1.2));
+    std::vector<vec3> centers(count);
+    std::vector<real> scales(count);
+    std::vector<affine> transforms(count);
+    for (int i = 0; i < count; ++i) {
+        centers[i] = vec3(along(gen), along(gen), along(gen));
+        scales[i] = size(gen);
+        transforms[i] = affine::from_trs(centers[i], angle(gen), scales[i]);
+    }
+
+    std::printf("instances, %d of a %zu-triangle mesh, best of %d (ns/op = per instance, per ray for rays)\n\n",
+                count, ball->triangle_count(), repeats);
+    std::shared_ptr<instance_set> scene;
+    double build_ms = bench::best_of(repeats, [&] {
+        scene = std::make_shared<instance_set>();
+        for (int i = 0; i < count; ++i) scene->add(ball, transforms[i], mat, i);
+        scene->build();
+    });
+    bench::report("build (add + top level)", build_ms, count);
+
+    const double geometry_mb = ball->memory_bytes() / 1048576.0;
+    const double instance_mb = scene->memory_bytes() / 1048576.0;
+    const double flattened_mb = double(ball->memory_bytes()) * count / 1048576.0;
+    std::printf("  %-36s %10.1f MB (mesh %.2f MB, instances and top level %.1f MB)\n", "memory",
+                geometry_mb + instance_mb, geometry_mb, instance_mb);
+    std::printf("  %-36s %10.1f MB (%.0fx)\n", "memory if flattened", flattened_mb,
+                flattened_mb / (geometry_mb + instance_mb));
+
+    std::uniform_real_distribution<real> unit(-1, 1);
+    std::vector<vec3> origins(ray_count), directions(ray_count);
+    for (int i = 0; i < ray_count; ++i) {
+        origins[i] = vec3(along(gen), along(gen), along(gen));
+        directions[i] = vec3(unit(gen), unit(gen), unit(gen)).normalize();
+    }
+    long hits = 0;
+    double ray_ms = bench::best_of(repeats, [&] {
+        hits = 0;
+        hit_record rec;
+        for (int i = 0; i < ray_count; ++i) hits += scene->hit(origins[i], directions[i], real(1e30), rec);
+    });
+    bench::report("rays, 1 thread (" + std::to_string(hits) + " hits)", ray_ms, ray_count);
+
+    // From above the field down onto an instance: the first hit is that
+    // instance or one in front of it, never farther than the direct test
+    long checked = 0, wrong = 0;
+    hit_record rec, direct;
+    for (int i = 0; i < count; i += std::max(1, count / 10000)) {
+        const vec3 origin(centers[i].x, side + 10, centers[i].z);
+        const vec3 direction(0, -1, 0);
+        const affine inverse = transforms[i].inverse();
+        if (!ball->hit(inverse.point(origin), inverse.vector(direction), real(1e30), direct)) continue;
+        ++checked;
+        if (!scene->hit(origin, direction, real(1e30), rec) || rec.t > direct.t * real(1.0001)) ++wrong;
+    }
+    std::printf("  %-36s %10ld of %ld rays wrong\n", "check (aimed at instances)", wrong, checked);
+    return 0;
+}
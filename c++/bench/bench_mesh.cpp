@@ -0,0 +1,139 @@
+// ============================================================================
+// BENCH_MESH : OBJ import, BVH build and ray casts on a 1M-triangle mesh
+// ============================================================================
+//
+// Writes a height field of RAYT_BENCH_TRIANGLES triangles (default 1M, as
+// quads split by the loader) to the temporary directory, then measures:
+//   load_obj      one pool thread, then every hardware thread
+//   build         triangle_mesh: boxes, binned SAH BVH, triangle reorder
+//   memory        bytes per triangle (vertices, indices, nodes)
+//   rays          random rays from above into the field, closest hit
+//   watertight    rays aimed exactly at the grid's vertices and edge
+//                 midpoints of a flat field, where a test that is not
+//                 watertight lets some rays through: all must hit
+//
+//     make -f Makefile.bench bench/bench_mesh && ./bench/bench_mesh
+//
+// ============================================================================
+
+#include "bench_common.hpp"
+#include "core/thread_pool.hpp"
+#include "geometry/obj_loader.hpp"
+#include "geometry/triangle_mesh.hpp"
+#include "materials/diffuse.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <thread>
+
+namespace {
+
+constexpr int repeats = 3;
+constexpr int ray_count = 1000000;
+
+// Quads of a columns x rows grid over [0, columns] x [0, rows], heights from
+// height(x, z)
+template <typename Height>
+void write_field(const std::string& path, int columns, int rows, Height&& height) {
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) return;
+    std::fprintf(file, "# height field %dx%d\no field\n", columns, rows);
+    for (int z = 0; z <= rows; ++z) {
+        for (int x = 0; x <= columns; ++x) std::fprintf(file, "v %d %.6f %d\n", x, height(x, z), z);
+    }
+    for (int z = 0; z < rows; ++z) {
+        for (int x = 0; x < columns; ++x) {
+            const int a = z * (columns + 1) + x + 1;
+            std::fprintf(file, "f %d %d %d %d\n", a, a + columns + 1, a + columns + 2, a + 1);
+        }
+    }
+    std::fclose(file);
+}
+
+std::shared_ptr<triangle_mesh> load_mesh(const std::string& path, thread_pool& pool) {
+    obj_mesh geometry;
+    std::string error;
+    if (!load_obj(path, geometry, pool, error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        std::exit(1);
+    }
+    return std::make_shared<triangle_mesh>(std::move(geometry.positions), std::move(geometry.indices),
+                                           std::make_shared<diffuse>(vec3(0.5, 0.5, 0.5)));
+}
+
+} // namespace
+
+int main() {
+    const char* triangles_env = std::getenv("RAYT_BENCH_TRIANGLES");
+    const int triangles = triangles_env ? std::atoi(triangles_env) : 1000000;
+    const int columns = static_cast<int>(std::sqrt(triangles));
+    const int rows = std::max(1, triangles / (2 * columns));
+    const std::filesystem::path dir = std::filesystem::temp_directory_path();
+    const std::string field_path = (dir / "rayt_bench_field.obj").string();
+    const std::string flat_path = (dir / "rayt_bench_flat.obj").string();
+    write_field(field_path, columns, rows, [](int x, int z) { return 4.0 * std::sin(x * 0.05) * std::cos(z * 0.07); });
+    write_field(flat_path, 256, 256, [](int, int) { return 0.0; });
+
+    const int hardware = std::max(1u, std::thread::hardware_concurrency());
+    std::printf("mesh, %d triangles, best of %d (ns/op = per triangle, per ray for rays)\n\n", 2 * columns * rows, repeats);
+    thread_pool single(1), pool(hardware);
+    obj_mesh geometry;
+    std::string error;
+    for (thread_pool* p : {&single, &pool}) {
+        double ms = bench::best_of(repeats, [&] {
+            load_obj(field_path, geometry, *p, error);
+            bench::do_not_optimize(geometry.indices.back());
+        });
+        bench::report("load_obj, " + std::to_string(p->size()) + " threads", ms, geometry.indices.size() / 3.0);
+    }
+
+    std::shared_ptr<triangle_mesh> mesh;
+    double build_ms = bench::best_of(repeats, [&] {
+        obj_mesh copy = geometry;
+        mesh = std::make_shared<triangle_mesh>(std::move(copy.positions), std::move(copy.indices),
+                                               std::make_shared<diffuse>(vec3(0.5, 0.5, 0.5)));
+    });
+    bench::report("build (with a copy of the buffers)", build_ms, mesh->triangle_count());
+    std::printf("  %-36s %10.1f bytes per triangle (%zu vertices)\n", "memory",
+                double(mesh->memory_bytes()) / mesh->triangle_count(), mesh->vertex_count());
+
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<real> along_x(0, real(columns)), along_z(0, real(rows)), tilt(-0.3f, 0.3f);
+    std::vector<vec3> origins(ray_count), directions(ray_count);
+    for (int i = 0; i < ray_count; ++i) {
+        origins[i] = vec3(along_x(gen), 20, along_z(gen));
+        directions[i] = vec3(tilt(gen), -1, tilt(gen)).normalize();
+    }
+    long hits = 0;
+    double ray_ms = bench::best_of(repeats, [&] {
+        hits = 0;
+        hit_record rec;
+        for (int i = 0; i < ray_count; ++i) hits += mesh->hit(origins[i], directions[i], real(1e30), rec);
+    });
+    bench::report("rays, 1 thread (" + std::to_string(hits) + " hits)", ray_ms, ray_count);
+
+    // Through vertices and edge midpoints, straight and slanted
+    std::shared_ptr<triangle_mesh> flat = load_mesh(flat_path, single);
+    long aimed = 0, missed = 0;
+    hit_record rec;
+    for (int z = 1; z < 256; ++z) {
+        for (int x = 1; x < 256; ++x) {
+            for (const vec3& target : {vec3(real(x), 0, real(z)), vec3(x + real(0.5), 0, real(z)),
+                                       vec3(real(x), 0, z + real(0.5)), vec3(x + real(0.5), 0, z + real(0.5))}) {
+                for (const vec3& from : {vec3(0, 10, 0), vec3(real(0.37), 10, real(-0.61)), vec3(7, 3, -2)}) {
+                    const vec3 origin = target + from;
+                    ++aimed;
+                    missed += !flat->hit(origin, (target - origin).normalize(), real(1e30), rec);
+                }
+            }
+        }
+    }
+    std::printf("  %-36s %10ld of %ld rays missed\n", "watertight (flat 256x256)", missed, aimed);
+
+    std::filesystem::remove(field_path);
+    std::filesystem::remove(flat_path);
+    return 0;
+}
@@ -0,0 +1,213 @@
+// ============================================================================
+// BENCH_SCENE_LOAD : JSON scene (DOM, SAX) vs binary scene (.rscn), 1M spheres
+// ============================================================================
+//
+// Writes a scene of RAYT_BENCH_OBJECTS spheres (default 1M, 64 materials) in
+// the format of the editor to the temporary directory, converts it with
+// save_scene_binary and times:
+//   json dom     the text read whole and parsed into a nlohmann::json tree
+//                (what the loader did before it streamed)
+//   json sax     load_scene: tokens streamed into the record arrays
+//   binary       load_scene on the .rscn file, mapped
+// The mapped file is only read when touched, so "load + walk" also sums the
+// sphere radii: that is what the renderer does next when it builds its
+// objects. Each loader runs in its own process so that its peak resident
+// memory (getrusage) is its own. Files are read from the page cache.
+//
+// The same spheres are then split in 8 parts listed by a manifest (JSON
+// parts, then binary parts), loaded one after the other (threads = 1) and
+// on the hardware threads (threads = 0).
+//
+//     make -f Makefile.bench bench/bench_scene_load && ./bench/bench_scene_load
+//
+// ============================================================================
+
+#include "bench_common.hpp"
+#include "core/scene_desc.hpp"
+#include "../external/nlohmann/json.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr int repeats = 3;
+constexpr int material_count = 64;
+const char* const material_names[] = {"Diffus", "Métal", "Verre", "Miroir"};
+
+constexpr int part_count = 8;
+
+void write_json_scene(const std::string& path, int object_count) {
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) return;
+    std::fprintf(file, "{\n \"camera\": {\"aperture\": 0.0, \"aspect_ratio\": 1.777, \"focus_distance\": 10.0, \"fov\": 45.0,\n"
+                       "  \"look_at\": {\"x\": 0.0, \"y\": 0.0, \"z\": 0.0}, \"origin\": {\"x\": 0.0, \"y\": 50.0, \"z\": 200.0},\n"
+                       "  \"up\": {\"x\": 0.0, \"y\": 1.0, \"z\": 0.0}},\n"
+                       " \"render\": {\"image_width\": 400, \"image_height\": 225, \"samples_per_pixel\": 16, \"max_depth\": 10,\n"
+                       "  \"num_threads\": 0, \"gamma\": 2.2, \"sun_intensity\": 1.0},\n"
+                       " \"objects\": [\n");
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> radius(0.05f, 0.5f);
+    std::uniform_int_distribution<int> material(0, material_count - 1);
+    for (int i = 0; i < object_count; ++i) {
+        const int m = material(gen);
+        const float x = position(gen), y = position(gen), z = position(gen), r = radius(gen);
+        std::fprintf(file,
+                     "  {\"type\": \"Sphère\", \"name\": \"Sphère %d\", \"position\": {\"x\": %.4f, \"y\": %.4f, \"z\": %.4f},"
+                     " \"color\": {\"r\": %.3f, \"g\": %.3f, \"b\": %.3f}, \"size\": %.4f, \"material\": \"%s\"}%s\n",
+                     i, x, y, z, (m % 4) / 3.0, (m / 4 % 4) / 3.0, (m / 16) / 3.0, r, material_names[m % 4],
+                     i + 1 < object_count ? "," : "");
+    }
+    std::fprintf(file, " ],\n \"lights\": []\n}\n");
+    std::fclose(file);
+}
+
+void write_manifest(const std::string& path, const std::vector<std::string>& parts) {
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) return;
+    std::fprintf(file, "{\n \"camera\": {\"fov\": 45.0, \"aspect_ratio\": 1.777,\n"
+                       "  \"look_at\": {\"x\": 0.0, \"y\": 0.0, \"z\": 0.0}, \"origin\": {\"x\": 0.0, \"y\": 50.0, \"z\": 200.0},\n"
+                       "  \"up\": {\"x\": 0.0, \"y\": 1.0, \"z\": 0.0}},\n"
+                       " \"render\": {\"image_width\": 400, \"image_height\": 225, \"samples_per_pixel\": 16, \"max_depth\": 10,\n"
+                       "  \"num_threads\": 0, \"gamma\": 2.2},\n"
+                       " \"parts\": [\n");
+    for (std::size_t i = 0; i < parts.size(); ++i) {
+        std::fprintf(file, "  {\"file\": \"%s\", \"translate\": {\"x\": %d, \"y\": 0, \"z\": 0}}%s\n", parts[i].c_str(),
+                     int(i) * 250, i + 1 < parts.size() ? "," : "");
+    }
+    std::fprintf(file, " ]\n}\n");
+    std::fclose(file);
+}
+
+// What the renderer reads next: every object record
+double walk(const scene_desc& desc) {
+    double sum = 0.0;
+    for (const object_record& object : desc.objects) sum += object.size + desc.materials[object.material].parameter;
+    return sum;
+}
+
+// The loader before streaming: whole text, then a tree, then the arrays
+// (only counted here, so this is a lower bound of its cost)
+std::size_t load_dom(const std::string& path) {
+    std::ifstream file(path);
+    std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    nlohmann::json scene = nlohmann::json::parse(text);
+    return scene["objects"].size();
+}
+
+double peak_rss_mb() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0;   // Kilobytes on Linux
+}
+
+// Runs fn in a child process and waits for it: the child's peak RSS is that of fn
+template <typename Fn>
+void in_child(Fn&& fn) {
+    std::fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        fn();
+        std::fflush(stdout);
+        _exit(0);
+    }
+    waitpid(pid, nullptr, 0);
+}
+
+} // namespace
+
+int main() {
+    const char* objects_env = std::getenv("RAYT_BENCH_OBJECTS");
+    const int object_count = objects_env ? std::atoi(objects_env) : 1000000;
+    const std::filesystem::path dir = std::filesystem::temp_directory_path();
+    const std::string json_path = (dir / "rayt_bench_scene.json").string();
+    const std::string binary_path = (dir / "rayt_bench_scene.rscn").string();
+
+    write_json_scene(json_path, object_count);
+    std::string error;
+    {
+        scene_desc desc;
+        if (!load_scene(json_path, desc, error) || !save_scene_binary(binary_path, desc)) {
+            std::fprintf(stderr, "scene setup failed: %s\n", error.c_str());
+            return 1;
+        }
+    }
+    std::printf("scene load, %d spheres, best of %d (ns/op = per object)\n", object_count, repeats);
+    std::printf("  %-36s %10.1f MB\n", "json file", std::filesystem::file_size(json_path) / 1e6);
+    std::printf("  %-36s %10.1f MB\n", "binary file", std::filesystem::file_size(binary_path) / 1e6);
+    std::printf("  %-36s %10.1f MB\n\n", "records in memory",
+                (sizeof(object_record) * double(object_count) + sizeof(material_record) * material_count) / 1e6);
+
+    in_child([&] {
+        double ms = bench::best_of(repeats, [&] { bench::do_not_optimize(load_dom(json_path)); });
+        bench::report("json dom: parse", ms, object_count);
+        std::printf("  %-36s %10.1f MB\n", "json dom: peak rss", peak_rss_mb());
+    });
+    struct variant { const char* name; const std::string& path; };
+    for (const variant& v : {variant{"json sax", json_path}, variant{"binary", binary_path}}) {
+        in_child([&] {
+            const std::string name = v.name;
+            double load_ms = bench::best_of(repeats, [&] {
+                scene_desc desc;
+                load_scene(v.path, desc, error);
+                bench::do_not_optimize(desc.objects.size);
+            });
+            bench::report(name + ": load", load_ms, object_count);
+            double walk_ms = bench::best_of(repeats, [&] {
+                scene_desc desc;
+                load_scene(v.path, desc, error);
+                bench::do_not_optimize(walk(desc));
+            });
+            bench::report(name + ": load + walk", walk_ms, object_count);
+            std::printf("  %-36s %10.1f MB\n", (name + ": peak rss").c_str(), peak_rss_mb());
+        });
+    }
+
+    // Manifests of parts, written next to them (paths are relative)
+    std::vector<std::string> json_parts, binary_parts, files;
+    for (int i = 0; i < part_count; ++i) {
+        json_parts.push_back("rayt_bench_part" + std::to_string(i) + ".json");
+        binary_parts.push_back("rayt_bench_part" + std::to_string(i) + ".rscn");
+        const std::string json_part = (dir / json_parts.back()).string();
+        write_json_scene(json_part, object_count / part_count);
+        scene_desc part;
+        load_scene(json_part, part, error);
+        save_scene_binary((dir / binary_parts.back()).string(), part);
+        files.push_back(json_part);
+        files.push_back((dir / binary_parts.back()).string());
+    }
+    const std::string json_manifest = (dir / "rayt_bench_manifest_json.json").string();
+    const std::string binary_manifest = (dir / "rayt_bench_manifest_rscn.json").string();
+    write_manifest(json_manifest, json_parts);
+    write_manifest(binary_manifest, binary_parts);
+    files.push_back(json_manifest);
+    files.push_back(binary_manifest);
+
+    std::printf("\nmanifest of %d parts, %d threads\n", part_count, static_cast<int>(std::thread::hardware_concurrency()));
+    for (const std::string& manifest : {json_manifest, binary_manifest}) {
+        const std::string name = manifest == json_manifest ? "json parts" : "binary parts";
+        for (int threads : {1, 0}) {
+            double ms = bench::best_of(repeats, [&] {
+                scene_desc desc;
+                load_scene(manifest, desc, error, threads);
+                bench::do_not_optimize(desc.objects.size);
+            });
+            bench::report(name + (threads == 1 ? ": sequential" : ": parallel"), ms, object_count);
+        }
+    }
+
+    for (const std::string& file : files) std::filesystem::remove(file);
+    std::filesystem::remove(json_path);
+    std::filesystem::remove(binary_path);
+    return 0;
+}
@@ -0,0 +1,108 @@
+// ============================================================================
+// BENCH_TONEMAP : exposure + ACES + gamma + 8-bit quantization at 8K
+// ============================================================================
+//
+// The output stage of the post-processing pipeline on a 7680x4320 linear
+// frame (log-normal values, most of them below 1 with a long bright tail).
+// "before" is the tonemap kernel (one pow per channel) followed by
+// image_io::quantize; "after" is the table kernel (tonemap_quantize), for
+// every instruction set the CPU supports, then through post::pipeline with
+// the work split in bands over the pool. The table is built once per
+// exposure and gamma; its build time is printed apart. Bytes are compared
+// to "before": the curve is not monotonic at the last ulp near a few
+// thresholds, so a handful of channels land one step away.
+//
+//     make -f Makefile.bench bench/bench_tonemap && ./bench/bench_tonemap
+//
+// ============================================================================
+
+#include "bench_common.hpp"
+#include "core/cpu_dispatch.hpp"
+#include "core/image_io.hpp"
+#include "core/post_process.hpp"
+#include "core/thread_pool.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int width = 7680;
+constexpr int height = 4320;
+constexpr int repeats = 3;
+constexpr float exposure = 1.0f;
+constexpr float display_gamma = 2.2f;
+
+// Channels of b that differ from a, and the largest difference
+void compare(const std::vector<std::uint8_t>& a, const std::vector<std::uint8_t>& b) {
+    std::size_t differ = 0;
+    int largest = 0;
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        int d = std::abs(int(a[i]) - int(b[i]));
+        if (d == 0) continue;
+        ++differ;
+        if (d > largest) largest = d;
+    }
+    std::printf("  %-36s %10zu of %zu channels, max %d\n", "differ from before", differ, a.size(), largest);
+}
+
+} // namespace
+
+int main() {
+    select_kernels(isa::automatic);
+
+    std::mt19937 gen(42);
+    std::lognormal_distribution<float> dist(-1.0f, 1.5f);
+    std::vector<vec3> pixels(static_cast<std::size_t>(width) * height);
+    for (vec3& p : pixels) p = vec3(dist(gen), dist(gen), dist(gen));
+    const std::size_t stride = sizeof(vec3) / sizeof(real);
+    const double pixel_count = double(width) * height;
+
+    const char* threads_env = std::getenv("RAYT_BENCH_THREADS");
+    thread_pool pool(threads_env ? std::atoi(threads_env) : 0);
+
+    std::printf("tonemap + quantize, %dx%d, best of %d (ns/op = per pixel)\n\n", width, height, repeats);
+
+    // Single thread, whole frame
+    std::vector<vec3> mapped(pixels.size());
+    std::vector<std::uint8_t> before(pixels.size() * 3), after(pixels.size() * 3);
+    double before_ms = bench::best_of(repeats, [&] {
+        kernels().tonemap(reinterpret_cast<const real*>(pixels.data()), reinterpret_cast<real*>(mapped.data()),
+                          pixels.size() * stride, exposure, 1.0f / display_gamma);
+        image_io::quantize(mapped.data(), mapped.size(), before.data());
+        bench::do_not_optimize(before[before.size() / 2]);
+    });
+    bench::report("before: pow + quantize, 1 thread", before_ms, pixel_count);
+
+    // The pipeline builds the table on its first run
+    post::pipeline output;
+    output.exposure(exposure).tonemap().gamma(display_gamma).quantize();
+    std::vector<vec3> small(16);
+    std::vector<std::uint8_t> small_rgb;
+    thread_pool single(1);
+    auto start = std::chrono::steady_clock::now();
+    output.run(small, 4, 4, single, small_rgb);
+    double build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::printf("  %-36s %10.3f ms\n", "table build", build_ms);
+
+    for (isa level : {isa::baseline, isa::sse42, isa::avx2, isa::avx512}) {
+        if (select_kernels(level) != level) continue;
+        double ms = bench::best_of(repeats, [&] {
+            output.run(pixels, width, height, single, after);
+            bench::do_not_optimize(after[after.size() / 2]);
+        });
+        bench::report(std::string("after: table, 1 thread, ") + isa_name(level), ms, pixel_count);
+    }
+    select_kernels(isa::automatic);
+    compare(before, after);
+
+    double pool_ms = bench::best_of(repeats, [&] {
+        output.run(pixels, width, height, pool, after);
+        bench::do_not_optimize(after[after.size() / 2]);
+    });
+    bench::report("after: table, " + std::to_string(pool.size()) + " threads", pool_ms, pixel_count);
+    return 0;
+}
@@ -0,0 +1,116 @@
+// ============================================================================
+// BENCH_VEC3 : micro-benchmarks of the hot vector operations
+// ============================================================================
+//
+// Compares the legacy out-of-line double vec3 ("before") with the header-only
+// vec3 of core/vec3.hpp ("after"). Build the SSE-backed variant with
+// -DRAYT_VEC3_SSE and the double reference with -DRAYT_USE_DOUBLE:
+//
+//     make -f Makefile.bench bench_vec3
+//     make -f Makefile.bench bench_vec3 BENCH_FLAGS=-DRAYT_VEC3_SSE
+//
+// ============================================================================
+
+#include "bench_common.hpp"
+#include "legacy_vec3.hpp"
+#include "core/vec3.hpp"
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr int count = 1 << 14;   // Fits in L2: measures compute, not memory
+constexpr int rounds = 200;
+constexpr int repeats = 5;
+
+template <typename V>
+struct inputs {
+    std::vector<V> a, b, out;
+    std::vector<double> radius;
+};
+
+template <typename V>
+inputs<V> make_inputs() {
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<double> dist(-10.0, 10.0);
+    inputs<V> in;
+    for (int i = 0; i < count; ++i) {
+        in.a.emplace_back(dist(gen), dist(gen), dist(gen));
+        in.b.emplace_back(dist(gen), dist(gen), dist(gen));
+        in.radius.push_back(std::abs(dist(gen)) * 0.1 + 0.1);
+    }
+    in.out.resize(count);
+    return in;
+}
+
+template <typename V, typename Op>
+void run_map(const char* label, inputs<V>& in, Op op) {
+    double ms = bench::best_of(repeats, [&] {
+        for (int r = 0; r < rounds; ++r) {
+            for (int i = 0; i < count; ++i) in.out[i] = op(in.a[i], in.b[i]);
+            bench::do_not_optimize(in.out[r % count]);
+        }
+    });
+    bench::report(label, ms, double(count) * rounds);
+}
+
+template <typename V, typename Op>
+void run_reduce(const char* label, inputs<V>& in, Op op) {
+    double ms = bench::best_of(repeats, [&] {
+        double sum = 0.0;
+        for (int r = 0; r < rounds; ++r) {
+            for (int i = 0; i < count; ++i) sum += op(in.a[i], in.b[i], in.radius[i]);
+        }
+        bench::do_not_optimize(sum);
+    });
+    bench::report(label, ms, double(count) * rounds);
+}
+
+// Ray-sphere discriminant as in sphere::hit, the tracer's hottest expression
+template <typename V>
+double sphere_discriminant(const V& center, const V& dir, double radius) {
+    V origin(0.5, 1.0, -2.0);
+    V oc = origin - center;
+    auto half_b = oc.dot(dir);
+    auto c = oc.dot(oc) - radius * radius;
+    return (half_b * half_b - dir.dot(dir) * c) > 0 ? 1.0 : 0.0;
+}
+
+template <typename V, typename NormalizeFast>
+void run_suite(const char* title, NormalizeFast normalize_fast) {
+    std::printf("%s (sizeof = %zu)\n", title, sizeof(V));
+    inputs<V> in = make_inputs<V>();
+    run_map<V>("add", in, [](const V& a, const V& b) { return a + b; });
+    run_map<V>("sub", in, [](const V& a, const V& b) { return a - b; });
+    run_map<V>("mul (scalar)", in, [](const V& a, const V&) { return a * 0.5; });
+    run_map<V>("mul (vec3)", in, [](const V& a, const V& b) { return a * b; });
+    run_map<V>("cross", in, [](const V& a, const V& b) { return a.cross(b); });
+    run_map<V>("normalize", in, [](const V& a, const V&) { return a.normalize(); });
+    run_map<V>("normalize_fast", in, [&](const V& a, const V&) { return normalize_fast(a); });
+    run_map<V>("madd (a * 0.5 + b)", in, [](const V& a, const V& b) { return a * 0.5 + b; });
+    run_reduce<V>("dot", in, [](const V& a, const V& b, double) { return double(a.dot(b)); });
+    run_reduce<V>("sphere discriminant", in, [](const V& a, const V& b, double r) {
+        return sphere_discriminant(a, b, r);
+    });
+    std::printf("\n");
+}
+
+} // namespace
+
+int main() {
+    std::printf("vec3 micro-benchmarks: %d vectors x %d rounds, best of %d\n\n", count, rounds, repeats);
+
+    run_suite<legacy::vec3>("before: out-of-line double vec3",
+        [](const legacy::vec3& a) { return a.normalize(); });
+
+#if defined(RAYT_VEC3_SIMD)
+    const char* title = "after: header-only vec3, SSE float";
+#elif defined(RAYT_USE_DOUBLE)
+    const char* title = "after: header-only vec3, double";
+#else
+    const char* title = "after: header-only vec3, float";
+#endif
+    run_suite<vec3>(title, [](const vec3& a) { return a.normalize_fast(); });
+    return 0;
+}
@@ -0,0 +1,71 @@
+#include "legacy_denoise.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace legacy {
+
+static vec3 get_pixel_safe(const std::vector<vec3>& pixels, int width, int height, int x, int y) {
+    x = std::clamp(x, 0, width - 1);
+    y = std::clamp(y, 0, height - 1);
+    return pixels[y * width + x];
+}
+
+std::vector<vec3> box_blur(const std::vector<vec3>& pixels, int width, int height, int radius) {
+    std::vector<vec3> result(pixels.size());
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            vec3 sum(0, 0, 0);
+            int count = 0;
+
+            for (int dy = -radius; dy <= radius; ++dy) {
+                for (int dx = -radius; dx <= radius; ++dx) {
+                    vec3 pixel = get_pixel_safe(pixels, width, height, x + dx, y + dy);
+                    sum = sum + pixel;
+                    count++;
+                }
+            }
+
+            result[y * width + x] = sum / static_cast<real>(count);
+        }
+    }
+
+    return result;
+}
+
+std::vector<vec3> bilateral_filter(const std::vector<vec3>& pixels, int width, int height,
+                                   float sigma_space, float sigma_color) {
+    std::vector<vec3> result(pixels.size());
+    int radius = static_cast<int>(std::ceil(3.0f * sigma_space));
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            vec3 center_pixel = pixels[y * width + x];
+            vec3 sum(0, 0, 0);
+            float weight_sum = 0.0f;
+
+            for (int dy = -radius; dy <= radius; ++dy) {
+                for (int dx = -radius; dx <= radius; ++dx) {
+                    vec3 neighbor = get_pixel_safe(pixels, width, height, x + dx, y + dy);
+
+                    float spatial_dist = std::sqrt(dx * dx + dy * dy);
+                    float spatial_weight = std::exp(-(spatial_dist * spatial_dist) / (2.0f * sigma_space * sigma_space));
+
+                    vec3 color_diff = neighbor - center_pixel;
+                    float color_dist = std::sqrt(color_diff.length_squared());
+                    float color_weight = std::exp(-(color_dist * color_dist) / (2.0f * sigma_color * sigma_color));
+
+                    float total_weight = spatial_weight * color_weight;
+                    sum = sum + neighbor * total_weight;
+                    weight_sum += total_weight;
+                }
+            }
+
+            result[y * width + x] = sum / weight_sum;
+        }
+    }
+
+    return result;
+}
+
+} // namespace legacy
@@ -0,0 +1,14 @@
+#pragma once
+#include "core/vec3.hpp"
+#include <vector>
+
+// Copies of the original box blur and bilateral filter: a full (2r+1)^2
+// window per pixel with a clamped fetch and (bilateral) two std::exp on every
+// tap, one thread. Kept as the reference for bench_denoise.
+namespace legacy {
+
+std::vector<vec3> box_blur(const std::vector<vec3>& pixels, int width, int height, int radius);
+std::vector<vec3> bilateral_filter(const std::vector<vec3>& pixels, int width, int height,
+                                   float sigma_space, float sigma_color);
+
+} // namespace legacy
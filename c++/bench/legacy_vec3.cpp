@@ -0,0 +1,56 @@
+#include "legacy_vec3.hpp"
+#include <cmath>
+
+namespace legacy {
+
+vec3::vec3() : x(0.0), y(0.0), z(0.0) {}
+
+vec3::vec3(double x, double y, double z) : x(x), y(y), z(z) {}
+
+double vec3::dot(const vec3& other) const {
+    return this->x * other.x + this->y * other.y + this->z * other.z;
+}
+
+double vec3::length_squared() const {
+    return this->dot(*this);
+}
+
+vec3 vec3::normalize() const {
+    double length = std::sqrt(this->length_squared());
+    if (length == 0.0) return vec3(0.0, 0.0, 0.0);
+    return vec3(this->x / length, this->y / length, this->z / length);
+}
+
+vec3 vec3::cross(const vec3& other) const {
+    return vec3(
+        this->y * other.z - this->z * other.y,
+        this->z * other.x - this->x * other.z,
+        this->x * other.y - this->y * other.x
+    );
+}
+
+vec3 vec3::operator+(const vec3& other) const {
+    return vec3(this->x + other.x, this->y + other.y, this->z + other.z);
+}
+
+vec3 vec3::operator-(const vec3& other) const {
+    return vec3(this->x - other.x, this->y - other.y, this->z - other.z);
+}
+
+vec3 vec3::operator/(double div) const {
+    return vec3(this->x / div, this->y / div, this->z / div);
+}
+
+vec3 vec3::operator*(double mul) const {
+    return vec3(this->x * mul, this->y * mul, this->z * mul);
+}
+
+vec3 vec3::operator*(vec3 mul) const {
+    return vec3(this->x * mul.x, this->y * mul.y, this->z * mul.z);
+}
+
+vec3 vec3::operator+(double constant) const {
+    return vec3(this->x + constant, this->y + constant, this->z + constant);
+}
+
+} // namespace legacy
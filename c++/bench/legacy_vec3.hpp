@@ -0,0 +1,28 @@
+#pragma once
+
+// Copy of the original out-of-line double vec3 (before core/vec3.hpp became
+// header-only). Compiled in its own translation unit so bench_vec3 measures
+// the call overhead the tracer used to pay without LTO.
+namespace legacy {
+
+class vec3 {
+public:
+    double x, y, z;
+
+    vec3();
+    vec3(double x, double y, double z);
+
+    double length_squared() const;
+    vec3 normalize() const;
+    double dot(const vec3& other) const;
+    vec3 cross(const vec3& other) const;
+
+    vec3 operator+(const vec3& other) const;
+    vec3 operator-(const vec3& other) const;
+    vec3 operator/(double div) const;
+    vec3 operator*(double mul) const;
+    vec3 operator*(vec3 mul) const;
+    vec3 operator+(double constant) const;
+};
+
+} // namespace legacy
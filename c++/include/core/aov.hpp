@@ -0,0 +1,101 @@
+#pragma once
+#include "core/vec3.hpp"
+#include "core/denoise.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// AOV : tampons auxiliaires du premier impact
+// ============================================================================
+//
+// Arbitrary output variables: what the camera ray met at its first hit,
+// averaged over the samples of a pixel like the color. Unlike the color they
+// are almost free of noise, so denoisers can find edges in them.
+//
+//   albedo       base color of the material (black where the ray escapes)
+//   normal       unit shading normal, world space (zero where the ray escapes)
+//   depth        distance from the camera along the ray (0 where it escapes)
+//   object_id    index of the object in the scene file (-1 where it escapes)
+//   material_id  materials with the same description share an id (-1 likewise)
+//   variance     sample variance of the luminance of the color samples
+//   specular     fraction of the samples whose first surface is a perfect
+//                mirror or glass
+//
+// Ids cannot be averaged: they come from the first sample of the pixel.
+// Perfect mirrors and glass show another surface, which the shading buffers
+// follow: albedo, normal and depth then come from the first surface that is
+// not perfectly specular (albedo times the tints of the bounces, depth along
+// the whole path), as external denoisers expect. The à-trous denoiser leaves
+// those pixels out: a mirror here also takes direct light on its own surface,
+// which the guides of the reflected surface do not describe.
+//
+// ============================================================================
+
+class thread_pool;
+
+// First-hit values of one camera ray, filled by ray_color()
+struct first_hit {
+    vec3 albedo;
+    vec3 normal;
+    real depth = 0;
+    int object_id = -1;
+    int material_id = -1;
+    bool specular = false;          // The first surface is a perfect mirror or glass
+    bool through_specular = false;  // ray_color() is following a mirror or glass bounce
+};
+
+namespace aov {
+
+// Floats per pixel in the accumulation buffer: sums of albedo (3), normal (3),
+// depth and luminance squared, object and material id of sample 0, then the
+// count of samples with a specular first surface
+constexpr int accum_channels = 11;
+
+// Add one sample (its first hit and its color) to the accumulator of a pixel
+inline void accumulate(float* pixel, const first_hit& hit, const vec3& color, bool first_sample) {
+    const float luminance = static_cast<float>(0.2126 * color.x + 0.7152 * color.y + 0.0722 * color.z);
+    pixel[0] += static_cast<float>(hit.albedo.x);
+    pixel[1] += static_cast<float>(hit.albedo.y);
+    pixel[2] += static_cast<float>(hit.albedo.z);
+    pixel[3] += static_cast<float>(hit.normal.x);
+    pixel[4] += static_cast<float>(hit.normal.y);
+    pixel[5] += static_cast<float>(hit.normal.z);
+    pixel[6] += static_cast<float>(hit.depth);
+    pixel[7] += luminance * luminance;
+    if (first_sample) {
+        pixel[8] = static_cast<float>(hit.object_id);
+        pixel[9] = static_cast<float>(hit.material_id);
+    }
+    pixel[10] += hit.specular ? 1.0f : 0.0f;
+}
+
+// Resolved buffers of a frame, one float plane per channel, top row first
+struct frame {
+    denoise::image_planes albedo;
+    denoise::image_planes normal;
+    std::vector<float> depth;
+    std::vector<float> object_id;
+    std::vector<float> material_id;
+    std::vector<float> variance;
+    std::vector<float> specular;
+
+    void resize(int width, int height);
+};
+
+// Resolve count pixels into out, starting at pixel index first_pixel of the
+// frame. accum holds accum_channels floats per pixel, color_sum the 3 color
+// sums and samples the sample count of the same pixels.
+void resolve(const float* accum, const float* color_sum, const std::uint32_t* samples,
+             std::size_t first_pixel, std::size_t count, frame& out);
+
+// One float PFM per buffer, named <stem>.albedo.pfm, <stem>.normal.pfm, ...
+// False if a file cannot be written.
+bool write_files(const std::string& stem, const frame& buffers);
+
+// Read the files of write_files back into buffers (resized to width x height).
+// False if a file is missing or does not have this size.
+bool read_files(const std::string& stem, int width, int height, frame& buffers);
+
+} // namespace aov
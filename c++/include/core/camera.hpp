@@ -1,5 +1,6 @@
 #pragma once
 #include "core/vec3.hpp"
+#include "core/random.hpp"
 #include <random>
 
 // Camera class handling viewport setup and ray generation
@@ -10,7 +11,7 @@ public:
     vec3 horizontal;
     vec3 vertical;
     vec3 u, v, w;           // Camera coordinate system
-    double lens_radius;     // For depth of field
+    real lens_radius;       // For depth of field
 
     // Camera constructor with depth of field support
     Camera(
@@ -34,23 +35,23 @@ public:
         v = w.cross(u);                        // Up
 
         origin = lookfrom;
-        horizontal = u * viewport_width * focus_dist;
-        vertical = v * viewport_height * focus_dist;
-        lower_left_corner = origin - horizontal / 2.0 - vertical / 2.0 - w * focus_dist;
+        horizontal = u * real(viewport_width * focus_dist);
+        vertical = v * real(viewport_height * focus_dist);
+        lower_left_corner = origin - horizontal / 2 - vertical / 2 - w * real(focus_dist);
         
-        lens_radius = aperture / 2.0;
+        lens_radius = real(aperture / 2.0);
     }
 
     // Generate a ray for given screen coordinates (u, v in [0, 1])
     // Uses global random generator
-    vec3 get_ray_direction(double s, double t, std::mt19937& gen, std::uniform_real_distribution<double>& dist) const {
+    vec3 get_ray_direction(real s, real t, pcg32& gen, std::uniform_real_distribution<double>& dist) const {
         vec3 rd(0, 0, 0);
         
         // Depth of field: random point on lens
-        if (lens_radius > 0.0) {
+        if (lens_radius > 0) {
             // Random point in unit disk
-            double angle = 2.0 * 3.14159265359 * dist(gen);
-            double radius = lens_radius * std::sqrt(dist(gen));
+            real angle = real(2.0 * 3.14159265359 * dist(gen));
+            real radius = lens_radius * std::sqrt(real(dist(gen)));
             rd = u * (radius * cos(angle)) + v * (radius * sin(angle));
         }
         
@@ -59,10 +60,10 @@ public:
     }
     
     // Get ray origin (with lens offset for depth of field)
-    vec3 get_ray_origin(std::mt19937& gen, std::uniform_real_distribution<double>& dist) const {
-        if (lens_radius > 0.0) {
-            double angle = 2.0 * 3.14159265359 * dist(gen);
-            double radius = lens_radius * std::sqrt(dist(gen));
+    vec3 get_ray_origin(pcg32& gen, std::uniform_real_distribution<double>& dist) const {
+        if (lens_radius > 0) {
+            real angle = real(2.0 * 3.14159265359 * dist(gen));
+            real radius = lens_radius * std::sqrt(real(dist(gen)));
             vec3 rd = u * (radius * cos(angle)) + v * (radius * sin(angle));
             return origin + rd;
         }
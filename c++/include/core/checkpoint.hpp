@@ -0,0 +1,71 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ============================================================================
+// CHECKPOINT : sauvegarde et reprise des rendus longs
+// ============================================================================
+//
+// A checkpoint holds the float accumulation buffer (sum of the samples, RGB
+// per pixel), the number of samples in each pixel and, when AOVs are rendered,
+// their sums (core/aov.hpp), plus what a resumed run must agree on: image
+// size, seed and a hash of the scene file.
+//
+// Files are written to '<path>.tmp' and renamed over '<path>', so a crash
+// during a save leaves the previous checkpoint intact.
+//
+// ============================================================================
+
+struct checkpoint {
+    int width = 0;
+    int height = 0;
+    std::uint64_t seed = 0;
+    std::uint64_t scene_hash = 0;
+    std::vector<float> accum;             // 3 floats per pixel, row 0 at the top
+    std::vector<std::uint32_t> samples;   // Samples accumulated per pixel
+    std::vector<float> aov;               // aov::accum_channels floats per pixel, empty without AOVs
+};
+
+// FNV-1a 64 of the scene file contents. A file read in chunks is hashed by
+// passing the hash of the previous chunks as 'hash'.
+constexpr std::uint64_t scene_hash_seed = 0xcbf29ce484222325ULL;
+std::uint64_t hash_scene(const std::string& contents);
+std::uint64_t hash_scene(const void* contents, std::size_t size, std::uint64_t hash = scene_hash_seed);
+
+bool save_checkpoint(const std::string& path, const checkpoint& state);
+bool load_checkpoint(const std::string& path, checkpoint& state);
+
+// Saves checkpoints on a background thread so rendering does not wait for
+// the disk. If a save is still running when the next one is requested, only
+// the newest pending snapshot is kept.
+class checkpoint_writer {
+public:
+    explicit checkpoint_writer(std::string path);
+    ~checkpoint_writer();  // Finishes the pending save
+
+    checkpoint_writer(const checkpoint_writer&) = delete;
+    checkpoint_writer& operator=(const checkpoint_writer&) = delete;
+
+    void save_async(std::unique_ptr<checkpoint> snapshot);
+
+    // Wait until every requested save is on disk; false if any failed
+    bool wait();
+
+private:
+    void run();
+
+    std::string path;
+    std::unique_ptr<checkpoint> pending;
+    bool busy = false;
+    bool failed = false;
+    bool stopping = false;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::thread worker;
+};
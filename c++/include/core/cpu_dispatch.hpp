@@ -0,0 +1,40 @@
+#pragma once
+#include "core/kernels.hpp"
+#include <string>
+
+// ============================================================================
+// CPU DISPATCH : choix des kernels selon le processeur
+// ============================================================================
+//
+// The Makefiles build with plain -O3 (no -march), so one binary runs on every
+// node of the farm. The hot kernels are compiled in several variants and the
+// widest one the CPU (and OS) supports is selected once at startup via CPUID.
+//
+//     isa chosen = select_kernels(isa::automatic);   // or an --isa override
+//     kernels().hit_spheres(...);
+//
+// ============================================================================
+
+enum class isa {
+    automatic,  // Best supported by this CPU
+    baseline,   // x86-64 SSE2 (or the native baseline on other architectures)
+    sse42,
+    avx2,       // AVX2 + FMA
+    avx512      // AVX-512 F/BW/DQ/VL
+};
+
+// Readable name ("baseline", "sse4.2", "avx2", "avx512", "auto")
+const char* isa_name(isa level);
+
+// Parse an --isa value. Returns false if the name is unknown.
+bool parse_isa(const std::string& name, isa& level);
+
+// Widest instruction set supported by the CPU and enabled by the OS (CPUID + XGETBV)
+isa detect_isa();
+
+// Install the kernel variant for 'requested' (clamped to what the CPU supports)
+// and return the variant actually in use
+isa select_kernels(isa requested);
+
+// Active kernel table (baseline until select_kernels() is called)
+const kernel_table& kernels();
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ============================================================================
+// DEFLATE : compresseur intégré pour l'écriture PNG (RFC 1950/1951)
+// ============================================================================
+//
+// Small self-contained compressor (LZ77 with hash chains + dynamic Huffman
+// blocks), so PNG output needs no external library.
+//
+// compress() can run on independent slices of a stream in parallel: give each
+// slice the 32 KiB that precede it as 'history' and concatenate the outputs.
+// Non-final slices end with an empty stored block (sync flush), so each one is
+// byte-aligned. Checksums of the slices are merged with adler32_combine().
+//
+// ============================================================================
+
+namespace deflate {
+
+// Largest back-reference distance allowed by deflate
+constexpr std::size_t window_size = 32768;
+
+// Raw deflate blocks for data[0, size). history points to the history_size
+// bytes just before data in the stream (only the last window_size are used).
+std::vector<std::uint8_t> compress(const std::uint8_t* data, std::size_t size,
+                                   const std::uint8_t* history, std::size_t history_size,
+                                   bool final);
+
+// zlib checksum, running (start with adler = 1)
+std::uint32_t adler32(const std::uint8_t* data, std::size_t size, std::uint32_t adler = 1);
+
+// Checksum of A followed by B, from adler32(A), adler32(B) and the size of B
+std::uint32_t adler32_combine(std::uint32_t adler_a, std::uint32_t adler_b, std::size_t size_b);
+
+// CRC-32 as used by PNG chunks, running (start with crc = 0)
+std::uint32_t crc32(const std::uint8_t* data, std::size_t size, std::uint32_t crc = 0);
+
+} // namespace deflate
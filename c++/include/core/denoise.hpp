@@ -3,16 +3,86 @@
 #include <vector>
 #include <cmath>
 
-// Simple denoising filters for reducing noise in rendered images
+class thread_pool;
+namespace aov { struct frame; }
+
+// Simple denoising filters for reducing noise in rendered images.
+// They work on float planes (one per channel) with the dispatched kernels,
+// rows in parallel on the render thread pool.
 namespace denoise {
 
-// Apply a simple box blur (fast, ok quality)
-std::vector<vec3> box_blur(const std::vector<vec3>& pixels, int width, int height, int radius = 1);
+// Planar float image, row-major, top row first
+struct image_planes {
+    int width = 0;
+    int height = 0;
+    std::vector<float> channel[3];   // R, G, B
+
+    // Reallocates only when the size grows
+    void resize(int w, int h);
+};
+
+// Scratch memory kept from one call to the next, so repeated filtering does
+// not allocate full-frame temporaries each time
+struct workspace {
+    image_planes image;    // Planar copy of the frame
+    image_planes temp;     // Intermediate pass / padded copy
+    image_planes result;
+    image_planes range;    // Bilateral filter: padded copy in the range metric
+
+    // À-trous filter: demodulated input, variance ping-pong, depth gradient
+    image_planes demodulated;
+    std::vector<float> variance[2];
+    std::vector<float> depth_gradient;
+};
+
+void to_planes(const std::vector<vec3>& pixels, int width, int height, image_planes& planes, thread_pool& pool);
+void from_planes(const image_planes& planes, std::vector<vec3>& pixels, thread_pool& pool);
+
+// Filters on planes. out must not be in; temp and range are scratch.
+void box_blur(const image_planes& in, image_planes& out, int radius, thread_pool& pool, image_planes& temp);
+void gaussian_blur(const image_planes& in, image_planes& out, float sigma, thread_pool& pool, image_planes& temp);
+void bilateral_filter(const image_planes& in, image_planes& out, float sigma_space, float sigma_color,
+                      thread_pool& pool, image_planes& temp, image_planes& range);
+void bilateral_grid(const image_planes& in, image_planes& out, float sigma_space, float sigma_color,
+                    thread_pool& pool);
+void atrous_filter(const image_planes& in, image_planes& out, const aov::frame& guides, int samples_per_pixel,
+                   float sigma_luminance, thread_pool& pool, workspace& scratch);
+
+// Apply a simple box blur (fast, ok quality), in place
+void box_blur(std::vector<vec3>& pixels, int width, int height, int radius,
+              thread_pool& pool, workspace& scratch);
+
+// Apply gaussian blur (better quality than box, still fast), in place
+void gaussian_blur(std::vector<vec3>& pixels, int width, int height, float sigma,
+                   thread_pool& pool, workspace& scratch);
+
+// Apply bilateral filter (preserves edges, best quality but slower), in place.
+// The range term compares each channel compressed as v / (1 + v), so
+// sigma_color keeps its meaning from black to HDR highlights.
+void bilateral_filter(std::vector<vec3>& pixels, int width, int height, float sigma_space, float sigma_color,
+                      thread_pool& pool, workspace& scratch);
 
-// Apply gaussian blur (better quality than box, still fast)
-std::vector<vec3> gaussian_blur(const std::vector<vec3>& pixels, int width, int height, float sigma = 1.0f);
+// Fast approximation of the bilateral filter, in place (bilateral grid, Chen,
+// Paris & Durand 2007). Pixels are splatted into a coarse (x, y, luminance)
+// grid with cells of about sigma_space pixels by sigma_color, the grid is
+// blurred and read back at each pixel. The cost is linear in the pixel count
+// and does not grow with sigma_space. The range term is the luminance, in the
+// same l / (1 + l) metric as the exact filter, so edges between colors of
+// equal luminance are blurred, unlike the exact filter.
+void bilateral_grid(std::vector<vec3>& pixels, int width, int height, float sigma_space, float sigma_color,
+                    thread_pool& pool, workspace& scratch);
 
-// Apply bilateral filter (preserves edges, best quality but slower)
-std::vector<vec3> bilateral_filter(const std::vector<vec3>& pixels, int width, int height, float sigma_space = 2.0f, float sigma_color = 0.1f);
+// Edge-avoiding à-trous wavelet filter guided by the first-hit buffers, in
+// place (Dammertz et al. 2010, with the variance-driven luminance weight of
+// SVGF, Schied et al. 2017, spatial part only). Expects linear radiance: the
+// color is divided by the albedo, filtered by 5 passes of a 5 x 5 kernel with
+// taps 1, 2, 4, 8 and 16 pixels apart, then multiplied back, so textures stay
+// sharp. Taps are weighted down across normal and depth edges, and across
+// luminance differences larger than sigma_luminance standard deviations of
+// the pixel mean (from the sample variance and samples_per_pixel). Pixels
+// seen on perfect mirrors and glass keep their input, in proportion to
+// their specular share, and are left out of their neighbours' sums.
+void atrous_filter(std::vector<vec3>& pixels, int width, int height, const aov::frame& guides,
+                   int samples_per_pixel, float sigma_luminance, thread_pool& pool, workspace& scratch);
 
 } // namespace denoise
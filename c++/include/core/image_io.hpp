@@ -0,0 +1,91 @@
+#pragma once
+#include "core/vec3.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class thread_pool;
+
+// Image output. Each writer builds the whole file (header + pixels) in one
+// contiguous buffer and hands it to the OS in a single write.
+// Pixels are row-major, top row first.
+namespace image_io {
+
+enum class format { ppm, png, qoi };
+
+// Output format from the file extension (.ppm, .png, .qoi, case-insensitive).
+// Returns false for anything else.
+bool format_from_path(const std::string& path, format& fmt);
+
+// Display-referred image in the format given by the extension of path
+bool write_image(const std::string& path, const std::vector<vec3>& pixels, int width, int height,
+                 thread_pool& pool);
+
+// Same from 8-bit RGB already quantized (3 bytes per pixel, see quantize)
+bool write_image(const std::string& path, const std::vector<std::uint8_t>& rgb, int width, int height,
+                 thread_pool& pool);
+
+// The 8-bit mapping of every writer: [0, 0.999] -> [0, 255], clamped
+std::uint8_t to_byte(real value);
+void quantize(const vec3* pixels, std::size_t count, std::uint8_t* rgb);
+
+// Binary P6 PPM, 8 bits per channel. Values are display-referred (tonemapped,
+// gamma-corrected) in [0, 1] and are clamped.
+bool write_ppm(const std::string& path, const std::vector<vec3>& pixels, int width, int height);
+
+// QOI ("Quite OK Image"), 8-bit RGB, lossless. Single pass, much smaller than
+// PPM and much faster to encode than PNG.
+bool write_qoi(const std::string& path, const std::vector<vec3>& pixels, int width, int height);
+
+// PNG, 8-bit RGB. Rows are filtered in parallel, then the zlib stream is
+// compressed in parallel bands (one IDAT chunk per band, see core/deflate.hpp).
+// The file does not depend on the number of threads.
+bool write_png(const std::string& path, const std::vector<vec3>& pixels, int width, int height,
+               thread_pool& pool);
+
+// PFM (portable float map), 32-bit float RGB, for the linear HDR buffer
+// before tonemapping. Stored bottom row first, as the format requires.
+bool write_pfm(const std::string& path, const std::vector<vec3>& pixels, int width, int height);
+
+// PFM from float planes, one per channel: 3 planes give a color map ("PF"),
+// 1 plane a grayscale map ("Pf"). Used for the AOV buffers.
+bool write_pfm(const std::string& path, const float* const* planes, int channels, int width, int height);
+
+// Read back a color PFM (any byte order), top row first. False if the file
+// cannot be read or is not a 3-channel PFM.
+bool read_pfm(const std::string& path, std::vector<vec3>& pixels, int& width, int& height);
+
+// Read a PFM into float planes, one per channel. False unless the file has
+// exactly this channel count and size.
+bool read_pfm(const std::string& path, float* const* planes, int channels, int width, int height);
+
+// Streaming output for frames that do not fit in memory: rows are encoded and
+// written as they come, top to bottom, and only the encoder state is kept.
+// Same files as the write_* functions above.
+class image_writer {
+public:
+    virtual ~image_writer() = default;
+
+    // Append the next count rows (width * count pixels). False on I/O error
+    // or past the last row.
+    virtual bool write_rows(const vec3* pixels, int count) = 0;
+
+    // Same from 8-bit RGB already quantized (3 bytes per pixel, see
+    // quantize). The PFM writer stores floats and returns false.
+    virtual bool write_rows(const std::uint8_t* rgb, int count) = 0;
+
+    // Write the trailer and close. False if rows are missing or on I/O error.
+    virtual bool finish() = 0;
+};
+
+// Writer for the format given by the extension of path (nullptr if the
+// extension is not supported or the file cannot be created)
+std::unique_ptr<image_writer> open_image_writer(const std::string& path, int width, int height,
+                                                thread_pool& pool);
+
+// Streaming PFM writer (linear HDR rows)
+std::unique_ptr<image_writer> open_pfm_writer(const std::string& path, int width, int height);
+
+} // namespace image_io
@@ -0,0 +1,127 @@
+#pragma once
+#include "core/vec3.hpp"
+#include <cstddef>
+#include <cstdint>
+
+// ============================================================================
+// HOT KERNELS
+// ============================================================================
+//
+// The inner loops of the tracer and of the post-processing, written over flat
+// arrays so the compiler can vectorize them. Every kernel is compiled once per
+// instruction set (src/core/kernels_*.cpp) and the best variant for the CPU is
+// picked at startup (core/cpu_dispatch.hpp).
+//
+// ============================================================================
+
+// Spheres in structure-of-arrays layout
+struct sphere_soa {
+    const real* center_x;
+    const real* center_y;
+    const real* center_z;
+    const real* radius;
+    std::size_t count;
+};
+
+// Planes in structure-of-arrays layout (normals are unit length)
+struct plane_soa {
+    const real* anchor_x;
+    const real* anchor_y;
+    const real* anchor_z;
+    const real* normal_x;
+    const real* normal_y;
+    const real* normal_z;
+    std::size_t count;
+};
+
+// Axis-aligned bounding boxes in structure-of-arrays layout
+struct aabb_soa {
+    const real* min_x;
+    const real* min_y;
+    const real* min_z;
+    const real* max_x;
+    const real* max_y;
+    const real* max_z;
+    std::size_t count;
+};
+
+// Guides of the à-trous filter: float planes of width * height
+struct atrous_guides {
+    const float* normal[3];         // Unit first-hit normals, zero where the ray escaped
+    const float* depth;
+    const float* depth_gradient;    // Depth change per pixel of screen distance
+    const float* specular;          // Share of the pixel on mirrors and glass, left out of the sums
+    int width;
+    int height;
+};
+
+// Exposure, ACES, gamma and 8-bit quantization as a table over the input
+// value (built by the post-processing pipeline, core/post_process.hpp). The
+// whole chain is monotonic, so byte b is the output for every input in
+// [threshold b, threshold b + 1). Thresholds and inputs are compared as float
+// bits, which order like the values once negatives are clamped. Inputs are
+// clamped to the bits [first_bits, last_bits]; the bucket of a value is its
+// bits minus first_bits, shifted right by shift (a fixed number of buckets
+// per octave), and holds the byte at its start. No bucket contains more than
+// 2 thresholds.
+struct tonemap_lut {
+    const std::int32_t* thresholds;    // 258 float bits: [0] = 0, [256] and [257] = +inf
+    const std::uint8_t* buckets;
+    std::int32_t first_bits;
+    std::int32_t last_bits;
+    int shift;
+};
+
+struct kernel_table {
+    // Closest sphere with 0 < t < t_max. Returns its index and writes t_hit, or -1.
+    long (*hit_spheres)(const sphere_soa& spheres, const vec3& origin, const vec3& direction,
+                        real t_max, real& t_hit);
+
+    // Closest plane with 0 < t < t_max. Returns its index and writes t_hit, or -1.
+    long (*hit_planes)(const plane_soa& planes, const vec3& origin, const vec3& direction,
+                       real t_max, real& t_hit);
+
+    // Slab test of one ray against every box: hit[i] = 1 if the ray enters box i
+    // before t_max. inv_direction is 1/direction per axis. Returns the number of hits.
+    std::size_t (*hit_aabbs)(const aabb_soa& boxes, const vec3& origin, const vec3& inv_direction,
+                             real t_max, std::uint8_t* hit);
+
+    // ACES filmic curve then gamma, per channel: out[i] = aces(in[i] * exposure)^inv_gamma.
+    // Works on any interleaved layout since every channel is independent.
+    void (*tonemap)(const real* in, real* out, std::size_t count, real exposure, real inv_gamma);
+
+    // Tonemap and quantize count pixels of stride reals (the first 3 are the
+    // color) to 3 bytes each through the table: no pow, and the bytes of
+    // tonemap followed by image_io::quantize, give or take 1 where the curve
+    // is not monotonic at the last ulp.
+    void (*tonemap_quantize)(const real* in, std::size_t count, std::size_t stride, const tonemap_lut& lut,
+                             std::uint8_t* rgb);
+
+    // Weighted sum of float rows: out[i] = sum_k weights[k] * rows[k][i].
+    // Both passes of the separable blurs on a channel plane (horizontal taps
+    // are shifted pointers into a padded row).
+    void (*weighted_row_sum)(const float* const* rows, const float* weights, int taps,
+                             float* out, std::size_t count);
+
+    // One output row of the bilateral filter on float planes. For each of the
+    // 3 channels, window[c] points to the first of the 2r + 1 source rows around
+    // the output row, in a plane padded by r clamped pixels on every side
+    // (padded_width floats per row). range_window[c] is the same window in the
+    // metric the range weight compares. spatial[dy * (2r + 1) + dx] holds the
+    // spatial weights. The range weight uses a fast exp (relative error < 2e-7).
+    // accum is scratch for 4 * width floats.
+    void (*bilateral_row)(const float* const* window, const float* const* range_window, int padded_width,
+                          int width, int radius, const float* spatial, float inv_two_sigma_color_sq,
+                          float* accum, float* const* out);
+
+    // Output row y of one edge-avoiding à-trous pass: 5 x 5 B3-spline taps
+    // step pixels apart over color[0..2], each weighted by the normal, depth
+    // and luminance similarity to the center pixel and by the share of the
+    // tapped pixel that is not specular. luminance_scale[x] is
+    // 1 / (sigma * standard deviation) of output pixel x. The variance plane
+    // is filtered with the squared weights into out_variance. Pixels without
+    // a normal are copied. accum is scratch for 5 * width floats.
+    void (*atrous_row)(const float* const* color, const float* variance, const atrous_guides& guides,
+                       int y, int step, const float* luminance_scale, float* accum,
+                       float* const* out, float* out_variance);
+};
@@ -17,15 +17,15 @@ public:
     }
 
     // Get distance from point to light
-    double distance_from(const vec3& point) const {
+    real distance_from(const vec3& point) const {
         return std::sqrt((position - point).length_squared());
     }
 
     // Get illumination at a point (with inverse square falloff)
     vec3 get_illumination(const vec3& point) const {
-        double distance = distance_from(point);
-        double distance_sq = distance * distance;
-        double falloff = intensity / (distance_sq + 0.0001);
+        real distance = distance_from(point);
+        real distance_sq = distance * distance;
+        real falloff = intensity / (distance_sq + real(0.0001));
         return color * falloff;
     }
 };
@@ -44,13 +44,13 @@ public:
 
     // Get light direction from ANY point (always the same for directional light)
     vec3 direction_from(const vec3& /*point*/) const {
-        return direction * -1.0;  // Reverse direction (light comes FROM direction)
+        return direction * real(-1);  // Reverse direction (light comes FROM direction)
     }
 
     // For directional light, there's no distance (infinite distance)
     // Return very large value to avoid shadowing issues
-    double distance_from(const vec3& /*point*/) const {
-        return 1e10;  // Very large distance (simulating infinite distance)
+    real distance_from(const vec3& /*point*/) const {
+        return real(1e10);  // Very large distance (simulating infinite distance)
     }
 
     // Get illumination at a point (no falloff for directional light)
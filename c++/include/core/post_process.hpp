@@ -0,0 +1,93 @@
+#pragma once
+#include "core/vec3.hpp"
+#include "core/denoise.hpp"
+#include "core/kernels.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// POST-TRAITEMENT : du tampon HDR linéaire à l'image 8 bits
+// ============================================================================
+//
+// Ordered stages run on the linear HDR frame:
+//
+//   denoise    one of the denoise:: filters (whole frame, reads neighbours)
+//   exposure   multiply by a scale
+//   tonemap    ACES filmic curve
+//   gamma      value^(1 / gamma)
+//   quantize   8-bit RGB with the mapping of the image writers
+//
+// Consecutive per-pixel stages (all but denoise) are fused into one pass
+// over the frame, a band of rows at a time while it is in cache, and
+// exposure + tonemap + gamma become one call of the tonemap kernel. When
+// quantize follows, the chain goes straight to bytes through a threshold
+// table (tonemap_lut in core/kernels.hpp): no pow per channel, and the
+// pixels keep their linear values. Every pass is timed; timings() keeps the
+// breakdown of the last run.
+//
+// ============================================================================
+
+class thread_pool;
+namespace aov { struct frame; }
+
+namespace post {
+
+enum class stage_type { denoise, exposure, tonemap, gamma, quantize };
+
+// Time of one pass of the last run. Fused stages share a pass and a name
+// joined with '+', e.g. "exposure+tonemap+gamma+quantize".
+struct pass_timing {
+    std::string name;
+    double ms = 0.0;
+};
+
+class pipeline {
+public:
+    // Stages run in the order they are added; quantize must come last.
+    // Denoise types: 0 box, 1 Gaussian, 2 bilateral, 3 bilateral grid,
+    // 4 à-trous (needs the AOV guides, skipped without them).
+    pipeline& denoise(int type, float strength, const aov::frame* guides = nullptr, int samples_per_pixel = 1);
+    pipeline& exposure(real scale);
+    pipeline& tonemap();
+    pipeline& gamma(real value);
+    pipeline& quantize();
+
+    // Run the stages on a linear frame of width * height pixels, in place.
+    // The quantize stage writes 3 bytes per pixel to rgb.
+    void run(std::vector<vec3>& pixels, int width, int height, thread_pool& pool, std::vector<std::uint8_t>& rgb);
+
+    // Same for a pipeline without a quantize stage
+    void run(std::vector<vec3>& pixels, int width, int height, thread_pool& pool);
+
+    // One entry per pass of the last run, in order
+    const std::vector<pass_timing>& timings() const { return last_timings; }
+
+private:
+    struct stage {
+        stage_type type;
+        real value = 1;                   // Exposure scale or gamma
+        int denoise_type = 0;
+        float strength = 1.0f;
+        const aov::frame* guides = nullptr;
+        int samples_per_pixel = 1;
+    };
+
+    void run_denoise(const stage& s, std::vector<vec3>& pixels, int width, int height, thread_pool& pool);
+    void run_pixel_pass(std::size_t first, std::size_t end, std::vector<vec3>& pixels, int width, int height,
+                        thread_pool& pool, std::vector<std::uint8_t>* rgb);
+    void build_lut(real exposure, real inv_gamma);
+
+    std::vector<stage> stages;
+    std::vector<pass_timing> last_timings;
+    denoise::workspace scratch;    // Kept so that repeated runs do not allocate
+
+    // Tonemap + quantize table, rebuilt when the exposure or gamma change
+    std::vector<std::int32_t> lut_thresholds;
+    std::vector<std::uint8_t> lut_buckets;
+    tonemap_lut lut{};
+    real lut_exposure = -1;
+    real lut_inv_gamma = -1;
+};
+
+} // namespace post
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <random>
+
+// ============================================================================
+// RANDOM : générateur par thread, reproductible par échantillon
+// ============================================================================
+//
+// PCG32 (O'Neill 2014, XSH-RR): 64-bit state and two multiplies per number,
+// so it can be reseeded for every sample at no real cost. Each sample of each
+// pixel gets its own stream derived from (seed, pixel, sample), which makes
+// an image independent of the thread count, of the band order and of where a
+// render was stopped and resumed (see core/checkpoint.hpp).
+//
+// Satisfies UniformRandomBitGenerator, so it works with <random>
+// distributions.
+//
+// ============================================================================
+
+class pcg32 {
+public:
+    using result_type = std::uint32_t;
+
+    explicit pcg32(std::uint64_t seed_value = 0x853c49e6748fea9bULL,
+                   std::uint64_t stream = 0xda3e39cb94b95bdbULL) {
+        seed(seed_value, stream);
+    }
+
+    void seed(std::uint64_t seed_value, std::uint64_t stream) {
+        state = 0;
+        increment = (stream << 1) | 1u;
+        (*this)();
+        state += seed_value;
+        (*this)();
+    }
+
+    result_type operator()() {
+        std::uint64_t old = state;
+        state = old * 6364136223846793005ULL + increment;
+        std::uint32_t xorshifted = static_cast<std::uint32_t>(((old >> 18) ^ old) >> 27);
+        std::uint32_t rotation = static_cast<std::uint32_t>(old >> 59);
+        return (xorshifted >> rotation) | (xorshifted << ((32 - rotation) & 31));
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return 0xFFFFFFFFu; }
+
+private:
+    std::uint64_t state = 0;
+    std::uint64_t increment = 1;
+};
+
+// Generator and [0, 1) distribution used by the camera, the materials and the
+// random vec3 utilities, one per render thread (random.cpp)
+extern thread_local pcg32 generator;
+extern thread_local std::uniform_real_distribution<double> distribution;
+
+// Start the stream of one sample: same (seed, pixel, sample), same numbers
+void seed_sample(std::uint64_t seed, std::uint64_t pixel, std::uint32_t sample);
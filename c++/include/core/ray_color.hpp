@@ -6,6 +6,11 @@
 #include <memory>
 #include <optional>
 
+struct first_hit;
+
+// Radiance along a ray. When first is given, the first hit of the ray is
+// written to it for the AOV buffers (core/aov.hpp); it is left untouched when
+// the ray escapes.
 vec3 ray_color(
     const vec3& ray_origin,
     const vec3& ray_direction,
@@ -13,5 +18,6 @@ vec3 ray_color(
     const std::vector<PointLight>& lights,
     const std::optional<DirectionalLight>& sun,
     int depth,
-    double ambient_light
+    real ambient_light,
+    first_hit* first = nullptr
 );
@@ -0,0 +1,166 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// DESCRIPTION DE SCÈNE : fichiers JSON et binaires
+// ============================================================================
+//
+// What the tracer reads from a scene file before building its objects:
+// render settings, camera, and flat arrays of materials, objects, meshes and
+// lights.
+// Two file formats give the same description:
+//
+//   .json     the editor saves, streamed through a SAX parser straight into
+//             the arrays (no json tree: memory follows the records, not the text)
+//   .rscn     binary: a header, then the arrays as they are in memory,
+//             mapped read-only (mmap) and used in place, without parsing
+//
+// A binary file is made from a JSON one with `main --scene x.json --convert
+// x.rscn`. Layout of version 3 (native byte order, records as declared below):
+//
+//   scene_file_header   magic "RAYTSCN", version, settings, counts, offsets
+//   material_record[]   at materials_offset, 8-byte aligned
+//   object_record[]     at objects_offset, 8-byte aligned
+//   mesh_record[]       at meshes_offset, 8-byte aligned
+//   light_record[]      at lights_offset, 8-byte aligned
+//   char[]              at strings_offset: the mesh file paths, relative to
+//                       the .rscn file
+//
+// Planes ("type": "Plan") are infinite unless "shape" is "quad" or
+// "disk": then "size" is the side of the square or the diameter of the
+// disk, as the editor draws and picks them, and they have a bounding box.
+// Any other "shape", or a quad or disk without a positive "size", is an
+// error.
+//
+// Meshes ("type": "Maillage" or "Mesh" in JSON, with "file": an OBJ path
+// relative to the scene file) are loaded by the renderer; the description
+// only keeps their path, resolved against the current directory.
+//
+// Materials with the same description are stored once; objects refer to
+// them by index, which is also the material id of the AOVs.
+//
+// A manifest is a JSON scene with a "parts" array: other scene files (JSON
+// or binary, paths relative to the manifest) placed in it, loaded in
+// parallel and appended in the order of the list, after the manifest's own
+// objects and lights. Render settings and camera come from the manifest.
+//
+//   "parts": [ { "file": "crowd.rscn", "translate": {"x": 0, "y": 0, "z": -20},
+//                "scale": 2.0, "rotate_y": 90 }, ... ]
+//
+// scale is uniform and rotate_y (degrees) turns about the vertical axis, so
+// spheres stay spheres and planes stay horizontal (meshes take any rotate_y). Object ids are shifted
+// part by part to stay unique; the content hash covers every file.
+//
+// ============================================================================
+
+struct render_settings {
+    std::int32_t image_width = 0;
+    std::int32_t image_height = 0;
+    std::int32_t samples_per_pixel = 0;
+    std::int32_t max_depth = 0;
+    std::int32_t num_threads = 0;
+    std::int32_t enable_denoise = 0;
+    std::int32_t denoise_type = 1;      // 0=Box, 1=Gaussian, 2=Bilateral, 3=Bilateral grid, 4=À-trous (guided)
+    float denoise_strength = 1.0f;
+    double gamma = 2.2;
+    double exposure = 1.0;
+    double ambient_light = 1.0;
+    double sun_intensity = 0.0;         // 0 = no sun
+    double sun_direction[3] = {0.5, -1.0, 0.3};   // Direction FROM which sun light comes
+};
+
+struct camera_settings {
+    double origin[3] = {0, 0, 0};
+    double look_at[3] = {0, 0, -1};
+    double up[3] = {0, 1, 0};
+    double fov = 45.0;
+    double aspect_ratio = 16.0 / 9.0;
+    double aperture = 0.0;
+    double focus_distance = 10.0;
+};
+
+enum class material_kind : std::uint32_t { diffuse, metal, dielectric, emissive, mirror };
+enum class shape_kind : std::uint32_t { sphere, plane, quad, disk };  // Binary scenes are checked against the last
+
+struct material_record {
+    material_kind kind;
+    float color[3];
+    float parameter;        // Metal roughness, glass refraction index, emission strength
+};
+
+struct object_record {
+    shape_kind shape;
+    std::uint32_t material; // Index in the material array
+    std::int32_t id;        // Index of the object in the scene file (AOV object id)
+    float position[3];
+    float size;             // Sphere radius, quad side, disk diameter (unused by infinite planes)
+    float rotate_y;         // Degrees about the vertical axis, for quads (from manifest parts)
+};
+
+struct mesh_record {
+    std::uint32_t material;     // Index in the material array
+    std::int32_t id;            // Index of the object in the scene file (AOV object id)
+    float position[3];          // Where the origin of the OBJ file goes
+    float scale;                // Uniform, applied first
+    float rotate_y;             // Degrees about the vertical axis, after the scale
+    std::uint32_t path_offset;  // File path in the string table
+    std::uint32_t path_size;
+};
+
+struct light_record {
+    float position[3];
+    float color[3];
+    float intensity;
+};
+
+// Read-only view of a contiguous array
+template <typename T>
+struct array_view {
+    const T* data = nullptr;
+    std::size_t size = 0;
+
+    const T* begin() const { return data; }
+    const T* end() const { return data + size; }
+    const T& operator[](std::size_t i) const { return data[i]; }
+};
+
+struct scene_desc {
+    scene_desc() = default;
+    scene_desc(const scene_desc&) = delete;            // The views would point into the copied storage
+    scene_desc& operator=(const scene_desc&) = delete;
+    scene_desc(scene_desc&&) = default;
+    scene_desc& operator=(scene_desc&&) = default;
+
+    render_settings render;
+    camera_settings camera;
+    array_view<material_record> materials;
+    array_view<object_record> objects;
+    array_view<mesh_record> meshes;
+    array_view<light_record> lights;
+    array_view<char> strings;
+
+    // Hash of the file contents (checkpoints are tied to it)
+    std::uint64_t content_hash = 0;
+
+    // What the views point into: vectors filled from JSON, or the mapping
+    std::vector<material_record> material_storage;
+    std::vector<object_record> object_storage;
+    std::vector<mesh_record> mesh_storage;
+    std::vector<light_record> light_storage;
+    std::vector<char> string_storage;
+    std::shared_ptr<const void> mapping;
+
+    std::string path_of(const mesh_record& mesh) const { return std::string(strings.data + mesh.path_offset, mesh.path_size); }
+};
+
+// Load a .json or .rscn scene (format from the extension), or a manifest and
+// its parts, loaded on 'threads' threads (0 = hardware threads, 1 = one after
+// the other). On failure error says why and desc is left unusable.
+bool load_scene(const std::string& path, scene_desc& desc, std::string& error, int threads = 0);
+
+// Write desc as a binary scene file (.rscn). False on I/O error.
+bool save_scene_binary(const std::string& path, const scene_desc& desc);
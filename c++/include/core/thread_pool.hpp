@@ -0,0 +1,59 @@
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// ============================================================================
+// THREAD POOL : workers partagés par le rendu et le post-traitement
+// ============================================================================
+//
+// Fixed set of worker threads (num_threads from the render settings).
+//
+//     thread_pool pool(num_threads);
+//     pool.parallel_for(height, [&](std::size_t y) { render_row(y); });
+//
+// parallel_for() hands indices out one at a time (dynamic scheduling) and the
+// calling thread works too, so nested calls from inside a task cannot deadlock.
+//
+// ============================================================================
+
+class thread_pool {
+public:
+    // num_threads <= 0 uses the number of hardware threads
+    explicit thread_pool(int num_threads = 0);
+    ~thread_pool();
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    // Number of threads taking part in parallel_for (workers + caller)
+    int size() const { return static_cast<int>(workers.size()) + 1; }
+
+    // Run fn(i) for every i in [0, count) and return when all calls are done
+    void parallel_for(std::size_t count, const std::function<void(std::size_t)>& fn);
+
+    // Run fn(begin, end) over a few ranges of [0, count) per thread, for
+    // per-element work too fine to hand out one index at a time
+    template <typename Fn>
+    void parallel_ranges(std::size_t count, Fn&& fn) {
+        const std::size_t ranges = std::max<std::size_t>(1, std::min<std::size_t>(count / 1024, 4 * size()));
+        parallel_for(ranges, [&](std::size_t r) { fn(count * r / ranges, count * (r + 1) / ranges); });
+    }
+
+    // Run fn on a worker thread (fire and forget)
+    void submit(std::function<void()> fn);
+
+private:
+    void worker_loop();
+
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable task_available;
+    bool stopping = false;
+};
@@ -1,23 +1,133 @@
 #pragma once
+#include <cmath>
 
-// 3D vector class for ray tracing
+// Scalar type of the tracer. Float by default (twice the SIMD width and half
+// the memory traffic of double); build with -DRAYT_USE_DOUBLE for reference
+// renders in double precision.
+#ifdef RAYT_USE_DOUBLE
+using real = double;
+#else
+using real = float;
+#endif
+
+// SSE-backed storage is opt-in (-DRAYT_VEC3_SSE) and only applies to float:
+// vec3 becomes 16 bytes, 16-byte aligned, and +, -, * and dot run on one
+// register. The scalar layout stays the default because it is 25% smaller
+// in framebuffers and scene data, and GCC/Clang vectorize it well once inlined.
+#if defined(RAYT_VEC3_SSE) && !defined(RAYT_USE_DOUBLE) && defined(__SSE__)
+#define RAYT_VEC3_SIMD 1
+#endif
+
+#if defined(__SSE__) && !defined(RAYT_USE_DOUBLE)
+#include <xmmintrin.h>
+#endif
+
+// Intrinsics are not constexpr, so the SSE variant drops it
+#ifdef RAYT_VEC3_SIMD
+#define RAYT_VEC3_CONSTEXPR
+#else
+#define RAYT_VEC3_CONSTEXPR constexpr
+#endif
+
+// 3D vector class for ray tracing.
+// Header-only so every operation inlines into ray_color, the primitives and
+// the denoisers without link-time optimization.
+#ifdef RAYT_VEC3_SIMD
+class alignas(16) vec3 {
+public:
+    real x, y, z;
+    real w;  // Padding lane, kept at 0
+
+    vec3() : x(0), y(0), z(0), w(0) {}
+    vec3(real x, real y, real z) : x(x), y(y), z(z), w(0) {}
+
+    __m128 load() const { return _mm_load_ps(&x); }
+    static vec3 store(__m128 v) { vec3 r; _mm_store_ps(&r.x, v); return r; }
+
+    // Sums lanes x, y, z only, so the padding lane never leaks into results
+    real dot(const vec3& other) const {
+        __m128 m = _mm_mul_ps(load(), other.load());
+        __m128 s = _mm_add_ss(m, _mm_shuffle_ps(m, m, 1));
+        s = _mm_add_ss(s, _mm_movehl_ps(m, m));
+        return _mm_cvtss_f32(s);
+    }
+
+    vec3 operator+(const vec3& other) const { return store(_mm_add_ps(load(), other.load())); }
+    vec3 operator-(const vec3& other) const { return store(_mm_sub_ps(load(), other.load())); }
+    vec3 operator*(const vec3& mul) const { return store(_mm_mul_ps(load(), mul.load())); }
+    vec3 operator*(real mul) const { return store(_mm_mul_ps(load(), _mm_set1_ps(mul))); }
+    vec3 operator/(real div) const { return store(_mm_div_ps(load(), _mm_set1_ps(div))); }
+    vec3 operator+(real constant) const {
+        return store(_mm_add_ps(load(), _mm_setr_ps(constant, constant, constant, 0.0f)));
+    }
+#else
 class vec3 {
-public: 
-    double x, y, z;
-
-    vec3();
-    vec3(double x, double y, double z);
-
-    double length_squared() const;
-    vec3 normalize() const;
-    double dot(const vec3& other) const;
-    vec3 cross(const vec3& other) const;
-    
-    vec3 operator+(const vec3& other) const;
-    vec3 operator-(const vec3& other) const;
-    vec3 operator/(double div) const;
-    vec3 operator*(double mul) const;
-    vec3 operator*(vec3 mul) const;
-    vec3 operator+(double constant) const;
+public:
+    real x, y, z;
+
+    constexpr vec3() : x(0), y(0), z(0) {}
+    constexpr vec3(real x, real y, real z) : x(x), y(y), z(z) {}
+
+    constexpr real dot(const vec3& other) const {
+        return x * other.x + y * other.y + z * other.z;
+    }
+
+    constexpr vec3 operator+(const vec3& other) const { return vec3(x + other.x, y + other.y, z + other.z); }
+    constexpr vec3 operator-(const vec3& other) const { return vec3(x - other.x, y - other.y, z - other.z); }
+    constexpr vec3 operator*(const vec3& mul) const { return vec3(x * mul.x, y * mul.y, z * mul.z); }
+    constexpr vec3 operator*(real mul) const { return vec3(x * mul, y * mul, z * mul); }
+    constexpr vec3 operator/(real div) const { return vec3(x / div, y / div, z / div); }
+    constexpr vec3 operator+(real constant) const { return vec3(x + constant, y + constant, z + constant); }
+#endif
+
+    RAYT_VEC3_CONSTEXPR real length_squared() const { return dot(*this); }
+
+    RAYT_VEC3_CONSTEXPR vec3 cross(const vec3& other) const {
+        return vec3(
+            y * other.z - z * other.y,
+            z * other.x - x * other.z,
+            x * other.y - y * other.x
+        );
+    }
+
+    // Exact normalization (sphere normals, camera basis, light directions)
+    vec3 normalize() const {
+        real length = std::sqrt(length_squared());
+        if (length == real(0)) return vec3(0, 0, 0);
+        return *this * (real(1) / length);
+    }
+
+    // Normalization through the hardware reciprocal square root refined by one
+    // Newton-Raphson step (relative error below 5e-7 in float). Only for directions
+    // whose exact length is not critical, such as scatter and sky directions.
+    // Falls back to normalize() in double.
+    vec3 normalize_fast() const {
+#if defined(RAYT_VEC3_SIMD)
+        __m128 v = load();
+        __m128 m = _mm_mul_ps(v, v);
+        __m128 len_sq = _mm_add_ss(_mm_add_ss(m, _mm_shuffle_ps(m, m, 1)), _mm_movehl_ps(m, m));
+        if (_mm_cvtss_f32(len_sq) == 0.0f) return vec3(0, 0, 0);
+        len_sq = _mm_shuffle_ps(len_sq, len_sq, 0);
+        __m128 y0 = _mm_rsqrt_ps(len_sq);
+        __m128 nr = _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), len_sq), _mm_mul_ps(y0, y0)));
+        return store(_mm_mul_ps(v, _mm_mul_ps(y0, nr)));
+#elif defined(__SSE__) && !defined(RAYT_USE_DOUBLE)
+        real len_sq = length_squared();
+        if (len_sq == real(0)) return vec3(0, 0, 0);
+        real y0 = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(len_sq)));
+        real inv_length = y0 * (real(1.5) - real(0.5) * len_sq * y0 * y0);
+        return *this * inv_length;
+#else
+        return normalize();
+#endif
+    }
 };
 
+// Reflection
+inline RAYT_VEC3_CONSTEXPR vec3 reflect(const vec3& v_in, const vec3& normal) {
+    return v_in - (normal * (real(2) * v_in.dot(normal)));
+}
+
+// Random vector utilities (vec3.cpp, they own a random generator)
+vec3 random_in_unit_sphere();
+vec3 random_unit_vector();
@@ -27,6 +27,7 @@
 #include "gizmo.hpp"
 #include "preview/camera_gl.hpp"
 #include <GLFW/glfw3.h>
+#include <string>
 
 // ============================================================================
 // CLASSE EDITORUI
@@ -66,12 +67,17 @@ private:
     float gamma = 2.2f;
     
     // Post-processing
+    float exposure = 1.0f;
     bool enable_denoise = false;
     int denoise_type = 1;  // 0=Box, 1=Gaussian, 2=Bilateral
     float denoise_strength = 1.0f;  // 0.5-2.0
     
     // Performance
     int num_threads = 8;
+
+    // Dernier lancement du ray tracer (rendu ou post-traitement)
+    std::string tracer_status;
+    bool tracer_ok = true;
     
 public:
     // ====================================================================
@@ -35,6 +35,14 @@ enum class ObjectType {
     TRIANGLE  // Pour le futur
 };
 
+// Étendue d'un plan : infini, ou fini avec une boîte englobante
+// (carré de côté size, disque de diamètre size)
+enum class PlaneShape {
+    INFINITE_PLANE,
+    QUAD,
+    DISK
+};
+
 enum class MaterialType {
     DIFFUSE,
     METAL,
@@ -57,7 +65,8 @@ public:
     
     glm::vec3 position;         // Position (x, y, z)
     glm::vec3 color;            // Couleur (r, g, b) entre 0.0 et 1.0
-    float size;                 // Rayon pour sphère, échelle pour plan
+    float size;                 // Rayon pour sphère, côté ou diamètre pour plan
+    PlaneShape plane_shape;     // Plans seulement
     
     MaterialType material;
     float roughness;            // Pour le métal (0 = lisse, 1 = rugueux)
@@ -88,4 +97,7 @@ public:
     
     // Retourne un nom lisible du matériau
     std::string get_material_name() const;
+
+    // Valeur de "shape" dans le JSON ("quad", "disk"), vide pour un plan infini
+    std::string get_plane_shape_name() const;
 };
@@ -0,0 +1,42 @@
+#pragma once
+#include "core/vec3.hpp"
+#include <algorithm>
+#include <limits>
+
+// Axis-aligned bounding box
+struct aabb {
+    real min[3] = {0, 0, 0};
+    real max[3] = {0, 0, 0};
+
+    // Grows from nothing: the first grow() sets it
+    static aabb empty() {
+        aabb box;
+        for (int axis = 0; axis < 3; ++axis) {
+            box.min[axis] = std::numeric_limits<real>::infinity();
+            box.max[axis] = -std::numeric_limits<real>::infinity();
+        }
+        return box;
+    }
+
+    void grow(const aabb& other) {
+        for (int axis = 0; axis < 3; ++axis) {
+            min[axis] = std::min(min[axis], other.min[axis]);
+            max[axis] = std::max(max[axis], other.max[axis]);
+        }
+    }
+
+    void grow(const vec3& point) {
+        const real p[3] = {point.x, point.y, point.z};
+        for (int axis = 0; axis < 3; ++axis) {
+            min[axis] = std::min(min[axis], p[axis]);
+            max[axis] = std::max(max[axis], p[axis]);
+        }
+    }
+
+    real centroid(int axis) const { return (min[axis] + max[axis]) * real(0.5); }
+
+    real half_area() const {
+        const real dx = max[0] - min[0], dy = max[1] - min[1], dz = max[2] - min[2];
+        return dx * dy + dy * dz + dz * dx;
+    }
+};
@@ -0,0 +1,76 @@
+#pragma once
+#include "core/vec3.hpp"
+#include "geometry/aabb.hpp"
+#include <cmath>
+
+// Affine transform: a 3x3 linear part and a translation, as the three rows
+// of a 3x4 matrix. Points get the translation, vectors do not.
+struct affine {
+    real m[3][4] = {{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}};
+
+    // Scale, then rotation about y (degrees), then translation: the order
+    // the scene records place their objects in
+    static affine from_trs(const vec3& translate, real rotate_y_degrees, real scale) {
+        const real angle = real(rotate_y_degrees * 3.14159265358979323846 / 180.0);
+        const real c = std::cos(angle), s = std::sin(angle);
+        affine t;
+        t.m[0][0] = c * scale;  t.m[0][1] = 0;      t.m[0][2] = s * scale;  t.m[0][3] = translate.x;
+        t.m[1][0] = 0;          t.m[1][1] = scale;  t.m[1][2] = 0;          t.m[1][3] = translate.y;
+        t.m[2][0] = -s * scale; t.m[2][1] = 0;      t.m[2][2] = c * scale;  t.m[2][3] = translate.z;
+        return t;
+    }
+
+    vec3 point(const vec3& p) const {
+        return vec3(m[0][0] * p.x + m[0][1] * p.y + m[0][2] * p.z + m[0][3],
+                    m[1][0] * p.x + m[1][1] * p.y + m[1][2] * p.z + m[1][3],
+                    m[2][0] * p.x + m[2][1] * p.y + m[2][2] * p.z + m[2][3]);
+    }
+
+    vec3 vector(const vec3& v) const {
+        return vec3(m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z,
+                    m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z,
+                    m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z);
+    }
+
+    // Transposed linear part: called on the inverse, maps normals
+    vec3 transpose_vector(const vec3& v) const {
+        return vec3(m[0][0] * v.x + m[1][0] * v.y + m[2][0] * v.z,
+                    m[0][1] * v.x + m[1][1] * v.y + m[2][1] * v.z,
+                    m[0][2] * v.x + m[1][2] * v.y + m[2][2] * v.z);
+    }
+
+    // Inverse by cofactors, in double; the linear part must not be singular
+    affine inverse() const {
+        const double a = m[0][0], b = m[0][1], c = m[0][2];
+        const double d = m[1][0], e = m[1][1], f = m[1][2];
+        const double g = m[2][0], h = m[2][1], i = m[2][2];
+        const double c00 = e * i - f * h, c01 = c * h - b * i, c02 = b * f - c * e;
+        const double c10 = f * g - d * i, c11 = a * i - c * g, c12 = c * d - a * f;
+        const double c20 = d * h - e * g, c21 = b * g - a * h, c22 = a * e - b * d;
+        const double inv_det = 1.0 / (a * c00 + b * c10 + c * c20);
+        const double linear[3][3] = {{c00 * inv_det, c01 * inv_det, c02 * inv_det},
+                                     {c10 * inv_det, c11 * inv_det, c12 * inv_det},
+                                     {c20 * inv_det, c21 * inv_det, c22 * inv_det}};
+        affine r;
+        for (int row = 0; row < 3; ++row) {
+            double translation = 0;
+            for (int col = 0; col < 3; ++col) {
+                r.m[row][col] = real(linear[row][col]);
+                translation -= linear[row][col] * m[col][3];
+            }
+            r.m[row][3] = real(translation);
+        }
+        return r;
+    }
+
+    // Box around the eight transformed corners of box
+    aabb bounds(const aabb& box) const {
+        aabb result = aabb::empty();
+        for (int corner = 0; corner < 8; ++corner) {
+            result.grow(point(vec3(corner & 1 ? box.max[0] : box.min[0],
+                                   corner & 2 ? box.max[1] : box.min[1],
+                                   corner & 4 ? box.max[2] : box.min[2])));
+        }
+        return result;
+    }
+};
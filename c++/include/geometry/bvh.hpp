@@ -0,0 +1,211 @@
+#pragma once
+#include "core/vec3.hpp"
+#include "geometry/aabb.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class thread_pool;
+
+// Bounding volume hierarchy over primitives known only by their boxes, built
+// with binned SAH (surface area heuristic) and stored as a flat array of
+// nodes. The primitives of a leaf are contiguous in the order returned by
+// build(); the owner stores its primitives in that order so a leaf reads
+// them sequentially. build_lbvh() makes the same nodes from Morton codes,
+// several times faster and in parallel, for a somewhat slower tree.
+//
+// compress() then trades the nodes for a quantized form, for trees whose
+// node traffic dominates: each interior node becomes one record holding the
+// boxes of its two children in 8 bits per coordinate, relative to its own
+// box, which the traversal decodes on the way down. 10 bytes per box instead
+// of 32, and the decoded boxes only ever grow (conservative rounding), so
+// the hits are the same; the traversal does a little more arithmetic.
+class bvh {
+public:
+    // 32 bytes in float. count == 0: interior node whose children are
+    // nodes[index] and nodes[index + 1]; otherwise a leaf of count
+    // primitives starting at index.
+    struct node {
+        real min[3];
+        std::uint32_t index;
+        real max[3];
+        std::uint32_t count;
+    };
+
+    // 20 bytes: the two children of an interior node. A child box is
+    // dequantize(parent min, step, lo) .. dequantize(parent min, step, hi)
+    // per axis. child: leaf_bit | (count - 1) << 27 | first for a leaf,
+    // else the index of the child's own record.
+    struct qnode {
+        std::uint8_t lo[2][3];
+        std::uint8_t hi[2][3];
+        std::uint32_t child[2];
+    };
+    static constexpr std::uint32_t leaf_bit = 0x80000000u;
+    static constexpr std::uint32_t max_compressed_leaf = 16;
+    static constexpr std::uint32_t max_compressed_first = 1u << 27;
+
+    // Deepest tree build() makes (the traversal stack is sized for it)
+    static constexpr int max_depth = 64;
+
+    // Builds over boxes. order[i] is the box placed at position i.
+    void build(const std::vector<aabb>& boxes, std::vector<std::uint32_t>& order, int max_leaf_size = 4);
+
+    // Linear BVH, every pass on the pool: centroids sorted by Morton code of
+    // code_bits (30 or 63) with a radix sort, then the Karras hierarchy over
+    // the sorted codes emitted and fitted in one bottom-up pass (Apetrei,
+    // "Fast and Simple Agglomerative LBVH Construction", 2014).
+    // treelet_rounds > 0 then restructures small treelets for a lower SAH
+    // cost (Karras & Aila, "Fast Parallel Construction of High-Quality
+    // Bounding Volume Hierarchies", 2013), one bottom-up pass per round.
+    void build_lbvh(const std::vector<aabb>& boxes, std::vector<std::uint32_t>& order, thread_pool& pool,
+                    int code_bits = 30, int treelet_rounds = 0, int max_leaf_size = 4);
+
+    // Switches to quantized nodes and frees the full ones. False, keeping
+    // the tree as it is, when it does not fit the format: a root leaf, a
+    // leaf of more than max_compressed_leaf primitives or starting past
+    // max_compressed_first.
+    bool compress();
+    bool compressed() const { return !qnodes.empty(); }
+
+    bool empty() const { return nodes.empty() && qnodes.empty(); }
+    const aabb& bounds() const { return root_bounds; }
+    std::size_t node_count() const { return compressed() ? 2 * qnodes.size() + 1 : nodes.size(); }
+    std::size_t memory_bytes() const { return nodes.capacity() * sizeof(node) + qnodes.capacity() * sizeof(qnode); }
+
+    // The one decoding the builder and the traversal share, so a child box
+    // checked conservative at compress() is the one the rays see
+    static real quantization_step(real min, real max) { return (max - min) * real(1.0 / 255) * real(1.00001); }
+    static real dequantize(real min, real step, std::uint8_t q) { return min + real(q) * step; }
+
+    // Visits the leaves the ray reaches before t_max, nearer child first.
+    // leaf(first, count, t_max) tests the primitives and lowers t_max on a
+    // closer hit; it returns true to stop the traversal (any-hit queries).
+    template <typename Leaf>
+    void traverse(const vec3& origin, const vec3& inv_direction, real t_max, Leaf&& leaf) const;
+
+private:
+    static bool hit_box(const real min[3], const real max[3], const real origin[3], const real inv_direction[3],
+                        real t_max, real& t_enter);
+    static bool hit_node(const node& n, const real origin[3], const real inv_direction[3], real t_max, real& t_enter) {
+        return hit_box(n.min, n.max, origin, inv_direction, t_max, t_enter);
+    }
+
+    template <typename Leaf>
+    void traverse_compressed(const real origin[3], const real inv_direction[3], real t_max, Leaf&& leaf) const;
+
+    std::vector<node> nodes;
+    std::vector<qnode> qnodes;      // Instead of nodes once compressed
+    aabb root_bounds;
+};
+
+inline bool bvh::hit_box(const real min[3], const real max[3], const real origin[3], const real inv_direction[3],
+                         real t_max, real& t_enter) {
+    real t0 = 0, t1 = t_max;
+    for (int axis = 0; axis < 3; ++axis) {
+        real near = (min[axis] - origin[axis]) * inv_direction[axis];
+        real far = (max[axis] - origin[axis]) * inv_direction[axis];
+        if (near > far) { real swap = near; near = far; far = swap; }
+        // Written so that a NaN (0 * inf on a slab plane) keeps the interval
+        t0 = near > t0 ? near : t0;
+        t1 = far < t1 ? far : t1;
+    }
+    t_enter = t0;
+    return t0 <= t1;
+}
+
+template <typename Leaf>
+void bvh::traverse(const vec3& origin, const vec3& inv_direction, real t_max, Leaf&& leaf) const {
+    const real o[3] = {origin.x, origin.y, origin.z};
+    const real inv[3] = {inv_direction.x, inv_direction.y, inv_direction.z};
+    if (compressed()) {
+        traverse_compressed(o, inv, t_max, leaf);
+        return;
+    }
+    if (nodes.empty()) return;
+
+    // Far children waiting, with the distance at which the ray enters them
+    struct pending { std::uint32_t node; real t_enter; };
+    pending stack[max_depth];
+    int depth = 0;
+    real t_enter;
+    if (!hit_node(nodes[0], o, inv, t_max, t_enter)) return;
+    std::uint32_t current = 0;
+    for (;;) {
+        const node& n = nodes[current];
+        if (n.count > 0) {
+            if (leaf(n.index, n.count, t_max)) return;
+        } else {
+            real t_left, t_right;
+            const bool left = hit_node(nodes[n.index], o, inv, t_max, t_left);
+            const bool right = hit_node(nodes[n.index + 1], o, inv, t_max, t_right);
+            if (left && right) {
+                const bool left_first = t_left <= t_right;
+                stack[depth++] = left_first ? pending{n.index + 1, t_right} : pending{n.index, t_left};
+                current = left_first ? n.index : n.index + 1;
+                continue;
+            }
+            if (left || right) {
+                current = left ? n.index : n.index + 1;
+                continue;
+            }
+        }
+        // Pop, skipping nodes that a closer hit has put out of reach
+        do {
+            if (depth == 0) return;
+            --depth;
+        } while (stack[depth].t_enter > t_max);
+        current = stack[depth].node;
+    }
+}
+
+// Same order as the full traversal. The box of a node is decoded from its
+// parent's record, so the stack keeps it with the node.
+template <typename Leaf>
+void bvh::traverse_compressed(const real origin[3], const real inv_direction[3], real t_max, Leaf&& leaf) const {
+    struct pending {
+        std::uint32_t child;
+        real t_enter;
+        real min[3], max[3];
+    };
+    pending stack[max_depth];
+    int depth = 0;
+    pending current{0, 0, {root_bounds.min[0], root_bounds.min[1], root_bounds.min[2]},
+                    {root_bounds.max[0], root_bounds.max[1], root_bounds.max[2]}};
+    if (!hit_box(current.min, current.max, origin, inv_direction, t_max, current.t_enter)) return;
+    for (;;) {
+        if (current.child & leaf_bit) {
+            const std::uint32_t first = current.child & (max_compressed_first - 1);
+            const std::uint32_t count = ((current.child & ~leaf_bit) >> 27) + 1;
+            if (leaf(first, count, t_max)) return;
+        } else {
+            const qnode& n = qnodes[current.child];
+            pending children[2];
+            bool hit[2];
+            for (int c = 0; c < 2; ++c) {
+                for (int axis = 0; axis < 3; ++axis) {
+                    const real step = quantization_step(current.min[axis], current.max[axis]);
+                    children[c].min[axis] = dequantize(current.min[axis], step, n.lo[c][axis]);
+                    children[c].max[axis] = dequantize(current.min[axis], step, n.hi[c][axis]);
+                }
+                children[c].child = n.child[c];
+                hit[c] = hit_box(children[c].min, children[c].max, origin, inv_direction, t_max, children[c].t_enter);
+            }
+            if (hit[0] && hit[1]) {
+                const int near = children[0].t_enter <= children[1].t_enter ? 0 : 1;
+                stack[depth++] = children[1 - near];
+                current = children[near];
+                continue;
+            }
+            if (hit[0] || hit[1]) {
+                current = children[hit[0] ? 0 : 1];
+                continue;
+            }
+        }
+        do {
+            if (depth == 0) return;
+            --depth;
+        } while (stack[depth].t_enter > t_max);
+        current = stack[depth];
+    }
+}
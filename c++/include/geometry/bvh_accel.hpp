@@ -0,0 +1,35 @@
+#pragma once
+#include "geometry/bvh.hpp"
+#include "geometry/hittable.hpp"
+#include <memory>
+#include <vector>
+
+class thread_pool;
+
+// Scene-level BVH over a list of hittables, itself a hittable: ray_color
+// then scans one object instead of the whole list. Objects without a
+// bounding box (infinite planes) are kept aside and tested after the tree,
+// with the distance it found.
+class bvh_accel : public hittable {
+public:
+    // quantized_nodes: bvh::compress() the tree (smaller nodes for huge
+    // scenes); kept full when the tree does not fit the compressed format
+    explicit bvh_accel(std::vector<std::shared_ptr<hittable>> objects, bool quantized_nodes = false);
+
+    // Linear BVH built on the pool (bvh::build_lbvh), for scenes rebuilt
+    // often: much faster to build, a little slower to trace
+    bvh_accel(std::vector<std::shared_ptr<hittable>> objects, thread_pool& pool, int code_bits = 30,
+              int treelet_rounds = 0);
+
+    bool hit(const vec3& ray_origin, const vec3& ray_direction, real t_max, hit_record& rec) const override;
+    bool bounding_box(aabb& box) const override;
+
+    std::size_t size() const { return bounded.size() + unbounded.size(); }
+    bool quantized() const { return tree.compressed(); }
+    std::size_t node_memory_bytes() const { return tree.memory_bytes(); }
+
+private:
+    std::vector<std::shared_ptr<hittable>> bounded;     // Leaf order
+    std::vector<std::shared_ptr<hittable>> unbounded;
+    bvh tree;
+};
@@ -0,0 +1,19 @@
+#pragma once
+#include "geometry/hittable.hpp"
+#include "core/vec3.hpp"
+#include "materials/material.hpp"
+#include <memory>
+
+// Flat disk of the given radius around center, facing normal. Bounded, so
+// accelerators cull it, unlike the infinite plane.
+class disk : public hittable {
+public:
+    disk(const vec3& center, const vec3& normal, real radius, std::shared_ptr<material> mat);
+
+    bool hit(const vec3& ray_origin, const vec3& ray_direction, real t_max, hit_record& rec) const override;
+    bool bounding_box(aabb& box) const override;
+
+private:
+    vec3 center, normal;
+    real radius;
+};
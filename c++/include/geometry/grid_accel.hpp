@@ -0,0 +1,56 @@
+#pragma once
+#include "geometry/hittable.hpp"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class thread_pool;
+
+// Uniform grid over a list of hittables, for scenes of many similar-sized
+// objects spread evenly (particles), where it builds in O(n) and a ray
+// walks the cells it crosses in order (3D-DDA, Amanatides & Woo) and stops
+// in the first cell holding a hit.
+//
+// The grid is hashed (Teschner et al., "Optimized Spatial Hashing", 2003):
+// only the object references are stored, in a table of about one bucket per
+// reference indexed by a hash of the cell coordinates, so empty space costs
+// nothing and the resolution is not limited by memory. Cells sharing a
+// bucket share their lists, which only costs extra tests.
+//
+// The resolution comes from the object count: about density cells per
+// object over the scene box (Wald et al., "Ray Tracing Animated Scenes using
+// Coherent Grid Traversal", 2006). Objects without a bounding box are kept
+// aside and tested after the grid, like bvh_accel.
+class grid_accel : public hittable {
+public:
+    static constexpr real default_density = 2;
+
+    grid_accel(std::vector<std::shared_ptr<hittable>> objects, thread_pool& pool, real density = default_density);
+
+    bool hit(const vec3& ray_origin, const vec3& ray_direction, real t_max, hit_record& rec) const override;
+    bool bounding_box(aabb& box) const override;
+
+    std::size_t size() const { return bounded.size() + unbounded.size(); }
+    const int* resolution() const { return cells; }
+    std::size_t reference_count() const { return references.size(); }
+
+    // Bytes of the bucket table and the reference lists
+    std::size_t memory_bytes() const {
+        return bucket_start.capacity() * sizeof(std::uint32_t) + references.capacity() * sizeof(std::uint32_t);
+    }
+
+private:
+    std::uint32_t bucket_of(int x, int y, int z) const {
+        return ((std::uint32_t(x) * 73856093u) ^ (std::uint32_t(y) * 19349663u) ^ (std::uint32_t(z) * 83492791u)) & bucket_mask;
+    }
+
+    std::vector<std::shared_ptr<hittable>> bounded;
+    std::vector<std::shared_ptr<hittable>> unbounded;
+    aabb bounds;
+    int cells[3] = {1, 1, 1};
+    real cell_size[3] = {1, 1, 1};
+    real inv_cell_size[3] = {1, 1, 1};
+    std::uint32_t bucket_mask = 0;
+    std::vector<std::uint32_t> bucket_start;    // Bucket b lists references[bucket_start[b] .. bucket_start[b + 1])
+    std::vector<std::uint32_t> references;      // Indices in bounded
+};
@@ -1,17 +1,44 @@
 #pragma once
 #include "core/vec3.hpp"
+#include "geometry/aabb.hpp"
 #include <memory>
 
 class material;
 
+// Result of a successful ray-object intersection
+struct hit_record {
+    real t;                  // Ray parameter of the hit
+    vec3 point;              // Hit point, refined onto the surface by the primitive
+    vec3 normal;             // Unit geometric normal (outward facing)
+    const material* mat;     // Material of the object that was hit
+    int object_id;           // Id of the object that was hit (-1 if none was given)
+};
+
 // Abstract base class for ray-intersectable objects
 class hittable {
 public:
     std::shared_ptr<material> mat;
-    static constexpr double epsilon = 0.001;
+    int object_id = -1;      // Copied into hit_record::object_id
+
+    // Tolerance for degenerate directions (parallel rays, zero-length scatter).
+    // Self-intersection is NOT handled with this constant anymore: secondary
+    // rays start from offset_ray_origin() and hits only need t > 0.
+    static constexpr real epsilon = real(0.001);
 
     virtual ~hittable() = default;
 
-    virtual double hit(const vec3& ray_origin, const vec3& ray_direction) = 0;
-    virtual vec3 get_normal(const vec3& hit_point) = 0;
+    // Closest hit with 0 < t < t_max. rec is only written on success.
+    virtual bool hit(const vec3& ray_origin, const vec3& ray_direction, real t_max, hit_record& rec) const = 0;
+
+    // World-space box around the object; false for unbounded objects
+    // (infinite planes), which acceleration structures must test apart
+    virtual bool bounding_box(aabb& /*box*/) const { return false; }
 };
+
+// Error-bounded origin for rays leaving a surface (Wächter & Binder,
+// "A Fast and Robust Method for Avoiding Self-Intersection", Ray Tracing Gems ch. 6).
+// The hit point is pushed along the normal, towards the side the new ray
+// travels to, by a fixed number of ULPs of each coordinate. The offset therefore
+// grows with the magnitude of the coordinates, so large scenes stay free of acne.
+// Near the origin, where ULPs get tiny, a small absolute offset is used instead.
+vec3 offset_ray_origin(const vec3& hit_point, const vec3& normal, const vec3& direction);
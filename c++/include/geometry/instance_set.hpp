@@ -0,0 +1,55 @@
+#pragma once
+#include "core/vec3.hpp"
+#include "geometry/affine.hpp"
+#include "geometry/bvh.hpp"
+#include "geometry/hittable.hpp"
+#include "materials/material.hpp"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Two-level acceleration: instances place shared geometry (usually a
+// triangle_mesh with its own BVH, the bottom level) in the world with an
+// affine transform, and a top-level BVH over the instance boxes finds the
+// instances a ray reaches. The geometry is stored once whatever the number
+// of instances; an instance costs its two matrices and three indices, and
+// about one top-level node.
+//
+// At an instance the ray is moved to object space without normalizing the
+// direction, so t means the same in both spaces and the closest-hit limit
+// carries over. The geometry must therefore accept non-unit directions
+// (triangle_mesh and sphere do). The hit point and normal are mapped back
+// to world space; the material and id are the instance's.
+class instance_set : public hittable {
+public:
+    // material: null keeps the one of the geometry
+    void add(std::shared_ptr<const hittable> geometry, const affine& world_from_object,
+             std::shared_ptr<material> material, int id = -1);
+
+    // Builds the top level; call once all instances are added. Instances
+    // whose geometry has no bounding box are dropped.
+    void build();
+
+    std::size_t size() const { return instances.size(); }
+    std::size_t geometry_count() const { return geometries.size(); }
+
+    // Bytes held by the instances and the top-level nodes (not the geometry)
+    std::size_t memory_bytes() const;
+
+    bool hit(const vec3& ray_origin, const vec3& ray_direction, real t_max, hit_record& rec) const override;
+    bool bounding_box(aabb& box) const override;
+
+private:
+    struct instance {
+        affine object_from_world;
+        affine world_from_object;
+        std::uint32_t geometry;     // In geometries
+        std::uint32_t material;     // In materials
+        int id;
+    };
+
+    std::vector<instance> instances;                            // Leaf order once built
+    std::vector<std::shared_ptr<const hittable>> geometries;    // One entry per distinct geometry
+    std::vector<std::shared_ptr<material>> materials;           // Likewise, may hold null
+    bvh tree;
+};
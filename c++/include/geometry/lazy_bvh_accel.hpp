@@ -0,0 +1,58 @@
+#pragma once
+#include "geometry/bvh.hpp"
+#include "geometry/hittable.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Scene-level BVH built on demand, for a first look at a huge scene without
+// waiting for the whole tree. The constructor only builds the top levels:
+// the objects are bucketed by centroid into a coarse uniform grid of about
+// cluster_size objects per cell (one counting sort, no per-level passes over
+// the scene), and a small SAH tree is built over the boxes of those
+// clusters. Each cluster gets its own SAH subtree the first time a ray
+// reaches it; clusters no ray reaches are never built.
+//
+// A subtree is built once under std::call_once: other threads reaching it
+// meanwhile wait, then all read the finished tree. The build then sets a
+// flag (release), and later rays only check it (acquire); a built subtree
+// never changes. Objects without a bounding box are kept aside and tested
+// after the tree, like bvh_accel.
+class lazy_bvh_accel : public hittable {
+public:
+    static constexpr std::uint32_t default_cluster_size = 1024;
+
+    explicit lazy_bvh_accel(std::vector<std::shared_ptr<hittable>> objects,
+                            std::uint32_t cluster_size = default_cluster_size);
+
+    bool hit(const vec3& ray_origin, const vec3& ray_direction, real t_max, hit_record& rec) const override;
+    bool bounding_box(aabb& box) const override;
+
+    std::size_t size() const { return bounded.size() + unbounded.size(); }
+    std::size_t cluster_count() const { return cluster_first.size(); }
+    std::size_t built_cluster_count() const { return built.load(std::memory_order_relaxed); }
+
+    // Bytes of the top nodes and of the subtrees built so far
+    std::size_t node_memory_bytes() const;
+
+private:
+    struct subtree {
+        std::once_flag once;
+        std::atomic<bool> ready{false};
+        bvh tree;
+        std::vector<const hittable*> objects;   // Leaf order of tree
+    };
+
+    const subtree& expand(std::uint32_t cluster) const;
+
+    std::vector<std::shared_ptr<hittable>> bounded;     // Grouped by cluster
+    std::vector<aabb> boxes;                            // Of bounded, for the subtree builds
+    std::vector<std::shared_ptr<hittable>> unbounded;
+    bvh top;                                            // Over the clusters, one per leaf
+    std::vector<std::uint32_t> cluster_first;           // In top leaf order; cluster c is
+    std::vector<std::uint32_t> cluster_length;          // bounded[first .. first + length)
+    std::unique_ptr<subtree[]> subtrees;                // One per cluster
+    mutable std::atomic<std::size_t> built{0};
+};
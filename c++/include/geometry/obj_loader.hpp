@@ -0,0 +1,22 @@
+#pragma once
+#include "core/vec3.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class thread_pool;
+
+// Geometry of a Wavefront OBJ file: the vertices ("v x y z") and the faces
+// ("f" with 1-based or negative indices, in any of the v, v/vt, v//vn and
+// v/vt/vn forms), polygons split in fans of triangles. Texture coordinates,
+// normals, groups and materials are skipped.
+struct obj_mesh {
+    std::vector<real> positions;            // x, y, z per vertex
+    std::vector<std::uint32_t> indices;     // Three vertex indices per triangle
+};
+
+// The file is read whole and cut in chunks at line ends. The chunks are
+// parsed on the pool twice: a first pass counts their vertices and
+// triangles, which gives each chunk where its output starts, and the second
+// writes them there. False with error set on I/O or syntax errors.
+bool load_obj(const std::string& path, obj_mesh& mesh, thread_pool& pool, std::string& error);
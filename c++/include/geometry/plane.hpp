@@ -12,6 +12,5 @@ public:
 
     plane(const vec3& anchor, const vec3& normal, std::shared_ptr<material> mat);
 
-    double hit(const vec3& ray_origin, const vec3& ray_direction) override;
-    vec3 get_normal(const vec3& hit_point) override;
+    bool hit(const vec3& ray_origin, const vec3& ray_direction, real t_max, hit_record& rec) const override;
 };
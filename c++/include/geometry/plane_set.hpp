@@ -0,0 +1,23 @@
+#pragma once
+#include "core/vec3.hpp"
+#include "core/kernels.hpp"
+#include "geometry/hittable.hpp"
+#include "materials/material.hpp"
+#include <memory>
+#include <vector>
+
+// Many infinite planes stored in structure-of-arrays layout and intersected
+// together by the dispatched hit_planes kernel (core/cpu_dispatch.hpp)
+class plane_set : public hittable {
+public:
+    void add(const vec3& anchor, const vec3& normal, std::shared_ptr<material> material, int id = -1);
+    std::size_t size() const { return materials.size(); }
+
+    bool hit(const vec3& ray_origin, const vec3& ray_direction, real t_max, hit_record& rec) const override;
+
+private:
+    std::vector<real> anchor_x, anchor_y, anchor_z;
+    std::vector<real> normal_x, normal_y, normal_z;
+    std::vector<std::shared_ptr<material>> materials;
+    std::vector<int> ids;
+};
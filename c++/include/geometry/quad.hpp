@@ -0,0 +1,22 @@
+#pragma once
+#include "geometry/hittable.hpp"
+#include "core/vec3.hpp"
+#include "materials/material.hpp"
+#include <memory>
+
+// Finite rectangle: center +- edge_u / 2 +- edge_v / 2, the two edges
+// orthogonal. The normal is edge_u x edge_v, so a floor tile has edge_u
+// along z and edge_v along x.
+// Unlike the infinite plane it has a bounding box, so accelerators cull it.
+class quad : public hittable {
+public:
+    quad(const vec3& center, const vec3& edge_u, const vec3& edge_v, std::shared_ptr<material> mat);
+
+    bool hit(const vec3& ray_origin, const vec3& ray_direction, real t_max, hit_record& rec) const override;
+    bool bounding_box(aabb& box) const override;
+
+private:
+    vec3 center, edge_u, edge_v;
+    vec3 normal;
+    vec3 dual_u, dual_v;    // edge / |edge|^2: the hit's coordinates along the edges, in [-0.5, 0.5] inside
+};
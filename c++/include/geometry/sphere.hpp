@@ -8,12 +8,17 @@
 class sphere : public hittable {
 public:
     vec3 origin;
-    double radius;
+    real radius;
 
-    sphere(vec3 origin, double radius, std::shared_ptr<material> material);
+    sphere(vec3 origin, real radius, std::shared_ptr<material> material);
 
-    double hit(const vec3& ray_origin, const vec3& ray_direction) override;
-    vec3 get_normal(const vec3& hit_point) override;
+    bool hit(const vec3& ray_origin, const vec3& ray_direction, real t_max, hit_record& rec) const override;
+    bool bounding_box(aabb& box) const override;
+
+    // Fill rec for a hit at t (re-projects the point onto the surface).
+    // Shared with sphere_set, which finds t with the dispatched kernel.
+    static void fill_record(const vec3& center, real radius, const material* mat,
+                            const vec3& ray_origin, const vec3& ray_direction, real t, hit_record& rec);
 };
 
 
@@ -0,0 +1,30 @@
+#pragma once
+#include "core/vec3.hpp"
+#include "core/kernels.hpp"
+#include "geometry/hittable.hpp"
+#include "materials/material.hpp"
+#include <memory>
+#include <vector>
+
+// Many spheres stored in structure-of-arrays layout and intersected together
+// by the dispatched kernels (core/cpu_dispatch.hpp). Spheres are grouped in
+// blocks of insertion order; a block is skipped when the ray misses its box.
+class sphere_set : public hittable {
+public:
+    void add(const vec3& center, real radius, std::shared_ptr<material> material, int id = -1);
+    std::size_t size() const { return radius.size(); }
+
+    bool hit(const vec3& ray_origin, const vec3& ray_direction, real t_max, hit_record& rec) const override;
+    bool bounding_box(aabb& box) const override;
+
+    static constexpr std::size_t block_size = 64;
+
+private:
+    std::vector<real> center_x, center_y, center_z, radius;
+    std::vector<std::shared_ptr<material>> materials;
+    std::vector<int> ids;
+
+    // Bounding box of each block of block_size spheres
+    std::vector<real> block_min_x, block_min_y, block_min_z;
+    std::vector<real> block_max_x, block_max_y, block_max_z;
+};
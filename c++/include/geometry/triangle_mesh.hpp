@@ -0,0 +1,44 @@
+#pragma once
+#include "core/vec3.hpp"
+#include "geometry/bvh.hpp"
+#include "geometry/hittable.hpp"
+#include "materials/material.hpp"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Indexed triangle mesh: one shared vertex buffer, three vertex indices per
+// triangle and a BVH over the triangles, whose leaves index the triangle
+// array directly (it is reordered at build). Memory per triangle is about
+// 12 bytes of indices, 6 of positions (a closed mesh has half as many
+// vertices as triangles) and 16 of BVH nodes, in float.
+//
+// Triangles are tested with the watertight algorithm of Woop, Benthin and
+// Wald (JCGT 2013): a ray through a shared edge or vertex hits one of the
+// triangles around it, never none. The normal is the geometric one, from
+// the winding (counter-clockwise seen from outside, as in OBJ files).
+class triangle_mesh : public hittable {
+public:
+    // positions: x, y, z per vertex; indices: three vertex indices per triangle
+    triangle_mesh(std::vector<real> positions, std::vector<std::uint32_t> indices,
+                  std::shared_ptr<material> material, int id = -1);
+
+    bool hit(const vec3& ray_origin, const vec3& ray_direction, real t_max, hit_record& rec) const override;
+    bool bounding_box(aabb& box) const override;
+
+    std::size_t vertex_count() const { return positions.size() / 3; }
+    std::size_t triangle_count() const { return indices.size() / 3; }
+    const aabb& bounds() const { return tree.bounds(); }
+
+    // Bytes held by the vertex, index and node arrays
+    std::size_t memory_bytes() const;
+
+private:
+    vec3 vertex(std::uint32_t index) const {
+        return vec3(positions[3 * index], positions[3 * index + 1], positions[3 * index + 2]);
+    }
+
+    std::vector<real> positions;
+    std::vector<std::uint32_t> indices;
+    bvh tree;
+};
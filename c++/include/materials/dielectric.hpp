@@ -3,23 +3,19 @@
 
 #include "materials/material.hpp"
 #include "core/vec3.hpp"
+#include "core/random.hpp"
 #include <cmath>     
-#include <random>   
 
-// Forward declarations - these are implemented in vec3.cpp and ray_color.cpp
-bool refract(const vec3& v_in_normalized, const vec3& n, double ior_ratio, vec3& refracted_direction);
-double reflectance(double cosine, double ref_idx_ratio);
-vec3 reflect(const vec3& v_in, const vec3& normal);
-
-extern std::mt19937 generator; 
-extern std::uniform_real_distribution<double> distribution;
+// Forward declarations - these are implemented in ray_color.cpp (reflect is in vec3.hpp)
+bool refract(const vec3& v_in_normalized, const vec3& n, real ior_ratio, vec3& refracted_direction);
+real reflectance(real cosine, real ref_idx_ratio);
 
 class dielectric : public material {
 public:
-    double ior; 
+    real ior; 
     vec3 teint;
 
-    dielectric(double index_of_refraction, vec3 teint) : ior(index_of_refraction), teint(teint) {}
+    dielectric(real index_of_refraction, vec3 teint) : ior(index_of_refraction), teint(teint) {}
 
     virtual bool scatter(
         const vec3& ray_in,
@@ -36,17 +32,17 @@ public:
         // Check if ray is entering or exiting
         bool front_face = unit_direction.dot(hit_normal) < 0;
         vec3 outward_normal = front_face ? hit_normal : (vec3(0,0,0) - hit_normal);
-        double etai_over_etat = front_face ? (1.0 / ior) : ior;
+        real etai_over_etat = front_face ? (1 / ior) : ior;
 
         // Calculate cos_theta
-        double cos_theta = std::min((vec3(0,0,0) - unit_direction).dot(outward_normal), 1.0);
-        double sin_theta = std::sqrt(1.0 - cos_theta * cos_theta);
+        real cos_theta = std::min((vec3(0,0,0) - unit_direction).dot(outward_normal), real(1));
+        real sin_theta = std::sqrt(1 - cos_theta * cos_theta);
 
         // Check for total internal reflection
-        bool cannot_refract = etai_over_etat * sin_theta > 1.0;
+        bool cannot_refract = etai_over_etat * sin_theta > 1;
 
         // Use Schlick's approximation for reflectance
-        double reflect_prob = reflectance(cos_theta, etai_over_etat);
+        real reflect_prob = reflectance(cos_theta, etai_over_etat);
 
         if (cannot_refract || reflect_prob > distribution(generator)) {
             // Reflect
@@ -60,4 +56,7 @@ public:
 
         return true;
     }
+
+    vec3 base_color() const override { return teint; }
+    bool is_specular() const override { return true; }
 };
@@ -2,8 +2,6 @@
 #include "materials/material.hpp"
 #include "core/vec3.hpp"
 
-vec3 random_unit_vector();
-
 // Diffuse (Lambertian) material - scatters light randomly
 class diffuse : public material {
 public:
@@ -24,9 +22,11 @@ public:
         if (scattered_direction.length_squared() < hittable::epsilon * hittable::epsilon)
             scattered_direction = hit_normal;
         else
-            scattered_direction = scattered_direction.normalize();
+            scattered_direction = scattered_direction.normalize_fast();
 
         attenuation = albedo;
         return true;
     }
+
+    vec3 base_color() const override { return albedo; }
 };
@@ -8,9 +8,9 @@
 class emissive : public material {
 public:
     vec3 emission_color;      // Color of emitted light
-    double emission_strength; // Intensity multiplier (can be > 1.0 for HDR)
+    real emission_strength;   // Intensity multiplier (can be > 1.0 for HDR)
 
-    emissive(const vec3& color, double strength = 1.0) 
+    emissive(const vec3& color, real strength = 1) 
         : emission_color(color), emission_strength(strength) {}
 
     // Emissive materials absorb all incoming rays (act as pure light sources)
@@ -31,4 +31,6 @@ public:
     vec3 emitted() const {
         return emission_color * emission_strength;
     }
+
+    vec3 base_color() const override { return emission_color; }
 };
@@ -5,6 +5,8 @@
 // Abstract base class for materials
 class material {
 public:
+    int id = -1;  // Set by the scene loader, written to the material id AOV
+
     virtual ~material() = default;
     
     virtual bool scatter(
@@ -19,4 +21,12 @@ public:
     virtual vec3 emitted() const {
         return vec3(0.0, 0.0, 0.0);
     }
+
+    // Surface color for the albedo AOV (core/aov.hpp)
+    virtual vec3 base_color() const = 0;
+
+    // Perfect mirrors and glass: the AOVs describe what is seen through them
+    virtual bool is_specular() const {
+        return false;
+    }
 };
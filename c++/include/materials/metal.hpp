@@ -1,16 +1,13 @@
 #pragma once
 #include "materials/material.hpp"
 
-vec3 random_in_unit_sphere();
-vec3 reflect(const vec3& v_in, const vec3& normal);
-
 // Metal material - reflects light with optional roughness
 class metal : public material {
 public:
     vec3 albedo;
-    double roughness;
+    real roughness;
 
-    metal(const vec3& a, double r) : albedo(a), roughness((r < 1.0) ? r : 1.0) {}
+    metal(const vec3& a, real r) : albedo(a), roughness((r < 1) ? r : 1) {}
 
     virtual bool scatter(
         const vec3& ray_in,
@@ -20,9 +17,12 @@ public:
         vec3& scattered_direction
     ) const override {
         vec3 reflected_direction = reflect(ray_in.normalize(), hit_normal);
-        scattered_direction = (reflected_direction + (random_in_unit_sphere() * roughness)).normalize();
+        scattered_direction = (reflected_direction + (random_in_unit_sphere() * roughness)).normalize_fast();
 
         attenuation = albedo;
         return (scattered_direction.dot(hit_normal) > 0.0);
     }
+
+    vec3 base_color() const override { return albedo; }
+    bool is_specular() const override { return roughness <= 0; }
 };
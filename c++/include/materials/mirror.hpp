@@ -18,10 +18,13 @@ public:
     ) const override {
         // Perfect reflection: reflect = in - 2 * dot(in, normal) * normal
         vec3 ray_direction = ray_in.normalize();
-        double dot_product = ray_direction.dot(hit_normal);
-        scattered_direction = ray_direction - hit_normal * (2.0 * dot_product);
+        real dot_product = ray_direction.dot(hit_normal);
+        scattered_direction = ray_direction - hit_normal * (2 * dot_product);
         
         attenuation = tint;
         return true;
     }
+
+    vec3 base_color() const override { return tint; }
+    bool is_specular() const override { return true; }
 };
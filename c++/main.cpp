@@ -7,19 +7,33 @@
 #include <random>
 #include <cmath>
 #include <filesystem>
-#include "../external/nlohmann/json.hpp"
-
-
-using json = nlohmann::json;
-
+#include <chrono>
+#include <map>
 #include "core/vec3.hpp"
 #include "core/camera.hpp"
 #include "core/light.hpp"
 #include "geometry/hittable.hpp"
 #include "core/ray_color.hpp"
-#include "core/denoise.hpp"
+#include "core/post_process.hpp"
+#include "core/cpu_dispatch.hpp"
+#include "core/image_io.hpp"
+#include "core/thread_pool.hpp"
+#include "core/random.hpp"
+#include "core/checkpoint.hpp"
+#include "core/aov.hpp"
+#include "core/scene_desc.hpp"
 #include "geometry/sphere.hpp"
 #include "geometry/plane.hpp"
+#include "geometry/sphere_set.hpp"
+#include "geometry/plane_set.hpp"
+#include "geometry/quad.hpp"
+#include "geometry/disk.hpp"
+#include "geometry/triangle_mesh.hpp"
+#include "geometry/instance_set.hpp"
+#include "geometry/bvh_accel.hpp"
+#include "geometry/grid_accel.hpp"
+#include "geometry/lazy_bvh_accel.hpp"
+#include "geometry/obj_loader.hpp"
 #include "materials/material.hpp"
 #include "materials/diffuse.hpp"
 #include "materials/metal.hpp"
@@ -27,11 +41,6 @@ using json = nlohmann::json;
 #include "materials/emissive.hpp"
 #include "materials/mirror.hpp"
 
-// Global random number generator for all materials
-std::random_device rd;
-std::mt19937 generator(rd());
-std::uniform_real_distribution<double> distribution(0.0, 1.0);
-
 // ==================== USER INPUT INTERFACE ====================
 
 void display_menu() {
@@ -76,207 +85,348 @@ void show_progress_bar(int current, int total) {
               << current << "/" << total << ")" << std::flush;
 }
 
-vec3 aces_tonemap(const vec3& color) {
-    // ACES filmic tone mapping curve
-    // Reference: Narkowicz 2015 "ACES Filmic Tone Mapping Curve"
-    const double a = 2.51;
-    const double b = 0.03;
-    const double c = 2.43;
-    const double d = 0.59;
-    const double e = 0.14;
-    
-    vec3 x = color;
-    vec3 numerator = x * (x * a + b);
-    vec3 denominator = x * (x * c + d) + e;
-    
-    return vec3(
-        numerator.x / denominator.x,
-        numerator.y / denominator.y,
-        numerator.z / denominator.z
-    );
-}
 // ==================== END USER INTERFACE ====================
 
-int main() {
+int main(int argc, char** argv) {
+
+    // Command line:
+    //   --scene <file.json|file.rscn>             scene to render (default src/data/save/sun_demo.json)
+    //   --convert <file.rscn>                     write the scene as a binary scene file and exit
+    //   --isa <auto|baseline|sse4.2|avx2|avx512>  forces a kernel variant
+    //   --accel <mode>                            scene acceleration: linear (default, grouped SIMD scans),
+    //                                             bvh, bvh-quantized, grid, lazy (BVH built where rays go),
+    //                                             lbvh, lbvh-treelets (Morton-code BVH built on every thread)
+    //   --hdr                                     also write the linear buffer to <output>.pfm
+    //   --aov                                     also write the first-hit buffers (<output>.albedo.pfm, ...)
+    //   --save-buffers                            both, what --post-only reloads
+    //   --post-only                               reload the saved buffers and only redo the post-processing
+    //   --output <file.ppm|file.png|file.qoi>     output image, format from the extension
+    //   --stream                                  write rows as they finish (bounded memory, no denoise)
+    //   --seed <n>                                random seed (the image only depends on it)
+    //   --checkpoint <file>                       save progress to file during the render
+    //   --checkpoint-interval <seconds>           time between two saves (default 300)
+    //   --resume                                  continue from the checkpoint (default render.ckpt)
+    std::string scene_file = "src/data/save/sun_demo.json";
+    std::string convert_path;
+    isa requested_isa = isa::automatic;
+    std::string accel = "linear";
+    bool write_hdr = false;
+    bool write_aov = false;
+    bool post_only = false;
+    std::string output_path = "image.ppm";
+    bool stream_output = false;
+    bool seed_given = false;
+    std::uint64_t seed = 0;
+    std::string checkpoint_path;
+    double checkpoint_interval = 300.0;
+    bool resume = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--hdr") {
+            write_hdr = true;
+        } else if (arg == "--aov") {
+            write_aov = true;
+        } else if (arg == "--save-buffers") {
+            write_hdr = true;
+            write_aov = true;
+        } else if (arg == "--post-only") {
+            post_only = true;
+        } else if (arg == "--stream") {
+            stream_output = true;
+        } else if (arg == "--resume") {
+            resume = true;
+        } else if (arg == "--scene" && i + 1 < argc) {
+            scene_file = argv[++i];
+        } else if (arg == "--convert" && i + 1 < argc) {
+            convert_path = argv[++i];
+        } else if (arg == "--checkpoint" && i + 1 < argc) {
+            checkpoint_path = argv[++i];
+        } else if ((arg == "--checkpoint-interval" || arg == "--seed") && i + 1 < argc) {
+            std::string value = argv[++i];
+            try {
+                if (arg == "--seed") {
+                    seed = std::stoull(value);
+                    seed_given = true;
+                } else {
+                    checkpoint_interval = std::stod(value);
+                }
+            } catch (...) {
+                std::cerr << "Invalid " << arg << " value '" << value << "'\n";
+                return 1;
+            }
+        } else if (arg == "--output" && i + 1 < argc) {
+            output_path = argv[++i];
+            image_io::format output_format;
+            if (!image_io::format_from_path(output_path, output_format)) {
+                std::cerr << "Unsupported output '" << output_path << "' (expected .ppm, .png or .qoi)\n";
+                return 1;
+            }
+        } else if (arg == "--isa" && i + 1 < argc) {
+            if (!parse_isa(argv[++i], requested_isa)) {
+                std::cerr << "Unknown --isa value '" << argv[i] << "' (auto, baseline, sse4.2, avx2, avx512)\n";
+                return 1;
+            }
+        } else if (arg == "--accel" && i + 1 < argc) {
+            accel = argv[++i];
+            if (accel != "linear" && accel != "bvh" && accel != "bvh-quantized" && accel != "grid" && accel != "lazy" &&
+                accel != "lbvh" && accel != "lbvh-treelets") {
+                std::cerr << "Unknown --accel value '" << accel
+                          << "' (linear, bvh, bvh-quantized, grid, lazy, lbvh, lbvh-treelets)\n";
+                return 1;
+            }
+        } else {
+            std::cerr << "Unknown argument '" << arg << "'\n";
+            std::cerr << "Usage: " << argv[0] << " [--scene file.json|file.rscn] [--convert file.rscn]"
+                      << " [--isa auto|baseline|sse4.2|avx2|avx512] [--accel linear|bvh|bvh-quantized|grid|lazy|lbvh|lbvh-treelets]"
+                      << " [--hdr] [--aov] [--save-buffers]"
+                      << " [--post-only] [--output image.png] [--stream]"
+                      << " [--seed n] [--checkpoint file] [--checkpoint-interval s] [--resume]\n";
+            return 1;
+        }
+    }
+
+    // The linear buffer and the AOVs go next to the output (image.png:
+    // image.pfm, image.albedo.pfm, ...), which is where --post-only reloads
+    // them from
+    const std::string stem = std::filesystem::path(output_path).replace_extension().string();
+    const std::string hdr_path = stem + ".pfm";
+    if (post_only && stream_output) {
+        std::cerr << "--post-only and --stream cannot be combined\n";
+        return 1;
+    }
 
     // Display menu
     display_menu();
-    
-    std::string scene_file = "src/data/save/sun_demo.json";
-    std::ifstream ifs(scene_file);
 
-    if (!ifs.is_open()) {
-        std::cerr << "Error: Unable to open file " << scene_file << std::endl;
+    // Pick the hot kernels for this CPU
+    isa chosen_isa = select_kernels(requested_isa);
+    std::cout << "⚙️  CPU kernels: " << isa_name(chosen_isa)
+              << " (detected: " << isa_name(detect_isa())
+              << ", requested: " << isa_name(requested_isa) << ")\n" << std::flush;
+    
+    // JSON from the editor, or binary (.rscn) mapped and used in place
+    auto scene_start = std::chrono::steady_clock::now();
+    scene_desc desc;
+    std::string load_error;
+    if (!load_scene(scene_file, desc, load_error)) {
+        std::cerr << "Error: " << load_error << std::endl;
         std::cerr << "Please create a scene with the editor and save it before launching the raytracer.\n";
         return 1;
     }
-    json scene_data;
-    try {
-        
-        ifs >> scene_data;
-    } catch (json::parse_error& e) {
-        std::cerr << "JSON parsing error: " << e.what() << std::endl;
-        ifs.close(); 
-        return 1; 
+    double scene_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - scene_start).count();
+    std::cout << "📂 Scene '" << scene_file << "': " << desc.objects.size << " objects, " << desc.meshes.size
+              << " meshes, " << desc.materials.size
+              << " materials, loaded in " << scene_ms << " ms\n" << std::flush;
+
+    if (!convert_path.empty()) {
+        if (!save_scene_binary(convert_path, desc)) {
+            std::cerr << "Error: Unable to write " << convert_path << "\n";
+            return 1;
+        }
+        std::cout << "✓ Binary scene saved as '" << convert_path << "'\n";
+        return 0;
     }
 
-    ifs.close();
-
     // Load scene data into the rendering engine
-    int image_width = scene_data["render"]["image_width"];
-    int image_height = scene_data["render"]["image_height"];
-    int samples_per_pixel = scene_data["render"]["samples_per_pixel"];
-    int max_depth = scene_data["render"]["max_depth"];
-    int num_threads = scene_data["render"]["num_threads"];
-    double gamma = scene_data["render"]["gamma"];
-    
-    // Ambient light control (default 1.0 if not in JSON)
-    double ambient_light = 1.0;
-    if (scene_data["render"].contains("ambient_light")) {
-        ambient_light = scene_data["render"]["ambient_light"];
-    }
-    
-    // Sun intensity control (default 0.0 if not in JSON = no sun)
-    double sun_intensity = 0.0;
-    if (scene_data["render"].contains("sun_intensity")) {
-        sun_intensity = scene_data["render"]["sun_intensity"];
-    }
-    
-    // Sun direction (default: coming from above-right)
-    vec3 sun_direction(0.5, -1.0, 0.3);  // Direction FROM which sun light comes
-    if (scene_data["render"].contains("sun_direction")) {
-        sun_direction.x = scene_data["render"]["sun_direction"]["x"];
-        sun_direction.y = scene_data["render"]["sun_direction"]["y"];
-        sun_direction.z = scene_data["render"]["sun_direction"]["z"];
-    }
-    
-    // Denoise settings (default: disabled)
-    bool enable_denoise = false;
-    int denoise_type = 1;  // 0=Box, 1=Gaussian, 2=Bilateral
-    float denoise_strength = 1.0f;
-    if (scene_data["render"].contains("enable_denoise")) {
-        enable_denoise = scene_data["render"]["enable_denoise"];
-    }
-    if (scene_data["render"].contains("denoise_type")) {
-        denoise_type = scene_data["render"]["denoise_type"];
-    }
-    if (scene_data["render"].contains("denoise_strength")) {
-        denoise_strength = scene_data["render"]["denoise_strength"];
-    }
+    const render_settings& settings = desc.render;
+    int image_width = settings.image_width;
+    int image_height = settings.image_height;
+    int samples_per_pixel = settings.samples_per_pixel;
+    int max_depth = settings.max_depth;
+    thread_pool pool(settings.num_threads);
+    double gamma = settings.gamma;
+    double exposure = settings.exposure;
+    double ambient_light = settings.ambient_light;
+    double sun_intensity = settings.sun_intensity;
+    vec3 sun_direction(settings.sun_direction[0], settings.sun_direction[1], settings.sun_direction[2]);
+    bool enable_denoise = settings.enable_denoise != 0;
+    int denoise_type = settings.denoise_type;
+    float denoise_strength = settings.denoise_strength;
+
+    // Post-processing on the linear frame: denoise, then exposure, tonemap,
+    // gamma and quantization fused in one pass (core/post_process.hpp), and
+    // the output file (PPM, PNG or QOI from the extension, one write)
+    auto post_process_and_write = [&](std::vector<vec3>& frame, int width, int height, const aov::frame* guides) {
+        post::pipeline post_process;
+        if (enable_denoise) post_process.denoise(denoise_type, denoise_strength, guides, samples_per_pixel);
+        post_process.exposure(real(exposure)).tonemap().gamma(real(gamma)).quantize();
+        std::vector<std::uint8_t> rgb;
+        post_process.run(frame, width, height, pool, rgb);
+        std::cout << "\n\n🔧 Post-processing:";
+        for (const post::pass_timing& pass : post_process.timings()) std::cout << " " << pass.name << " " << pass.ms << " ms";
+        std::cout << "\n";
+
+        auto write_start = std::chrono::steady_clock::now();
+        if (!image_io::write_image(output_path, rgb, width, height, pool)) {
+            std::cerr << "\nError: Unable to write " << output_path << "\n";
+            return false;
+        }
+        double write_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - write_start).count();
+        std::cout << "\n✓ Image saved as '" << output_path << "' (written in " << write_ms << " ms)\n";
+        return true;
+    };
+
+    // Only the post-processing settings of the scene are used: the frame
+    // and the guides come from the buffers of the last render
+    if (post_only) {
+        auto load_start = std::chrono::steady_clock::now();
+        std::vector<vec3> frame;
+        int width = 0, height = 0;
+        if (!image_io::read_pfm(hdr_path, frame, width, height)) {
+            std::cerr << "Error: Unable to read " << hdr_path << " (render once with --save-buffers first)\n";
+            return 1;
+        }
+        aov::frame guides;
+        const bool guided = enable_denoise && denoise_type == 4;
+        if (guided && !aov::read_files(stem, width, height, guides)) {
+            std::cerr << "Error: Unable to read the AOV files " << stem << ".*.pfm needed by the à-trous denoiser"
+                      << " (render once with --save-buffers first)\n";
+            return 1;
+        }
+        double load_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - load_start).count();
+        std::cout << "📂 Loaded '" << hdr_path << "'" << (guided ? " and the AOVs" : "") << " (" << width << "x" << height
+                  << ") in " << load_ms << " ms" << std::flush;
 
-    vec3 lookfrom(
-        scene_data["camera"]["origin"]["x"],
-        scene_data["camera"]["origin"]["y"],
-        scene_data["camera"]["origin"]["z"]
-    );
-    vec3 lookat(
-        scene_data["camera"]["look_at"]["x"],
-        scene_data["camera"]["look_at"]["y"],
-        scene_data["camera"]["look_at"]["z"]
-    );
-    vec3 vup(
-        scene_data["camera"]["up"]["x"],
-        scene_data["camera"]["up"]["y"],
-        scene_data["camera"]["up"]["z"]
-    );
-    double vfov = scene_data["camera"]["fov"];
-    double aspect_ratio = scene_data["camera"]["aspect_ratio"];
-    
-    // Depth of field parameters
-    double aperture = 0.0;
-    double focus_distance = 10.0;
-    if (scene_data["camera"].contains("aperture")) {
-        aperture = scene_data["camera"]["aperture"];
-    }
-    if (scene_data["camera"].contains("focus_distance")) {
-        focus_distance = scene_data["camera"]["focus_distance"];
+        return post_process_and_write(frame, width, height, guided ? &guides : nullptr) ? 0 : 1;
     }
 
-    Camera camera(lookfrom, lookat, vup, vfov, aspect_ratio, aperture, focus_distance);
-    
-    std::vector<std::shared_ptr<hittable>> scene_objects;
-    for (auto& obj : scene_data["objects"]) {
-        std::string type = obj["type"];
-        vec3 center(
-            obj["position"]["x"],
-            obj["position"]["y"],
-            obj["position"]["z"]
-        );
-        
-        // Object color (always in obj["color"])
-        vec3 color(
-            obj["color"]["r"],
-            obj["color"]["g"],
-            obj["color"]["b"]
-        );
-        
+    const camera_settings& view = desc.camera;
+    Camera camera(vec3(view.origin[0], view.origin[1], view.origin[2]),
+                  vec3(view.look_at[0], view.look_at[1], view.look_at[2]),
+                  vec3(view.up[0], view.up[1], view.up[2]),
+                  view.fov, view.aspect_ratio, view.aperture, view.focus_distance);
+
+    // One material object per record, shared by the objects using it; its id
+    // (the record index) and the object ids only feed the AOV buffers.
+    // Spheres and planes are grouped so the dispatched kernels test them
+    // together, unless an accelerator takes the spheres one by one.
+    std::vector<std::shared_ptr<material>> materials;
+    materials.reserve(desc.materials.size);
+    for (const material_record& record : desc.materials) {
+        vec3 color(record.color[0], record.color[1], record.color[2]);
         std::shared_ptr<material> mat;
-        std::string mat_type = obj["material"];
-        
-        if (mat_type == "Diffus") {
-            mat = std::make_shared<diffuse>(color);
-        } else if (mat_type == "Métal") {
-            double fuzz = obj.contains("roughness") ? double(obj["roughness"]) : 0.0;
-            mat = std::make_shared<metal>(color, fuzz);
-        } else if (mat_type == "Verre") {
-            double ir = obj.contains("refraction_index") ? double(obj["refraction_index"]) : 1.5;
-            mat = std::make_shared<dielectric>(ir, color);
-        } else if (mat_type == "Néon" || mat_type == "Neon" || mat_type == "Emissive") {
-            double strength = obj.contains("emission_strength") ? double(obj["emission_strength"]) : 5.0;
-            mat = std::make_shared<emissive>(color, strength);
-        } else if (mat_type == "Miroir" || mat_type == "Mirror") {
-            mat = std::make_shared<mirror>(color);
-        } else {
-            // Default material if unknown
-            mat = std::make_shared<diffuse>(color);
+        switch (record.kind) {
+            case material_kind::metal: mat = std::make_shared<metal>(color, real(record.parameter)); break;
+            case material_kind::dielectric: mat = std::make_shared<dielectric>(real(record.parameter), color); break;
+            case material_kind::emissive: mat = std::make_shared<emissive>(color, real(record.parameter)); break;
+            case material_kind::mirror: mat = std::make_shared<mirror>(color); break;
+            default: mat = std::make_shared<diffuse>(color); break;
         }
+        mat->id = static_cast<int>(materials.size());
+        materials.push_back(mat);
+    }
 
-        if (type == "Sphère") {
-            double radius = obj["size"];
-            scene_objects.push_back(std::make_shared<sphere>(center, radius, mat));
-        } else if (type == "Plan") {
+    std::vector<std::shared_ptr<hittable>> scene_objects;
+    auto spheres = std::make_shared<sphere_set>();
+    auto planes = std::make_shared<plane_set>();
+    for (const object_record& record : desc.objects) {
+        vec3 center(record.position[0], record.position[1], record.position[2]);
+        if (record.shape == shape_kind::sphere && accel != "linear") {
+            auto single = std::make_shared<sphere>(center, real(record.size), materials[record.material]);
+            single->object_id = record.id;
+            scene_objects.push_back(single);
+        } else if (record.shape == shape_kind::sphere) {
+            spheres->add(center, real(record.size), materials[record.material], record.id);
+        } else if (record.shape == shape_kind::quad) {
+            // Square of side size facing up, its edges turned by rotate_y
+            const real angle = real(record.rotate_y * 3.14159265358979323846 / 180.0);
+            const real side = real(record.size), cos_a = std::cos(angle), sin_a = std::sin(angle);
+            auto tile = std::make_shared<quad>(center, vec3(sin_a, 0, cos_a) * side, vec3(cos_a, 0, -sin_a) * side,
+                                               materials[record.material]);
+            tile->object_id = record.id;
+            scene_objects.push_back(tile);
+        } else if (record.shape == shape_kind::disk) {
+            auto plate = std::make_shared<disk>(center, vec3(0, 1, 0), real(record.size) / 2, materials[record.material]);
+            plate->object_id = record.id;
+            scene_objects.push_back(plate);
+        } else {
             vec3 normal(0.0, 1.0, 0.0); // Default normal pointing up
-            scene_objects.push_back(std::make_shared<plane>(center, normal, mat));
+            planes->add(center, normal, materials[record.material], record.id);
         }
     }
-    
-
-    // Load point lights from JSON
-
-    std::vector<PointLight> lights;
-
-    if (scene_data.contains("lights")) {
-
-        for (auto& light_json : scene_data["lights"]) {
-
-            vec3 position(
-
-                light_json["position"]["x"],
-
-                light_json["position"]["y"],
-
-                light_json["position"]["z"]
-
-            );
-
-            vec3 color(
-
-                light_json["color"]["r"],
-
-                light_json["color"]["g"],
-
-                light_json["color"]["b"]
-
-            );
-
-            float intensity = light_json["intensity"];
-
-            lights.push_back(PointLight(position, color, intensity));
 
+    if (spheres->size() > 0) scene_objects.push_back(spheres);
+    if (planes->size() > 0) scene_objects.push_back(planes);
+
+    // Meshes: each OBJ file is parsed once on the pool and kept in object
+    // space with its own BVH; every record referencing it becomes an
+    // instance (scale, rotate_y, then translation) in one top-level BVH
+    std::map<std::string, std::shared_ptr<const triangle_mesh>> mesh_files;
+    auto instances = std::make_shared<instance_set>();
+    std::size_t mesh_bytes = 0;
+    for (const mesh_record& record : desc.meshes) {
+        const std::string mesh_file = desc.path_of(record);
+        std::shared_ptr<const triangle_mesh>& mesh = mesh_files[mesh_file];
+        if (!mesh) {
+            auto mesh_start = std::chrono::steady_clock::now();
+            obj_mesh geometry;
+            std::string mesh_error;
+            if (!load_obj(mesh_file, geometry, pool, mesh_error)) {
+                std::cerr << "Error: " << mesh_error << "\n";
+                return 1;
+            }
+            mesh = std::make_shared<triangle_mesh>(std::move(geometry.positions), std::move(geometry.indices), nullptr);
+            mesh_bytes += mesh->memory_bytes();
+            double mesh_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - mesh_start).count();
+            std::cout << "🔺 Mesh '" << mesh_file << "': " << mesh->triangle_count() << " triangles, "
+                      << double(mesh->memory_bytes()) / std::max<std::size_t>(1, mesh->triangle_count())
+                      << " bytes per triangle, ready in " << mesh_ms << " ms\n" << std::flush;
         }
+        if (mesh->triangle_count() == 0 || record.scale == 0) continue;
+        instances->add(mesh, affine::from_trs(vec3(record.position[0], record.position[1], record.position[2]),
+                                              real(record.rotate_y), real(record.scale)),
+                       materials[record.material], record.id);
+    }
+    if (instances->size() > 0) {
+        auto build_start = std::chrono::steady_clock::now();
+        instances->build();
+        double build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - build_start).count();
+        std::cout << "🔺 " << instances->size() << " mesh instances of " << mesh_files.size() << " meshes: "
+                  << (mesh_bytes + instances->memory_bytes()) / 1024 << " KiB, top level built in " << build_ms
+                  << " ms\n" << std::flush;
+        scene_objects.push_back(instances);
+    }
 
+    // The accelerator replaces the list: ray_color scans one object. The
+    // first band is timed from here, so a lazy build shows its head start.
+    const auto accel_start = std::chrono::steady_clock::now();
+    if (accel == "bvh" || accel == "bvh-quantized") {
+        auto tree = std::make_shared<bvh_accel>(std::move(scene_objects), accel == "bvh-quantized");
+        double accel_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - accel_start).count();
+        std::cout << "🌲 BVH over " << tree->size() << " objects" << (tree->quantized() ? " (quantized nodes)" : "")
+                  << ": " << tree->node_memory_bytes() / 1024 << " KiB of nodes, built in " << accel_ms << " ms\n"
+                  << std::flush;
+        scene_objects = {tree};
+    } else if (accel == "lbvh" || accel == "lbvh-treelets") {
+        // 30-bit codes alone build fastest; 63-bit codes and two treelet
+        // rounds buy back the tracing speed of the SAH tree
+        const bool treelets = accel == "lbvh-treelets";
+        auto tree = std::make_shared<bvh_accel>(std::move(scene_objects), pool, treelets ? 63 : 30, treelets ? 2 : 0);
+        double accel_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - accel_start).count();
+        std::cout << "🌲 LBVH over " << tree->size() << " objects" << (treelets ? " (63-bit codes, 2 treelet rounds)" : "")
+                  << ": " << tree->node_memory_bytes() / 1024 << " KiB of nodes, built in " << accel_ms << " ms on "
+                  << pool.size() << " threads\n" << std::flush;
+        scene_objects = {tree};
+    } else if (accel == "grid") {
+        auto grid = std::make_shared<grid_accel>(std::move(scene_objects), pool);
+        double accel_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - accel_start).count();
+        std::cout << "🧊 Grid over " << grid->size() << " objects: " << grid->resolution()[0] << "x" << grid->resolution()[1]
+                  << "x" << grid->resolution()[2] << " cells, " << grid->reference_count() << " references, "
+                  << grid->memory_bytes() / 1024 << " KiB, built in " << accel_ms << " ms\n" << std::flush;
+        scene_objects = {grid};
+    } else if (accel == "lazy") {
+        auto tree = std::make_shared<lazy_bvh_accel>(std::move(scene_objects));
+        double accel_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - accel_start).count();
+        std::cout << "🌱 Lazy BVH over " << tree->size() << " objects: top levels over " << tree->cluster_count()
+                  << " clusters built in " << accel_ms << " ms, their subtrees when rays reach them\n" << std::flush;
+        scene_objects = {tree};
     }
 
+    std::vector<PointLight> lights;
+    for (const light_record& record : desc.lights) {
+        lights.push_back(PointLight(vec3(record.position[0], record.position[1], record.position[2]),
+                                    vec3(record.color[0], record.color[1], record.color[2]), record.intensity));
+    }
     std::cout << "\n💡 Loaded " << lights.size() << " point lights\n" << std::flush;
     
     // ========== CREATE DIRECTIONAL LIGHT (SUN) ==========
@@ -293,78 +443,243 @@ int main() {
     }
     
 
-    // Store pixels in memory for denoising
-    std::vector<vec3> pixels(image_width * image_height);
+    // Rows are rendered in bands, the rows of a band in parallel on the pool.
+    // With --stream each finished band is tonemapped and appended to the output
+    // file, so memory holds one band instead of the whole frame (no denoise).
+    const int band_rows = std::max(16, 4 * pool.size());
 
-    // Render loop
-    for (int y = image_height - 1; y >= 0; --y) {
-        
-        // Show progress bar
-        show_progress_bar(image_height - y, image_height);
+    // Samples accumulate in float (sum + count per pixel, plus the AOV sums).
+    // The buffers cover the whole frame when checkpointing, one band otherwise.
+    if (stream_output && write_aov) {
+        std::cout << "⚠ AOVs need the whole frame, skipped in streaming mode\n";
+        write_aov = false;
+    }
+    // The à-trous denoiser is guided by the AOVs: accumulate them even without --aov
+    const bool guided_denoise = enable_denoise && denoise_type == 4 && !stream_output;
+    const bool accumulate_aovs = write_aov || guided_denoise;
+    if (resume && checkpoint_path.empty()) checkpoint_path = "render.ckpt";
+    const bool checkpointing = !checkpoint_path.empty();
+    const int accum_rows = checkpointing ? image_height : std::min(band_rows, image_height);
+
+    checkpoint progress;
+    if (resume) {
+        if (!load_checkpoint(checkpoint_path, progress)) {
+            std::cerr << "Error: Unable to read checkpoint " << checkpoint_path << "\n";
+            return 1;
+        }
+        if (progress.width != image_width || progress.height != image_height
+            || progress.scene_hash != desc.content_hash) {
+            std::cerr << "Error: Checkpoint " << checkpoint_path << " was made for another scene or image size\n";
+            return 1;
+        }
+        if (accumulate_aovs != !progress.aov.empty()) {
+            std::cerr << "Error: Checkpoint " << checkpoint_path << " was made " << (accumulate_aovs ? "without" : "with")
+                      << " AOVs (--aov, --save-buffers or the à-trous denoiser), resume with the same options\n";
+            return 1;
+        }
+        if (seed_given && seed != progress.seed) {
+            std::cerr << "Error: --seed differs from the seed of the checkpoint (" << progress.seed << ")\n";
+            return 1;
+        }
+        seed = progress.seed;
 
+        std::uint64_t done = 0;
+        for (std::uint32_t n : progress.samples) done += std::min<std::uint32_t>(n, samples_per_pixel);
+        std::cout << "⏯️  Resuming from '" << checkpoint_path << "': "
+                  << (100.0 * done / (double(progress.samples.size()) * samples_per_pixel)) << "% of the samples done\n";
+    } else {
+        if (!seed_given) seed = (std::uint64_t(std::random_device{}()) << 32) | std::random_device{}();
+        progress.width = image_width;
+        progress.height = image_height;
+        progress.seed = seed;
+        progress.scene_hash = desc.content_hash;
+        progress.accum.assign(static_cast<std::size_t>(image_width) * accum_rows * 3, 0.0f);
+        progress.samples.assign(static_cast<std::size_t>(image_width) * accum_rows, 0);
+        if (accumulate_aovs) progress.aov.assign(static_cast<std::size_t>(image_width) * accum_rows * aov::accum_channels, 0.0f);
+    }
+    std::cout << "🎲 Seed " << seed << "\n" << std::flush;
+
+    std::unique_ptr<checkpoint_writer> checkpoints;
+    if (checkpointing) checkpoints = std::make_unique<checkpoint_writer>(checkpoint_path);
+    auto last_checkpoint = std::chrono::steady_clock::now();
+
+    std::unique_ptr<image_io::image_writer> output_writer;
+    std::unique_ptr<image_io::image_writer> hdr_writer;
+    if (stream_output) {
+        output_writer = image_io::open_image_writer(output_path, image_width, image_height, pool);
+        if (!output_writer) {
+            std::cerr << "Error: Unable to create " << output_path << "\n";
+            return 1;
+        }
+        if (write_hdr) {
+            hdr_writer = image_io::open_pfm_writer(hdr_path, image_width, image_height);
+            if (!hdr_writer) {
+                std::cerr << "Error: Unable to create " << hdr_path << "\n";
+                return 1;
+            }
+        }
+        if (enable_denoise) {
+            std::cout << "⚠ Denoise needs the whole frame, skipped in streaming mode\n";
+        }
+    }
+    // Streamed bands go through the same per-pixel stages as a whole frame,
+    // to bytes through the tonemap table, so both give the same file
+    post::pipeline band_post;
+    band_post.exposure(real(exposure)).tonemap().gamma(real(gamma)).quantize();
+    std::vector<std::uint8_t> band_rgb;
+
+    // Whole frame in memory for denoising, or one band when streaming
+    std::vector<vec3> pixels(static_cast<std::size_t>(image_width) * (stream_output ? band_rows : image_height));
+    aov::frame aovs;
+    if (accumulate_aovs) aovs.resize(image_width, image_height);
+    double write_ms = 0.0;
+
+    // Row 0 is the top of the image. Pixels that already hold samples (resumed
+    // run) only get the missing ones.
+    const std::uint32_t target_samples = static_cast<std::uint32_t>(samples_per_pixel);
+    auto render_row = [&](int row, float* accum, std::uint32_t* samples, float* aov_accum) {
+        const int y = image_height - 1 - row;
         for (int x = 0; x < image_width; ++x) {
-            vec3 total_color(0, 0, 0);
+            const std::uint64_t pixel = static_cast<std::uint64_t>(row) * image_width + x;
+            float* sum = accum + 3 * x;
 
             // Anti-aliasing: sample multiple rays per pixel
-            for (int s = 0; s < samples_per_pixel; ++s) {
-                double u = (double(x) + distribution(generator)) / (image_width - 1);
-                double v = (double(y) + distribution(generator)) / (image_height - 1);
+            for (std::uint32_t s = samples[x]; s < target_samples; ++s) {
+                seed_sample(seed, pixel, s);
+                real u = real((double(x) + distribution(generator)) / (image_width - 1));
+                real v = real((double(y) + distribution(generator)) / (image_height - 1));
 
                 vec3 ray_origin = camera.get_ray_origin(generator, distribution);
                 vec3 ray_direction = camera.get_ray_direction(u, v, generator, distribution);
-                vec3 pixel_color = ray_color(ray_origin, ray_direction, scene_objects, lights, sun, max_depth, ambient_light);
+                first_hit hit;
+                vec3 pixel_color = ray_color(ray_origin, ray_direction, scene_objects, lights, sun, max_depth, ambient_light,
+                                             aov_accum ? &hit : nullptr);
+                if (aov_accum) aov::accumulate(aov_accum + aov::accum_channels * x, hit, pixel_color, s == 0);
+
+                sum[0] += static_cast<float>(pixel_color.x);
+                sum[1] += static_cast<float>(pixel_color.y);
+                sum[2] += static_cast<float>(pixel_color.z);
+            }
+            samples[x] = std::max(samples[x], target_samples);
+        }
+    };
 
-                total_color = total_color + pixel_color;
+    // Render loop
+    auto render_start = std::chrono::steady_clock::now();
+    double first_band_ms = 0;
+    for (int first_row = 0; first_row < image_height; first_row += band_rows) {
+        const int count = std::min(band_rows, image_height - first_row);
+        const std::size_t accum_offset = checkpointing ? static_cast<std::size_t>(first_row) * image_width : 0;
+        float* band_accum = progress.accum.data() + 3 * accum_offset;
+        std::uint32_t* band_samples = progress.samples.data() + accum_offset;
+        float* band_aov = accumulate_aovs ? progress.aov.data() + aov::accum_channels * accum_offset : nullptr;
+        if (!checkpointing) {
+            std::fill(band_accum, band_accum + static_cast<std::size_t>(count) * image_width * 3, 0.0f);
+            std::fill(band_samples, band_samples + static_cast<std::size_t>(count) * image_width, 0u);
+            if (band_aov) std::fill(band_aov, band_aov + static_cast<std::size_t>(count) * image_width * aov::accum_channels, 0.0f);
+        }
+
+        pool.parallel_for(static_cast<std::size_t>(count), [&](std::size_t r) {
+            render_row(first_row + static_cast<int>(r), band_accum + 3 * r * image_width, band_samples + r * image_width,
+                       band_aov ? band_aov + aov::accum_channels * r * image_width : nullptr);
+        });
+
+        // Average color across all samples
+        vec3* band = stream_output ? pixels.data() : pixels.data() + static_cast<std::size_t>(first_row) * image_width;
+        for (std::size_t i = 0; i < static_cast<std::size_t>(count) * image_width; ++i) {
+            const float* sum = band_accum + 3 * i;
+            band[i] = vec3(sum[0], sum[1], sum[2]) / real(band_samples[i]);
+        }
+        if (band_aov) {
+            aov::resolve(band_aov, band_accum, band_samples, static_cast<std::size_t>(first_row) * image_width,
+                         static_cast<std::size_t>(count) * image_width, aovs);
+        }
+
+        if (first_row == 0) {
+            first_band_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - accel_start).count();
+        }
+
+        // Show progress bar
+        show_progress_bar(first_row + count, image_height);
+
+        // Snapshot for the background writer, at most once per interval
+        if (checkpointing && first_row + count < image_height) {
+            auto now = std::chrono::steady_clock::now();
+            if (std::chrono::duration<double>(now - last_checkpoint).count() >= checkpoint_interval) {
+                checkpoints->save_async(std::make_unique<checkpoint>(progress));
+                last_checkpoint = now;
             }
+        }
+
+        if (stream_output) {
+            auto write_start = std::chrono::steady_clock::now();
+            if (hdr_writer && !hdr_writer->write_rows(band, count)) {
+                std::cerr << "\nError: Unable to write " << hdr_path << "\n";
+                return 1;
+            }
+            band_post.run(pixels, image_width, count, pool, band_rgb);
+            if (!output_writer->write_rows(band_rgb.data(), count)) {
+                std::cerr << "\nError: Unable to write " << output_path << "\n";
+                return 1;
+            }
+            write_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - write_start).count();
+        }
+    }
 
-            // Average color across all samples
-            vec3 avg_color = total_color / samples_per_pixel;
-            
-            // ACES Tone Mapping (HDR → LDR with detail preservation)
-            avg_color = aces_tonemap(avg_color);
+    double render_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - render_start).count();
+    std::cout << "\n⏱️  Rendered in " << render_s << " s (first band " << first_band_ms
+              << " ms after the accelerator build started)" << std::flush;
 
-            // Apply gamma correction AFTER tone mapping
-            avg_color.x = std::pow(avg_color.x, 1.0 / gamma);
-            avg_color.y = std::pow(avg_color.y, 1.0 / gamma);
-            avg_color.z = std::pow(avg_color.z, 1.0 / gamma);
+    // The render is complete: pending saves are no longer needed, but must not
+    // be left half-written (the rename is atomic, the temp file is removed)
+    if (checkpointing && !checkpoints->wait()) {
+        std::cerr << "\n⚠ A checkpoint could not be saved to " << checkpoint_path << "\n";
+    }
 
-            // Store pixel (flip y for correct orientation)
-            pixels[(image_height - 1 - y) * image_width + x] = avg_color;
+    if (stream_output) {
+        auto write_start = std::chrono::steady_clock::now();
+        if (hdr_writer && !hdr_writer->finish()) {
+            std::cerr << "\nError: Unable to write " << hdr_path << "\n";
+            return 1;
         }
+        if (!output_writer->finish()) {
+            std::cerr << "\nError: Unable to write " << output_path << "\n";
+            return 1;
+        }
+        write_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - write_start).count();
+        if (checkpointing) std::remove(checkpoint_path.c_str());
+
+        std::cout << "\n✓ Render complete! Image streamed to '" << output_path << "' (tonemap + write: " << write_ms << " ms)\n";
+        return 0;
     }
-    
-    // Apply denoising if enabled
-    if (enable_denoise) {
-        std::cout << "\n\n🔧 Applying denoise filter...";
-        if (denoise_type == 0) {
-            pixels = denoise::box_blur(pixels, image_width, image_height, static_cast<int>(denoise_strength));
-        } else if (denoise_type == 1) {
-            pixels = denoise::gaussian_blur(pixels, image_width, image_height, denoise_strength);
-        } else if (denoise_type == 2) {
-            pixels = denoise::bilateral_filter(pixels, image_width, image_height, denoise_strength, 0.1f);
+
+    // Linear HDR buffer (before tonemapping) as float PFM
+    if (write_hdr) {
+        auto write_start = std::chrono::steady_clock::now();
+        if (!image_io::write_pfm(hdr_path, pixels, image_width, image_height)) {
+            std::cerr << "\nError: Unable to write " << hdr_path << "\n";
+            return 1;
         }
-        std::cout << " Done!\n";
+        double hdr_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - write_start).count();
+        std::cout << "\n💾 HDR buffer saved as '" << hdr_path << "' in " << hdr_ms << " ms" << std::flush;
     }
-    
-    // Output file
-    std::ofstream file("image.ppm");
-    file << "P3\n" << image_width << " " << image_height << "\n255\n";
-    
-    // Write pixels to file
-    for (int y = 0; y < image_height; ++y) {
-        for (int x = 0; x < image_width; ++x) {
-            vec3 color = pixels[y * image_width + x];
-            
-            // Convert to [0, 255] with clamping
-            int r = static_cast<int>(256.0 * std::clamp(color.x, 0.0, 0.999));
-            int g = static_cast<int>(256.0 * std::clamp(color.y, 0.0, 0.999));
-            int b = static_cast<int>(256.0 * std::clamp(color.z, 0.0, 0.999));
-            
-            file << r << " " << g << " " << b << "\n";
+
+    // First-hit buffers next to the output: image.png gives image.albedo.pfm, ...
+    if (write_aov) {
+        auto write_start = std::chrono::steady_clock::now();
+        if (!aov::write_files(stem, aovs)) {
+            std::cerr << "\nError: Unable to write the AOV files " << stem << ".*.pfm\n";
+            return 1;
         }
+        double aov_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - write_start).count();
+        std::cout << "\n💾 AOVs saved as '" << stem << ".{albedo,normal,depth,object_id,material_id,variance,specular}.pfm' in "
+                  << aov_ms << " ms" << std::flush;
     }
-    
-    std::cout << "\n✓ Render complete! Image saved as 'image.ppm'\n";
-    file.close();
+
+    if (!post_process_and_write(pixels, image_width, image_height, accumulate_aovs ? &aovs : nullptr)) return 1;
+
+    if (checkpointing) std::remove(checkpoint_path.c_str());
+
+    std::cout << "✓ Render complete!\n";
     return 0;
 }
@@ -0,0 +1,88 @@
+#include "core/aov.hpp"
+#include "core/image_io.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace aov {
+
+void frame::resize(int width, int height) {
+    const std::size_t pixel_count = static_cast<std::size_t>(width) * height;
+    albedo.resize(width, height);
+    normal.resize(width, height);
+    depth.resize(pixel_count);
+    object_id.resize(pixel_count);
+    material_id.resize(pixel_count);
+    variance.resize(pixel_count);
+    specular.resize(pixel_count);
+}
+
+void resolve(const float* accum, const float* color_sum, const std::uint32_t* samples,
+             std::size_t first_pixel, std::size_t count, frame& out) {
+    for (std::size_t i = 0; i < count; ++i) {
+        const float* pixel = accum + accum_channels * i;
+        const std::size_t o = first_pixel + i;
+        const float n = static_cast<float>(samples[i]);
+        const float inv_n = samples[i] > 0 ? 1.0f / n : 0.0f;
+
+        for (int c = 0; c < 3; ++c) out.albedo.channel[c][o] = pixel[c] * inv_n;
+
+        // Averaged normals are shorter where the samples disagree: renormalize
+        float nx = pixel[3], ny = pixel[4], nz = pixel[5];
+        float length_sq = nx * nx + ny * ny + nz * nz;
+        float inv_length = length_sq > 0.0f ? 1.0f / std::sqrt(length_sq) : 0.0f;
+        out.normal.channel[0][o] = nx * inv_length;
+        out.normal.channel[1][o] = ny * inv_length;
+        out.normal.channel[2][o] = nz * inv_length;
+
+        out.depth[o] = pixel[6] * inv_n;
+        out.object_id[o] = pixel[8];
+        out.material_id[o] = pixel[9];
+        out.specular[o] = pixel[10] * inv_n;
+
+        // Unbiased variance from the sums: (sum x^2 - (sum x)^2 / n) / (n - 1)
+        const float* rgb = color_sum + 3 * i;
+        float sum = 0.2126f * rgb[0] + 0.7152f * rgb[1] + 0.0722f * rgb[2];
+        out.variance[o] = samples[i] > 1 ? std::max(0.0f, (pixel[7] - sum * sum * inv_n) / (n - 1.0f)) : 0.0f;
+    }
+}
+
+bool write_files(const std::string& stem, const frame& buffers) {
+    const int width = buffers.albedo.width;
+    const int height = buffers.albedo.height;
+    const float* albedo[3] = {buffers.albedo.channel[0].data(), buffers.albedo.channel[1].data(), buffers.albedo.channel[2].data()};
+    const float* normal[3] = {buffers.normal.channel[0].data(), buffers.normal.channel[1].data(), buffers.normal.channel[2].data()};
+    const float* depth = buffers.depth.data();
+    const float* object_id = buffers.object_id.data();
+    const float* material_id = buffers.material_id.data();
+    const float* variance = buffers.variance.data();
+    const float* specular = buffers.specular.data();
+
+    return image_io::write_pfm(stem + ".albedo.pfm", albedo, 3, width, height)
+        && image_io::write_pfm(stem + ".normal.pfm", normal, 3, width, height)
+        && image_io::write_pfm(stem + ".depth.pfm", &depth, 1, width, height)
+        && image_io::write_pfm(stem + ".object_id.pfm", &object_id, 1, width, height)
+        && image_io::write_pfm(stem + ".material_id.pfm", &material_id, 1, width, height)
+        && image_io::write_pfm(stem + ".variance.pfm", &variance, 1, width, height)
+        && image_io::write_pfm(stem + ".specular.pfm", &specular, 1, width, height);
+}
+
+bool read_files(const std::string& stem, int width, int height, frame& buffers) {
+    buffers.resize(width, height);
+    float* albedo[3] = {buffers.albedo.channel[0].data(), buffers.albedo.channel[1].data(), buffers.albedo.channel[2].data()};
+    float* normal[3] = {buffers.normal.channel[0].data(), buffers.normal.channel[1].data(), buffers.normal.channel[2].data()};
+    float* depth = buffers.depth.data();
+    float* object_id = buffers.object_id.data();
+    float* material_id = buffers.material_id.data();
+    float* variance = buffers.variance.data();
+    float* specular = buffers.specular.data();
+
+    return image_io::read_pfm(stem + ".albedo.pfm", albedo, 3, width, height)
+        && image_io::read_pfm(stem + ".normal.pfm", normal, 3, width, height)
+        && image_io::read_pfm(stem + ".depth.pfm", &depth, 1, width, height)
+        && image_io::read_pfm(stem + ".object_id.pfm", &object_id, 1, width, height)
+        && image_io::read_pfm(stem + ".material_id.pfm", &material_id, 1, width, height)
+        && image_io::read_pfm(stem + ".variance.pfm", &variance, 1, width, height)
+        && image_io::read_pfm(stem + ".specular.pfm", &specular, 1, width, height);
+}
+
+} // namespace aov
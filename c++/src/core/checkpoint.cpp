@@ -0,0 +1,137 @@
+#include "core/checkpoint.hpp"
+#include "core/aov.hpp"
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+// File layout (native endianness, the file is not meant to move between machines):
+//   char[8] "RAYTCKP2", int32 width, int32 height, uint64 seed, uint64 scene_hash,
+//   uint32 aov_channels (0 or aov::accum_channels),
+//   float accum[3 * width * height], uint32 samples[width * height],
+//   float aov[aov_channels * width * height]
+static const char magic[8] = {'R', 'A', 'Y', 'T', 'C', 'K', 'P', '2'};
+
+std::uint64_t hash_scene(const std::string& contents) {
+    return hash_scene(contents.data(), contents.size());
+}
+
+std::uint64_t hash_scene(const void* contents, std::size_t size, std::uint64_t hash) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(contents);
+    for (std::size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+bool save_checkpoint(const std::string& path, const checkpoint& state) {
+    const std::size_t pixel_count = static_cast<std::size_t>(state.width) * state.height;
+    if (state.accum.size() != pixel_count * 3 || state.samples.size() != pixel_count) return false;
+    if (!state.aov.empty() && state.aov.size() != pixel_count * aov::accum_channels) return false;
+
+    const std::string temp_path = path + ".tmp";
+    std::FILE* file = std::fopen(temp_path.c_str(), "wb");
+    if (!file) return false;
+
+    const std::int32_t size[2] = {state.width, state.height};
+    const std::uint32_t aov_channels = state.aov.empty() ? 0 : aov::accum_channels;
+    bool ok = std::fwrite(magic, 1, sizeof(magic), file) == sizeof(magic)
+           && std::fwrite(size, sizeof(std::int32_t), 2, file) == 2
+           && std::fwrite(&state.seed, sizeof(state.seed), 1, file) == 1
+           && std::fwrite(&state.scene_hash, sizeof(state.scene_hash), 1, file) == 1
+           && std::fwrite(&aov_channels, sizeof(aov_channels), 1, file) == 1
+           && std::fwrite(state.accum.data(), sizeof(float), state.accum.size(), file) == state.accum.size()
+           && std::fwrite(state.samples.data(), sizeof(std::uint32_t), state.samples.size(), file) == state.samples.size()
+           && std::fwrite(state.aov.data(), sizeof(float), state.aov.size(), file) == state.aov.size();
+    ok = std::fflush(file) == 0 && ok;
+#if defined(__unix__) || defined(__APPLE__)
+    // Data on disk before the rename makes it visible
+    ok = ok && fsync(fileno(file)) == 0;
+#endif
+    ok = std::fclose(file) == 0 && ok;
+
+    if (!ok || std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool load_checkpoint(const std::string& path, checkpoint& state) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) return false;
+
+    char header[8];
+    std::int32_t size[2];
+    std::uint32_t aov_channels = 0;
+    bool ok = std::fread(header, 1, sizeof(header), file) == sizeof(header)
+           && std::memcmp(header, magic, sizeof(magic)) == 0
+           && std::fread(size, sizeof(std::int32_t), 2, file) == 2
+           && size[0] > 0 && size[1] > 0
+           && std::fread(&state.seed, sizeof(state.seed), 1, file) == 1
+           && std::fread(&state.scene_hash, sizeof(state.scene_hash), 1, file) == 1
+           && std::fread(&aov_channels, sizeof(aov_channels), 1, file) == 1
+           && (aov_channels == 0 || aov_channels == aov::accum_channels);
+
+    if (ok) {
+        state.width = size[0];
+        state.height = size[1];
+        const std::size_t pixel_count = static_cast<std::size_t>(state.width) * state.height;
+        state.accum.resize(pixel_count * 3);
+        state.samples.resize(pixel_count);
+        state.aov.resize(pixel_count * aov_channels);
+        ok = std::fread(state.accum.data(), sizeof(float), state.accum.size(), file) == state.accum.size()
+          && std::fread(state.samples.data(), sizeof(std::uint32_t), state.samples.size(), file) == state.samples.size()
+          && std::fread(state.aov.data(), sizeof(float), state.aov.size(), file) == state.aov.size();
+    }
+    std::fclose(file);
+    return ok;
+}
+
+checkpoint_writer::checkpoint_writer(std::string path)
+    : path(std::move(path)), worker([this] { run(); }) {}
+
+checkpoint_writer::~checkpoint_writer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    worker.join();
+}
+
+void checkpoint_writer::save_async(std::unique_ptr<checkpoint> snapshot) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = std::move(snapshot);
+    }
+    changed.notify_all();
+}
+
+bool checkpoint_writer::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this] { return !pending && !busy; });
+    return !failed;
+}
+
+void checkpoint_writer::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        changed.wait(lock, [this] { return stopping || pending; });
+        if (!pending) return;  // Stopping with nothing left to save
+
+        std::unique_ptr<checkpoint> snapshot = std::move(pending);
+        busy = true;
+        lock.unlock();
+        bool ok = save_checkpoint(path, *snapshot);
+        snapshot.reset();
+        lock.lock();
+        busy = false;
+        failed = failed || !ok;
+        changed.notify_all();
+    }
+}
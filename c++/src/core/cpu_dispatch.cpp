@@ -0,0 +1,102 @@
+#include "core/cpu_dispatch.hpp"
+#include "core/kernels.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define RAYT_X86 1
+#include <cpuid.h>
+#endif
+
+// Kernel tables, one per variant (kernels_*.cpp)
+namespace kernels_baseline { extern const kernel_table table; }
+#ifdef RAYT_X86
+namespace kernels_sse42 { extern const kernel_table table; }
+namespace kernels_avx2 { extern const kernel_table table; }
+namespace kernels_avx512 { extern const kernel_table table; }
+#endif
+
+namespace {
+
+const kernel_table* active_table = &kernels_baseline::table;
+
+#ifdef RAYT_X86
+// XCR0: which register states the OS saves on context switch
+unsigned long long read_xcr0() {
+    unsigned int eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<unsigned long long>(edx) << 32) | eax;
+}
+#endif
+
+} // namespace
+
+const char* isa_name(isa level) {
+    switch (level) {
+        case isa::automatic: return "auto";
+        case isa::baseline:  return "baseline";
+        case isa::sse42:     return "sse4.2";
+        case isa::avx2:      return "avx2";
+        case isa::avx512:    return "avx512";
+    }
+    return "unknown";
+}
+
+bool parse_isa(const std::string& name, isa& level) {
+    if (name == "auto") level = isa::automatic;
+    else if (name == "baseline" || name == "sse2" || name == "scalar") level = isa::baseline;
+    else if (name == "sse4.2" || name == "sse42") level = isa::sse42;
+    else if (name == "avx2") level = isa::avx2;
+    else if (name == "avx512" || name == "avx-512") level = isa::avx512;
+    else return false;
+    return true;
+}
+
+isa detect_isa() {
+#ifdef RAYT_X86
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return isa::baseline;
+
+    const bool sse42 = (ecx & bit_SSE4_2) != 0;
+    const bool osxsave = (ecx & bit_OSXSAVE) != 0;
+    const bool fma = (ecx & bit_FMA) != 0;
+    if (!sse42) return isa::baseline;
+    if (!osxsave) return isa::sse42;
+
+    // AVX needs the OS to save XMM/YMM, AVX-512 also opmask and ZMM
+    const unsigned long long xcr0 = read_xcr0();
+    const bool os_avx = (xcr0 & 0x6) == 0x6;
+    const bool os_avx512 = (xcr0 & 0xE6) == 0xE6;
+
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return isa::sse42;
+    const bool avx2 = (ebx & bit_AVX2) != 0;
+    const bool avx512 = (ebx & bit_AVX512F) && (ebx & bit_AVX512BW)
+                     && (ebx & bit_AVX512DQ) && (ebx & bit_AVX512VL);
+
+    if (os_avx512 && avx512 && avx2 && fma) return isa::avx512;
+    if (os_avx && avx2 && fma) return isa::avx2;
+    return isa::sse42;
+#else
+    return isa::baseline;
+#endif
+}
+
+isa select_kernels(isa requested) {
+    const isa supported = detect_isa();
+    isa chosen = (requested == isa::automatic || requested > supported) ? supported : requested;
+
+    switch (chosen) {
+#ifdef RAYT_X86
+        case isa::sse42:  active_table = &kernels_sse42::table; break;
+        case isa::avx2:   active_table = &kernels_avx2::table; break;
+        case isa::avx512: active_table = &kernels_avx512::table; break;
+#endif
+        default:
+            chosen = isa::baseline;
+            active_table = &kernels_baseline::table;
+            break;
+    }
+    return chosen;
+}
+
+const kernel_table& kernels() {
+    return *active_table;
+}
@@ -0,0 +1,399 @@
+#include "core/deflate.hpp"
+#include <algorithm>
+#include <cstring>
+#include <queue>
+#include <vector>
+
+namespace deflate {
+
+namespace {
+
+// ==================== TABLES (RFC 1951, section 3.2.5) ====================
+
+constexpr int min_match = 3;
+constexpr int max_match = 258;
+constexpr int max_chain = 32;                 // Hash chain candidates tried per position
+constexpr std::size_t symbols_per_block = 1 << 15;
+
+constexpr int length_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+constexpr int length_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+constexpr int distance_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+constexpr int distance_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+// Order in which code length code lengths are stored
+constexpr int code_length_order[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+int length_code(int length) {
+    int code = 0;
+    while (code < 28 && length_base[code + 1] <= length) ++code;
+    return code;
+}
+
+int distance_code(int distance) {
+    int code = 0;
+    while (code < 29 && distance_base[code + 1] <= distance) ++code;
+    return code;
+}
+
+// ==================== BIT WRITER (LSB first) ====================
+
+class bit_writer {
+public:
+    explicit bit_writer(std::vector<std::uint8_t>& out) : out(out) {}
+
+    void write(std::uint32_t value, int count) {
+        buffer |= static_cast<std::uint64_t>(value) << bit_count;
+        bit_count += count;
+        while (bit_count >= 8) {
+            out.push_back(static_cast<std::uint8_t>(buffer));
+            buffer >>= 8;
+            bit_count -= 8;
+        }
+    }
+
+    // Huffman codes are stored most significant bit first
+    void write_code(std::uint32_t code, int length) {
+        std::uint32_t reversed = 0;
+        for (int i = 0; i < length; ++i) reversed |= ((code >> i) & 1u) << (length - 1 - i);
+        write(reversed, length);
+    }
+
+    void align_to_byte() {
+        if (bit_count > 0) write(0, 8 - bit_count);
+    }
+
+private:
+    std::vector<std::uint8_t>& out;
+    std::uint64_t buffer = 0;
+    int bit_count = 0;
+};
+
+// ==================== HUFFMAN CODES ====================
+
+// Code lengths for the given frequencies, no longer than max_bits.
+// Plain Huffman; if the tree is too deep the frequencies are flattened and
+// the tree rebuilt. At least two symbols always get a code, so every tree
+// is complete and accepted by any inflater.
+std::vector<int> build_lengths(std::vector<std::uint32_t> freq, int max_bits) {
+    const int n = static_cast<int>(freq.size());
+    int used = 0;
+    for (std::uint32_t f : freq) used += (f > 0);
+    for (int s = 0; used < 2 && s < n; ++s) {
+        if (freq[s] == 0) { freq[s] = 1; ++used; }
+    }
+
+    std::vector<int> lengths(n, 0);
+    while (true) {
+        // Nodes [0, n) are leaves, parents are appended
+        std::vector<std::uint64_t> weight(freq.begin(), freq.end());
+        std::vector<int> parent(n, -1);
+        using entry = std::pair<std::uint64_t, int>;
+        std::priority_queue<entry, std::vector<entry>, std::greater<entry>> heap;
+        for (int s = 0; s < n; ++s) {
+            if (freq[s] > 0) heap.push({freq[s], s});
+        }
+        while (heap.size() > 1) {
+            entry a = heap.top(); heap.pop();
+            entry b = heap.top(); heap.pop();
+            int node = static_cast<int>(weight.size());
+            weight.push_back(a.first + b.first);
+            parent.push_back(-1);
+            parent[a.second] = node;
+            parent[b.second] = node;
+            heap.push({a.first + b.first, node});
+        }
+
+        int deepest = 0;
+        for (int s = 0; s < n; ++s) {
+            if (freq[s] == 0) { lengths[s] = 0; continue; }
+            int depth = 0;
+            for (int p = parent[s]; p != -1; p = parent[p]) ++depth;
+            lengths[s] = depth;
+            deepest = std::max(deepest, depth);
+        }
+        if (deepest <= max_bits) return lengths;
+
+        for (std::uint32_t& f : freq) {
+            if (f > 0) f = (f >> 1) | 1u;
+        }
+    }
+}
+
+// Canonical codes from code lengths (RFC 1951, section 3.2.2)
+std::vector<std::uint32_t> canonical_codes(const std::vector<int>& lengths) {
+    int max_length = 0;
+    for (int l : lengths) max_length = std::max(max_length, l);
+
+    std::vector<int> count(max_length + 1, 0);
+    for (int l : lengths) if (l > 0) ++count[l];
+
+    std::vector<std::uint32_t> next(max_length + 2, 0);
+    std::uint32_t code = 0;
+    for (int bits = 1; bits <= max_length; ++bits) {
+        code = (code + count[bits - 1]) << 1;
+        next[bits] = code;
+    }
+
+    std::vector<std::uint32_t> codes(lengths.size(), 0);
+    for (std::size_t s = 0; s < lengths.size(); ++s) {
+        if (lengths[s] > 0) codes[s] = next[lengths[s]]++;
+    }
+    return codes;
+}
+
+// ==================== BLOCK ENCODING ====================
+
+// LZ77 output: literal (distance == 0) or match
+struct symbol {
+    std::uint16_t literal_or_length;
+    std::uint16_t distance;
+};
+
+void write_dynamic_block(bit_writer& bits, const std::vector<symbol>& symbols) {
+    std::vector<std::uint32_t> litlen_freq(286, 0);
+    std::vector<std::uint32_t> dist_freq(30, 0);
+    for (const symbol& s : symbols) {
+        if (s.distance == 0) {
+            ++litlen_freq[s.literal_or_length];
+        } else {
+            ++litlen_freq[257 + length_code(s.literal_or_length)];
+            ++dist_freq[distance_code(s.distance)];
+        }
+    }
+    litlen_freq[256] = 1;  // End of block
+
+    std::vector<int> litlen_lengths = build_lengths(litlen_freq, 15);
+    std::vector<int> dist_lengths = build_lengths(dist_freq, 15);
+    std::vector<std::uint32_t> litlen_codes = canonical_codes(litlen_lengths);
+    std::vector<std::uint32_t> dist_codes = canonical_codes(dist_lengths);
+
+    int hlit = 286;
+    while (hlit > 257 && litlen_lengths[hlit - 1] == 0) --hlit;
+    int hdist = 30;
+    while (hdist > 1 && dist_lengths[hdist - 1] == 0) --hdist;
+
+    // Run-length encode both length tables as one sequence (codes 16, 17, 18)
+    std::vector<int> all_lengths(litlen_lengths.begin(), litlen_lengths.begin() + hlit);
+    all_lengths.insert(all_lengths.end(), dist_lengths.begin(), dist_lengths.begin() + hdist);
+
+    struct rle_item { int code; int extra; };
+    std::vector<rle_item> rle;
+    for (std::size_t i = 0; i < all_lengths.size();) {
+        int value = all_lengths[i];
+        std::size_t run = 1;
+        while (i + run < all_lengths.size() && all_lengths[i + run] == value) ++run;
+
+        if (value == 0 && run >= 3) {
+            std::size_t take = std::min<std::size_t>(run, 138);
+            if (take >= 11) rle.push_back({18, static_cast<int>(take - 11)});
+            else rle.push_back({17, static_cast<int>(take - 3)});
+            i += take;
+        } else if (value != 0 && run >= 4) {
+            rle.push_back({value, 0});
+            std::size_t take = std::min<std::size_t>(run - 1, 6);
+            rle.push_back({16, static_cast<int>(take - 3)});
+            i += 1 + take;
+        } else {
+            rle.push_back({value, 0});
+            i += 1;
+        }
+    }
+
+    std::vector<std::uint32_t> cl_freq(19, 0);
+    for (const rle_item& item : rle) ++cl_freq[item.code];
+    std::vector<int> cl_lengths = build_lengths(cl_freq, 7);
+    std::vector<std::uint32_t> cl_codes = canonical_codes(cl_lengths);
+
+    int hclen = 19;
+    while (hclen > 4 && cl_lengths[code_length_order[hclen - 1]] == 0) --hclen;
+
+    // Block header: BFINAL = 0, BTYPE = 10 (dynamic)
+    bits.write(0, 1);
+    bits.write(2, 2);
+    bits.write(hlit - 257, 5);
+    bits.write(hdist - 1, 5);
+    bits.write(hclen - 4, 4);
+    for (int i = 0; i < hclen; ++i) bits.write(cl_lengths[code_length_order[i]], 3);
+
+    for (const rle_item& item : rle) {
+        bits.write_code(cl_codes[item.code], cl_lengths[item.code]);
+        if (item.code == 16) bits.write(item.extra, 2);
+        else if (item.code == 17) bits.write(item.extra, 3);
+        else if (item.code == 18) bits.write(item.extra, 7);
+    }
+
+    for (const symbol& s : symbols) {
+        if (s.distance == 0) {
+            bits.write_code(litlen_codes[s.literal_or_length], litlen_lengths[s.literal_or_length]);
+        } else {
+            int lc = length_code(s.literal_or_length);
+            bits.write_code(litlen_codes[257 + lc], litlen_lengths[257 + lc]);
+            bits.write(s.literal_or_length - length_base[lc], length_extra[lc]);
+            int dc = distance_code(s.distance);
+            bits.write_code(dist_codes[dc], dist_lengths[dc]);
+            bits.write(s.distance - distance_base[dc], distance_extra[dc]);
+        }
+    }
+    bits.write_code(litlen_codes[256], litlen_lengths[256]);
+}
+
+// Empty stored block: ends the output on a byte boundary
+void write_empty_stored_block(bit_writer& bits, bool final) {
+    bits.write(final ? 1 : 0, 1);
+    bits.write(0, 2);
+    bits.align_to_byte();
+    bits.write(0x0000, 16);
+    bits.write(0xFFFF, 16);
+}
+
+// ==================== LZ77 MATCH FINDER ====================
+
+constexpr int hash_bits = 15;
+
+inline std::uint32_t hash3(const std::uint8_t* p) {
+    std::uint32_t v = (static_cast<std::uint32_t>(p[0]) << 16) | (static_cast<std::uint32_t>(p[1]) << 8) | p[2];
+    return (v * 2654435761u) >> (32 - hash_bits);
+}
+
+} // namespace
+
+std::vector<std::uint8_t> compress(const std::uint8_t* data, std::size_t size,
+                                   const std::uint8_t* history, std::size_t history_size,
+                                   bool final) {
+    // One buffer holding the usable history followed by the data
+    const std::size_t kept_history = std::min(history_size, window_size);
+    std::vector<std::uint8_t> buffer(kept_history + size);
+    if (kept_history > 0) {
+        std::memcpy(buffer.data(), history + history_size - kept_history, kept_history);
+    }
+    if (size > 0) std::memcpy(buffer.data() + kept_history, data, size);
+    const std::size_t end = buffer.size();
+
+    std::vector<std::int32_t> head(std::size_t(1) << hash_bits, -1);
+    std::vector<std::int32_t> prev(end, -1);
+    auto insert = [&](std::size_t pos) {
+        if (pos + min_match > end) return;
+        std::uint32_t h = hash3(&buffer[pos]);
+        prev[pos] = head[h];
+        head[h] = static_cast<std::int32_t>(pos);
+    };
+    for (std::size_t pos = 0; pos < kept_history; ++pos) insert(pos);
+
+    std::vector<std::uint8_t> out;
+    out.reserve(size / 2 + 64);
+    bit_writer bits(out);
+    std::vector<symbol> symbols;
+    symbols.reserve(symbols_per_block);
+
+    std::size_t pos = kept_history;
+    while (pos < end) {
+        int best_length = 0;
+        std::size_t best_distance = 0;
+
+        if (pos + min_match <= end) {
+            const std::size_t limit = std::min<std::size_t>(max_match, end - pos);
+            std::int32_t candidate = head[hash3(&buffer[pos])];
+            for (int chain = 0; candidate >= 0 && chain < max_chain; ++chain) {
+                std::size_t distance = pos - static_cast<std::size_t>(candidate);
+                if (distance > window_size) break;
+
+                const std::uint8_t* a = &buffer[candidate];
+                const std::uint8_t* b = &buffer[pos];
+                if (a[best_length] == b[best_length]) {
+                    std::size_t length = 0;
+                    while (length < limit && a[length] == b[length]) ++length;
+                    if (static_cast<int>(length) > best_length) {
+                        best_length = static_cast<int>(length);
+                        best_distance = distance;
+                        if (length == limit) break;
+                    }
+                }
+                candidate = prev[candidate];
+            }
+        }
+
+        if (best_length >= min_match) {
+            symbols.push_back({static_cast<std::uint16_t>(best_length), static_cast<std::uint16_t>(best_distance)});
+            for (int i = 0; i < best_length; ++i) insert(pos + i);
+            pos += best_length;
+        } else {
+            symbols.push_back({buffer[pos], 0});
+            insert(pos);
+            pos += 1;
+        }
+
+        if (symbols.size() >= symbols_per_block) {
+            write_dynamic_block(bits, symbols);
+            symbols.clear();
+        }
+    }
+    if (!symbols.empty()) write_dynamic_block(bits, symbols);
+
+    write_empty_stored_block(bits, final);
+    return out;
+}
+
+std::uint32_t adler32(const std::uint8_t* data, std::size_t size, std::uint32_t adler) {
+    constexpr std::uint32_t base = 65521;
+    std::uint32_t a = adler & 0xFFFF;
+    std::uint32_t b = adler >> 16;
+    while (size > 0) {
+        // 5552 is the largest run that cannot overflow 32 bits before the modulo
+        std::size_t run = std::min<std::size_t>(size, 5552);
+        for (std::size_t i = 0; i < run; ++i) {
+            a += data[i];
+            b += a;
+        }
+        a %= base;
+        b %= base;
+        data += run;
+        size -= run;
+    }
+    return (b << 16) | a;
+}
+
+std::uint32_t adler32_combine(std::uint32_t adler_a, std::uint32_t adler_b, std::size_t size_b) {
+    // Same derivation as zlib's adler32_combine()
+    constexpr std::uint32_t base = 65521;
+    std::uint32_t remainder = static_cast<std::uint32_t>(size_b % base);
+    std::uint32_t sum1 = adler_a & 0xFFFF;
+    std::uint32_t sum2 = static_cast<std::uint32_t>((static_cast<std::uint64_t>(remainder) * sum1) % base);
+    sum1 += (adler_b & 0xFFFF) + base - 1;
+    sum2 += ((adler_a >> 16) & 0xFFFF) + ((adler_b >> 16) & 0xFFFF) + base - remainder;
+    if (sum1 >= base) sum1 -= base;
+    if (sum1 >= base) sum1 -= base;
+    if (sum2 >= (base << 1)) sum2 -= (base << 1);
+    if (sum2 >= base) sum2 -= base;
+    return sum1 | (sum2 << 16);
+}
+
+std::uint32_t crc32(const std::uint8_t* data, std::size_t size, std::uint32_t crc) {
+    static const std::vector<std::uint32_t> table = [] {
+        std::vector<std::uint32_t> t(256);
+        for (std::uint32_t n = 0; n < 256; ++n) {
+            std::uint32_t c = n;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[n] = c;
+        }
+        return t;
+    }();
+
+    crc = ~crc;
+    for (std::size_t i = 0; i < size; ++i) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+} // namespace deflate
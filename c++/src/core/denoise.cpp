@@ -1,46 +1,190 @@
 #include "core/denoise.hpp"
+#include "core/aov.hpp"
+#include "core/cpu_dispatch.hpp"
+#include "core/thread_pool.hpp"
 #include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <functional>
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
 
 namespace denoise {
 
-// Helper: Get pixel safely (clamp to borders)
-static vec3 get_pixel_safe(const std::vector<vec3>& pixels, int width, int height, int x, int y) {
-    x = std::clamp(x, 0, width - 1);
-    y = std::clamp(y, 0, height - 1);
-    return pixels[y * width + x];
-}
-
-// Box blur: Simple average of neighbors
-std::vector<vec3> box_blur(const std::vector<vec3>& pixels, int width, int height, int radius) {
-    std::vector<vec3> result(pixels.size());
-    
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            vec3 sum(0, 0, 0);
-            int count = 0;
-            
-            // Average all pixels in radius
-            for (int dy = -radius; dy <= radius; ++dy) {
-                for (int dx = -radius; dx <= radius; ++dx) {
-                    vec3 pixel = get_pixel_safe(pixels, width, height, x + dx, y + dy);
-                    sum = sum + pixel;
-                    count++;
+// Rows per parallel task: enough work to amortize the scheduling
+static constexpr int rows_per_task = 8;
+
+// Columns per task in the vertical running-sum pass
+static constexpr int columns_per_task = 1024;
+
+// fn(first_row, end_row) over bands of rows, in parallel
+static void parallel_rows(thread_pool& pool, int height, const std::function<void(int, int)>& fn) {
+    const std::size_t tasks = (static_cast<std::size_t>(height) + rows_per_task - 1) / rows_per_task;
+    pool.parallel_for(tasks, [&](std::size_t task) {
+        const int first = static_cast<int>(task) * rows_per_task;
+        fn(first, std::min(height, first + rows_per_task));
+    });
+}
+
+// Copy a row into out with 'border' copies of its first and last pixel on
+// each side, so the filter loops never clamp
+static void pad_row(const float* row, int width, int border, float* out) {
+    std::fill(out, out + border, row[0]);
+    std::memcpy(out + border, row, sizeof(float) * width);
+    std::fill(out + border + width, out + 2 * border + width, row[width - 1]);
+}
+
+void image_planes::resize(int w, int h) {
+    width = w;
+    height = h;
+    for (std::vector<float>& plane : channel) plane.resize(static_cast<std::size_t>(w) * h);
+}
+
+void to_planes(const std::vector<vec3>& pixels, int width, int height, image_planes& planes, thread_pool& pool) {
+    planes.resize(width, height);
+    parallel_rows(pool, height, [&](int first, int end) {
+        const std::size_t last = static_cast<std::size_t>(end) * width;
+        for (std::size_t i = static_cast<std::size_t>(first) * width; i < last; ++i) {
+            planes.channel[0][i] = static_cast<float>(pixels[i].x);
+            planes.channel[1][i] = static_cast<float>(pixels[i].y);
+            planes.channel[2][i] = static_cast<float>(pixels[i].z);
+        }
+    });
+}
+
+void from_planes(const image_planes& planes, std::vector<vec3>& pixels, thread_pool& pool) {
+    pixels.resize(static_cast<std::size_t>(planes.width) * planes.height);
+    parallel_rows(pool, planes.height, [&](int first, int end) {
+        const std::size_t last = static_cast<std::size_t>(end) * planes.width;
+        for (std::size_t i = static_cast<std::size_t>(first) * planes.width; i < last; ++i) {
+            pixels[i] = vec3(planes.channel[0][i], planes.channel[1][i], planes.channel[2][i]);
+        }
+    });
+}
+
+// Separable convolution with clamp-to-border, both passes on the dispatched
+// weighted_row_sum kernel. kernel has 2 * radius + 1 normalized taps.
+static void separable_blur(const image_planes& in, image_planes& out, const std::vector<float>& kernel,
+                           thread_pool& pool, image_planes& temp) {
+    const kernel_table& k = kernels();
+    const int radius = static_cast<int>(kernel.size()) / 2;
+    const int taps = static_cast<int>(kernel.size());
+    const int width = in.width;
+    const int height = in.height;
+    temp.resize(width, height);
+    out.resize(width, height);
+
+    // Horizontal pass: pad the row with its border pixels, then tap k is the
+    // padded row shifted by k pixels
+    parallel_rows(pool, height, [&](int first, int end) {
+        thread_local std::vector<float> padded;
+        thread_local std::vector<const float*> rows;
+        padded.resize(width + 2 * radius);
+        rows.resize(taps);
+        for (int i = 0; i < taps; ++i) rows[i] = padded.data() + i;
+
+        for (int c = 0; c < 3; ++c) {
+            for (int y = first; y < end; ++y) {
+                const std::size_t offset = static_cast<std::size_t>(y) * width;
+                pad_row(in.channel[c].data() + offset, width, radius, padded.data());
+                k.weighted_row_sum(rows.data(), kernel.data(), taps, temp.channel[c].data() + offset, width);
+            }
+        }
+    });
+
+    // Vertical pass: tap k is the (clamped) row y + k - radius
+    parallel_rows(pool, height, [&](int first, int end) {
+        thread_local std::vector<const float*> rows;
+        rows.resize(taps);
+
+        for (int c = 0; c < 3; ++c) {
+            for (int y = first; y < end; ++y) {
+                for (int i = 0; i < taps; ++i) {
+                    int sy = std::clamp(y + i - radius, 0, height - 1);
+                    rows[i] = temp.channel[c].data() + static_cast<std::size_t>(sy) * width;
                 }
+                k.weighted_row_sum(rows.data(), kernel.data(), taps,
+                                   out.channel[c].data() + static_cast<std::size_t>(y) * width, width);
             }
-            
-            result[y * width + x] = sum / static_cast<double>(count);
         }
+    });
+}
+
+// Box blur: Simple average of neighbors, as two running sums (rows, then
+// columns). Each pass adds the sample entering the window and subtracts the
+// one leaving it, so the cost per pixel does not depend on the radius.
+// Borders are clamped by padding the row and clamping row indices, outside
+// the inner loops.
+void box_blur(const image_planes& in, image_planes& out, int radius, thread_pool& pool, image_planes& temp) {
+    const int width = in.width;
+    const int height = in.height;
+    out.resize(width, height);
+    if (radius <= 0) {
+        for (int c = 0; c < 3; ++c) std::copy(in.channel[c].begin(), in.channel[c].end(), out.channel[c].begin());
+        return;
     }
-    
-    return result;
+    temp.resize(width, height);
+    const double inv_taps = 1.0 / (2 * radius + 1);
+
+    // Horizontal pass. The sums are kept in double: over a 4K row, float
+    // running sums drift by more than the 8-bit output step.
+    parallel_rows(pool, height, [&](int first, int end) {
+        // One extra padded pixel: the last step slides the window past the row
+        thread_local std::vector<float> padded;
+        padded.resize(width + 2 * radius + 1);
+
+        for (int c = 0; c < 3; ++c) {
+            for (int y = first; y < end; ++y) {
+                const std::size_t offset = static_cast<std::size_t>(y) * width;
+                pad_row(in.channel[c].data() + offset, width, radius, padded.data());
+                padded[width + 2 * radius] = padded[width + 2 * radius - 1];
+
+                double sum = 0.0;
+                for (int i = 0; i < 2 * radius + 1; ++i) sum += padded[i];
+                float* dst = temp.channel[c].data() + offset;
+                for (int x = 0; x < width; ++x) {
+                    dst[x] = static_cast<float>(sum * inv_taps);
+                    sum += padded[x + 2 * radius + 1] - padded[x];
+                }
+            }
+        }
+    });
+
+    // Vertical pass: one running sum per column, updated a whole row at a
+    // time (a flat loop the compiler vectorizes). Tasks are column strips.
+    const std::size_t strips = (static_cast<std::size_t>(width) + columns_per_task - 1) / columns_per_task;
+    pool.parallel_for(3 * strips, [&](std::size_t task) {
+        const int c = static_cast<int>(task / strips);
+        const int x0 = static_cast<int>(task % strips) * columns_per_task;
+        const int count = std::min(columns_per_task, width - x0);
+        const float* plane = temp.channel[c].data() + x0;
+        auto row = [&](int y) {
+            return plane + static_cast<std::size_t>(std::clamp(y, 0, height - 1)) * width;
+        };
+
+        thread_local std::vector<double> column_sum;
+        column_sum.assign(count, 0.0);
+        for (int y = -radius; y <= radius; ++y) {
+            const float* r = row(y);
+            for (int i = 0; i < count; ++i) column_sum[i] += r[i];
+        }
+        for (int y = 0; y < height; ++y) {
+            float* dst = out.channel[c].data() + static_cast<std::size_t>(y) * width + x0;
+            const float* enter = row(y + radius + 1);
+            const float* leave = row(y - radius);
+            for (int i = 0; i < count; ++i) {
+                dst[i] = static_cast<float>(column_sum[i] * inv_taps);
+                column_sum[i] += enter[i] - leave[i];
+            }
+        }
+    });
 }
 
 // Gaussian blur: Weighted average (better quality)
-std::vector<vec3> gaussian_blur(const std::vector<vec3>& pixels, int width, int height, float sigma) {
-    std::vector<vec3> result(pixels.size());
+void gaussian_blur(const image_planes& in, image_planes& out, float sigma, thread_pool& pool, image_planes& temp) {
     int radius = static_cast<int>(std::ceil(3.0f * sigma));
-    
+
     // Precompute Gaussian kernel
     std::vector<float> kernel;
     float sum = 0.0f;
@@ -51,74 +195,450 @@ std::vector<vec3> gaussian_blur(const std::vector<vec3>& pixels, int width, int
     }
     // Normalize kernel
     for (float& v : kernel) v /= sum;
-    
-    // Apply horizontal pass
-    std::vector<vec3> temp(pixels.size());
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            vec3 color(0, 0, 0);
-            for (int i = -radius; i <= radius; ++i) {
-                vec3 pixel = get_pixel_safe(pixels, width, height, x + i, y);
-                float weight = kernel[i + radius];
-                color = color + pixel * weight;
+
+    separable_blur(in, out, kernel, pool, temp);
+}
+
+// Range metric of both bilateral filters: v / (1 + v). Near black it is the
+// value itself; on a linear HDR frame, differences between bright values
+// shrink as they would after tonemapping, so one sigma_color fits the whole
+// range and emissive highlights are filtered like the rest.
+static float range_value(float v) {
+    return v / (1.0f + std::abs(v));
+}
+
+// Bilateral filter: Edge-preserving blur (best quality)
+void bilateral_filter(const image_planes& in, image_planes& out, float sigma_space, float sigma_color,
+                      thread_pool& pool, image_planes& temp, image_planes& range) {
+    const kernel_table& k = kernels();
+    const int width = in.width;
+    const int height = in.height;
+    const int radius = static_cast<int>(std::ceil(3.0f * sigma_space));
+    const int diameter = 2 * radius + 1;
+    const int padded_width = width + 2 * radius;
+    out.resize(width, height);
+
+    // Copy padded by radius clamped pixels on every side: every window is
+    // then in bounds and the kernel never clamps
+    temp.resize(padded_width, height + 2 * radius);
+    range.resize(padded_width, height + 2 * radius);
+    parallel_rows(pool, height + 2 * radius, [&](int first, int end) {
+        for (int c = 0; c < 3; ++c) {
+            for (int y = first; y < end; ++y) {
+                const int sy = std::clamp(y - radius, 0, height - 1);
+                const std::size_t offset = static_cast<std::size_t>(y) * padded_width;
+                pad_row(in.channel[c].data() + static_cast<std::size_t>(sy) * width, width, radius,
+                        temp.channel[c].data() + offset);
+                const float* padded = temp.channel[c].data() + offset;
+                float* compressed = range.channel[c].data() + offset;
+                for (int x = 0; x < padded_width; ++x) compressed[x] = range_value(padded[x]);
             }
-            temp[y * width + x] = color;
+        }
+    });
+
+    // Spatial weights only depend on the offset: compute them once
+    std::vector<float> spatial(diameter * diameter);
+    for (int dy = -radius; dy <= radius; ++dy) {
+        for (int dx = -radius; dx <= radius; ++dx) {
+            float dist_sq = static_cast<float>(dx * dx + dy * dy);
+            spatial[(dy + radius) * diameter + dx + radius] = std::exp(-dist_sq / (2.0f * sigma_space * sigma_space));
         }
     }
-    
-    // Apply vertical pass
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            vec3 color(0, 0, 0);
-            for (int i = -radius; i <= radius; ++i) {
-                vec3 pixel = get_pixel_safe(temp, width, height, x, y + i);
-                float weight = kernel[i + radius];
-                color = color + pixel * weight;
+    const float inv_two_sigma_color_sq = 1.0f / (2.0f * sigma_color * sigma_color);
+
+    parallel_rows(pool, height, [&](int first, int end) {
+        thread_local std::vector<float> accum;
+        accum.resize(4 * static_cast<std::size_t>(width));
+
+        for (int y = first; y < end; ++y) {
+            // Padded row y is the top of the window around output row y
+            const std::size_t window_offset = static_cast<std::size_t>(y) * padded_width;
+            const float* window[3] = {temp.channel[0].data() + window_offset,
+                                      temp.channel[1].data() + window_offset,
+                                      temp.channel[2].data() + window_offset};
+            const float* range_window[3] = {range.channel[0].data() + window_offset,
+                                            range.channel[1].data() + window_offset,
+                                            range.channel[2].data() + window_offset};
+            const std::size_t out_offset = static_cast<std::size_t>(y) * width;
+            float* rows[3] = {out.channel[0].data() + out_offset,
+                              out.channel[1].data() + out_offset,
+                              out.channel[2].data() + out_offset};
+            k.bilateral_row(window, range_window, padded_width, width, radius, spatial.data(), inv_two_sigma_color_sq,
+                            accum.data(), rows);
+        }
+    });
+}
+
+// Grid cells sliced by one tile. Each tile also splats and blurs a cell of
+// halo on each side in x and y (the blur reach), so smaller tiles redo more
+// work; these sizes keep a tile's grid in the L2 cache.
+static constexpr int grid_tile_rows = 16;
+static constexpr int grid_tile_columns = 32;
+
+// Binomial 1 2 1 / 4 along each axis of the grid: a Gaussian of variance 1/2 cell^2
+static const float grid_blur_weights[3] = {0.25f, 0.5f, 0.25f};
+static constexpr int grid_halo = 1;
+
+static float luminance(float r, float g, float b) {
+    return 0.2126f * r + 0.7152f * g + 0.0722f * b;
+}
+
+// Range axis of the grid: the luminance in the range metric, so the grid
+// keeps a depth of about 1 / sigma_color cells however bright the highlights
+// or fireflies are
+static float grid_luminance(float r, float g, float b) {
+    return range_value(luminance(r, g, b));
+}
+
+// Bilateral grid, one tile of grid cells per task. A tile row holds (x, z)
+// cells of 4 floats (sum r, g, b, weight) with a cell of zeros around z, so
+// the blurs along z, x and y are all weighted sums of shifted rows like the
+// separable blurs above. Cells outside the image stay empty.
+void bilateral_grid(const image_planes& in, image_planes& out, float sigma_space, float sigma_color,
+                    thread_pool& pool) {
+    const kernel_table& k = kernels();
+    const int width = in.width;
+    const int height = in.height;
+    out.resize(width, height);
+    if (width == 0 || height == 0) return;
+
+    // Luminance range of the frame: the depth of the grid
+    const std::size_t tasks = (static_cast<std::size_t>(height) + rows_per_task - 1) / rows_per_task;
+    std::vector<float> task_min(tasks), task_max(tasks);
+    pool.parallel_for(tasks, [&](std::size_t task) {
+        const std::size_t first = task * rows_per_task * width;
+        const std::size_t end = std::min(static_cast<std::size_t>(height) * width, first + static_cast<std::size_t>(rows_per_task) * width);
+        float lo = grid_luminance(in.channel[0][first], in.channel[1][first], in.channel[2][first]);
+        float hi = lo;
+        for (std::size_t i = first; i < end; ++i) {
+            float l = grid_luminance(in.channel[0][i], in.channel[1][i], in.channel[2][i]);
+            lo = std::min(lo, l);
+            hi = std::max(hi, l);
+        }
+        task_min[task] = lo;
+        task_max[task] = hi;
+    });
+    const float luma_min = *std::min_element(task_min.begin(), task_min.end());
+    const float luma_max = *std::max_element(task_max.begin(), task_max.end());
+
+    // With the trilinear splat and slice (a variance of 1/6 cell^2 each) the
+    // grid blurs by 1/2 + 1/3 cell^2 per axis: size the cells so that matches
+    // the requested sigmas. Cells smaller than a pixel would only make the
+    // grid bigger than the image.
+    const float cell_scale = std::sqrt(1.2f);
+    const float cell_space = std::max(1.0f, sigma_space * cell_scale);
+    const float inv_space = 1.0f / cell_space;
+    const float inv_color = 1.0f / (sigma_color * cell_scale);
+
+    const int grid_width = static_cast<int>((width - 1) * inv_space) + 2;
+    const int grid_height = static_cast<int>((height - 1) * inv_space) + 2;
+    const int grid_depth = static_cast<int>((luma_max - luma_min) * inv_color) + 2;
+    const std::size_t column_floats = static_cast<std::size_t>(grid_depth + 2 * grid_halo) * 4;   // One x cell
+
+    // Grid coordinates of a pixel. iz is clamped: gz may round up to the last cell.
+    struct grid_point { int ix, iz; float fx, fz; };
+    auto locate = [&](int x, float r, float g, float b) {
+        const float gx = x * inv_space;
+        const float gz = (grid_luminance(r, g, b) - luma_min) * inv_color;
+        grid_point p;
+        p.ix = static_cast<int>(gx);
+        p.iz = std::min(static_cast<int>(gz), grid_depth - 2);
+        p.fx = gx - p.ix;
+        p.fz = gz - p.iz;
+        return p;
+    };
+
+    const std::size_t tiles_x = (static_cast<std::size_t>(grid_width) + grid_tile_columns - 1) / grid_tile_columns;
+    const std::size_t tiles_y = (static_cast<std::size_t>(grid_height) + grid_tile_rows - 1) / grid_tile_rows;
+    pool.parallel_for(tiles_x * tiles_y, [&](std::size_t tile) {
+        // Sliced cells [i0, i1) x [j0, j1) read the blurred cells up to i1, j1,
+        // which read the splatted cells from i0 - 1, j0 - 1 to i1 + 1, j1 + 1
+        const int i0 = static_cast<int>(tile % tiles_x) * grid_tile_columns;
+        const int i1 = std::min(grid_width, i0 + grid_tile_columns);
+        const int j0 = static_cast<int>(tile / tiles_x) * grid_tile_rows;
+        const int j1 = std::min(grid_height, j0 + grid_tile_rows);
+        const int columns = i1 - i0 + 1 + 2 * grid_halo;
+        const int rows = j1 - j0 + 1 + 2 * grid_halo;
+        const std::size_t row_floats = columns * column_floats;
+        auto cell = [&](int x, int z) { return (x - i0 + grid_halo) * column_floats + (z + grid_halo) * 4; };
+
+        thread_local std::vector<float> slab, blurred, line;
+        slab.assign(rows * row_floats, 0.0f);
+        blurred.resize((j1 - j0 + 1) * row_floats);
+        line.resize(row_floats);
+
+        // Image area that splats into the tile, and the area sliced from it
+        const int x_begin = std::max(0, static_cast<int>((i0 - 3) * cell_space) - 1);
+        const int x_end = std::min(width, static_cast<int>((i1 + 3) * cell_space) + 2);
+        const int y_begin = std::max(0, static_cast<int>((j0 - 3) * cell_space) - 1);
+        const int y_end = std::min(height, static_cast<int>((j1 + 3) * cell_space) + 2);
+
+        // Splat: every pixel adds (r, g, b, 1) to its 8 neighbouring cells
+        for (int y = y_begin; y < y_end; ++y) {
+            const float gy = y * inv_space;
+            const int iy = static_cast<int>(gy);
+            const float fy = gy - iy;
+            const int local_y = iy - j0 + grid_halo;
+            if (local_y < -1 || local_y >= rows) continue;
+
+            const std::size_t offset = static_cast<std::size_t>(y) * width;
+            for (int x = x_begin; x < x_end; ++x) {
+                const float r = in.channel[0][offset + x];
+                const float g = in.channel[1][offset + x];
+                const float b = in.channel[2][offset + x];
+                const grid_point p = locate(x, r, g, b);
+                const int local_x = p.ix - i0 + grid_halo;
+                if (local_x < -1 || local_x >= columns) continue;
+
+                for (int dy = 0; dy < 2; ++dy) {
+                    if (local_y + dy < 0 || local_y + dy >= rows) continue;
+                    float* row = slab.data() + (local_y + dy) * row_floats;
+                    const float wy = dy ? fy : 1.0f - fy;
+                    for (int dx = 0; dx < 2; ++dx) {
+                        if (local_x + dx < 0 || local_x + dx >= columns) continue;
+                        const float wxy = wy * (dx ? p.fx : 1.0f - p.fx);
+                        const float w0 = wxy * (1.0f - p.fz);
+                        const float w1 = wxy * p.fz;
+                        float* c = row + cell(p.ix + dx, p.iz);
+                        c[0] += w0 * r;  c[1] += w0 * g;  c[2] += w0 * b;  c[3] += w0;
+                        c[4] += w1 * r;  c[5] += w1 * g;  c[6] += w1 * b;  c[7] += w1;
+                    }
+                }
             }
-            result[y * width + x] = color;
         }
-    }
-    
-    return result;
+
+        // Blur along z then x, one tile row at a time. Tap k is the row shifted
+        // by k - 1 cells; the zeros around z stand in for the missing cells and
+        // the x halo columns are only read, never blurred.
+        const int taps_count = 2 * grid_halo + 1;
+        const std::size_t pad_floats = grid_halo * 4;
+        const std::size_t inner_floats = (columns - 2 * grid_halo) * column_floats;
+        const float* taps[2 * grid_halo + 1];
+        for (int row = 0; row < rows; ++row) {
+            float* data = slab.data() + row * row_floats;
+            for (int i = 0; i < taps_count; ++i) taps[i] = data + i * 4;
+            k.weighted_row_sum(taps, grid_blur_weights, taps_count, line.data(), row_floats - 2 * pad_floats);
+            std::memcpy(data + pad_floats, line.data(), sizeof(float) * (row_floats - 2 * pad_floats));
+            // The zeros around z picked up the neighbouring columns: clear them
+            for (int x = 0; x < columns; ++x) {
+                std::fill(data + x * column_floats, data + x * column_floats + pad_floats, 0.0f);
+                std::fill(data + (x + 1) * column_floats - pad_floats, data + (x + 1) * column_floats, 0.0f);
+            }
+
+            for (int i = 0; i < taps_count; ++i) taps[i] = data + i * column_floats;
+            k.weighted_row_sum(taps, grid_blur_weights, taps_count, line.data(), inner_floats);
+            std::memcpy(data + grid_halo * column_floats, line.data(), sizeof(float) * inner_floats);
+        }
+
+        // Blur along y into the rows that get sliced
+        for (int row = 0; row <= j1 - j0; ++row) {
+            for (int i = 0; i < taps_count; ++i) taps[i] = slab.data() + (row + i) * row_floats;
+            k.weighted_row_sum(taps, grid_blur_weights, taps_count, blurred.data() + row * row_floats, row_floats);
+        }
+
+        // Slice: trilinear read of the cells around each pixel of the tile
+        for (int y = y_begin; y < y_end; ++y) {
+            const float gy = y * inv_space;
+            const int iy = static_cast<int>(gy);
+            if (iy < j0 || iy >= j1) continue;
+            const float fy = gy - iy;
+
+            const std::size_t offset = static_cast<std::size_t>(y) * width;
+            for (int x = x_begin; x < x_end; ++x) {
+                const float r = in.channel[0][offset + x];
+                const float g = in.channel[1][offset + x];
+                const float b = in.channel[2][offset + x];
+                const grid_point p = locate(x, r, g, b);
+                if (p.ix < i0 || p.ix >= i1) continue;
+
+                float sum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+                for (int dy = 0; dy < 2; ++dy) {
+                    const float* row = blurred.data() + (iy - j0 + dy) * row_floats;
+                    const float wy = dy ? fy : 1.0f - fy;
+                    for (int dx = 0; dx < 2; ++dx) {
+                        const float wxy = wy * (dx ? p.fx : 1.0f - p.fx);
+                        const float w0 = wxy * (1.0f - p.fz);
+                        const float w1 = wxy * p.fz;
+                        const float* c = row + cell(p.ix + dx, p.iz);
+                        for (int i = 0; i < 4; ++i) sum[i] += w0 * c[i] + w1 * c[4 + i];
+                    }
+                }
+
+                // The pixel itself is in the grid, so the weight is positive
+                // unless it underflowed: keep the input then
+                if (sum[3] > 1e-20f) {
+                    const float inv = 1.0f / sum[3];
+                    out.channel[0][offset + x] = sum[0] * inv;
+                    out.channel[1][offset + x] = sum[1] * inv;
+                    out.channel[2][offset + x] = sum[2] * inv;
+                } else {
+                    out.channel[0][offset + x] = r;
+                    out.channel[1][offset + x] = g;
+                    out.channel[2][offset + x] = b;
+                }
+            }
+        }
+    });
 }
 
-// Bilateral filter: Edge-preserving blur (best quality)
-std::vector<vec3> bilateral_filter(const std::vector<vec3>& pixels, int width, int height, float sigma_space, float sigma_color) {
-    std::vector<vec3> result(pixels.size());
-    int radius = static_cast<int>(std::ceil(3.0f * sigma_space));
-    
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            vec3 center_pixel = pixels[y * width + x];
-            vec3 sum(0, 0, 0);
-            float weight_sum = 0.0f;
-            
-            // Weighted average based on spatial AND color distance
-            for (int dy = -radius; dy <= radius; ++dy) {
-                for (int dx = -radius; dx <= radius; ++dx) {
-                    vec3 neighbor = get_pixel_safe(pixels, width, height, x + dx, y + dy);
-                    
-                    // Spatial weight (Gaussian based on distance)
-                    float spatial_dist = std::sqrt(dx * dx + dy * dy);
-                    float spatial_weight = std::exp(-(spatial_dist * spatial_dist) / (2.0f * sigma_space * sigma_space));
-                    
-                    // Color weight (Gaussian based on color difference)
-                    vec3 color_diff = neighbor - center_pixel;
-                    float color_dist = std::sqrt(color_diff.length_squared());
-                    float color_weight = std::exp(-(color_dist * color_dist) / (2.0f * sigma_color * sigma_color));
-                    
-                    // Combined weight
-                    float total_weight = spatial_weight * color_weight;
-                    sum = sum + neighbor * total_weight;
-                    weight_sum += total_weight;
+// À-trous passes: taps 1, 2, 4, 8 and 16 pixels apart cover a 61 x 61 window
+static constexpr int atrous_passes = 5;
+
+// Albedo below this is clamped before dividing the color by it, so black
+// surfaces do not turn into huge irradiance values
+static constexpr float min_albedo = 0.01f;
+
+// Flushes denormals to zero on this thread while it lives. Far taps of the
+// à-trous filter get weights below the normal float range, and arithmetic
+// on denormals is very slow on x86.
+struct flush_denormals {
+#if defined(__SSE__)
+    unsigned int saved = _mm_getcsr();
+    flush_denormals() { _mm_setcsr(saved | 0x8040); }   // FTZ | DAZ
+    ~flush_denormals() { _mm_setcsr(saved); }
+#endif
+};
+
+void atrous_filter(const image_planes& in, image_planes& out, const aov::frame& guides, int samples_per_pixel,
+                   float sigma_luminance, thread_pool& pool, workspace& scratch) {
+    const kernel_table& k = kernels();
+    const int width = in.width;
+    const int height = in.height;
+    const std::size_t pixel_count = static_cast<std::size_t>(width) * height;
+    out.resize(width, height);
+    scratch.temp.resize(width, height);
+    scratch.demodulated.resize(width, height);
+    scratch.variance[0].resize(pixel_count);
+    scratch.variance[1].resize(pixel_count);
+    scratch.depth_gradient.resize(pixel_count);
+    const float inv_samples = 1.0f / std::max(1, samples_per_pixel);
+    const std::vector<float>& depth = guides.depth;
+
+    // Demodulate the color and the variance of the pixel mean by the albedo.
+    // The depth gradient takes the smaller one-sided difference on each axis,
+    // so it stays small along silhouettes.
+    parallel_rows(pool, height, [&](int first, int end) {
+        for (int y = first; y < end; ++y) {
+            for (int x = 0; x < width; ++x) {
+                const std::size_t i = static_cast<std::size_t>(y) * width + x;
+                float albedo[3];
+                for (int c = 0; c < 3; ++c) {
+                    albedo[c] = std::max(min_albedo, guides.albedo.channel[c][i]);
+                    scratch.demodulated.channel[c][i] = in.channel[c][i] / albedo[c];
                 }
+                const float albedo_luminance = luminance(albedo[0], albedo[1], albedo[2]);
+                scratch.variance[0][i] = guides.variance[i] * inv_samples / (albedo_luminance * albedo_luminance);
+
+                auto slope = [&](std::size_t before, std::size_t after, bool has_before, bool has_after) {
+                    const float d0 = has_before ? std::fabs(depth[i] - depth[before]) : HUGE_VALF;
+                    const float d1 = has_after ? std::fabs(depth[after] - depth[i]) : HUGE_VALF;
+                    const float d = std::min(d0, d1);
+                    return d == HUGE_VALF ? 0.0f : d;
+                };
+                const float gx = slope(i - 1, i + 1, x > 0, x + 1 < width);
+                const float gy = slope(i - width, i + width, y > 0, y + 1 < height);
+                scratch.depth_gradient[i] = std::sqrt(gx * gx + gy * gy);
             }
-            
-            result[y * width + x] = sum / weight_sum;
         }
+    });
+
+    atrous_guides guide_planes;
+    for (int c = 0; c < 3; ++c) guide_planes.normal[c] = guides.normal.channel[c].data();
+    guide_planes.depth = depth.data();
+    guide_planes.depth_gradient = scratch.depth_gradient.data();
+    guide_planes.specular = guides.specular.data();
+    guide_planes.width = width;
+    guide_planes.height = height;
+
+    // Ping-pong between temp and out so that the last pass writes out
+    const image_planes* source = &scratch.demodulated;
+    for (int pass = 0; pass < atrous_passes; ++pass) {
+        image_planes& target = (atrous_passes - 1 - pass) % 2 == 0 ? out : scratch.temp;
+        const float* variance = scratch.variance[pass % 2].data();
+        float* next_variance = scratch.variance[(pass + 1) % 2].data();
+        const float* color[3] = {source->channel[0].data(), source->channel[1].data(), source->channel[2].data()};
+
+        parallel_rows(pool, height, [&](int first, int end) {
+            flush_denormals guard;
+            thread_local std::vector<float> accum, luminance_scale;
+            accum.resize(5 * static_cast<std::size_t>(width));
+            luminance_scale.resize(width);
+
+            for (int y = first; y < end; ++y) {
+                // Luminance tolerance from the 3 x 3 blurred variance: a single
+                // pixel estimate is itself noisy
+                const float* rows[3];
+                for (int j = 0; j < 3; ++j) {
+                    rows[j] = variance + static_cast<std::size_t>(std::clamp(y + j - 1, 0, height - 1)) * width;
+                }
+                for (int x = 0; x < width; ++x) {
+                    const int left = std::max(x - 1, 0);
+                    const int right = std::min(x + 1, width - 1);
+                    float blurred = 0.0f;
+                    for (int j = 0; j < 3; ++j) {
+                        const float w = j == 1 ? 0.5f : 0.25f;
+                        blurred += w * (0.25f * rows[j][left] + 0.5f * rows[j][x] + 0.25f * rows[j][right]);
+                    }
+                    luminance_scale[x] = 1.0f / (sigma_luminance * std::sqrt(blurred + 1e-10f));
+                }
+
+                const std::size_t offset = static_cast<std::size_t>(y) * width;
+                float* out_rows[3] = {target.channel[0].data() + offset, target.channel[1].data() + offset,
+                                      target.channel[2].data() + offset};
+                k.atrous_row(color, variance, guide_planes, y, 1 << pass, luminance_scale.data(), accum.data(),
+                             out_rows, next_variance + offset);
+            }
+        });
+        source = &target;
     }
-    
-    return result;
+
+    // Multiply the filtered irradiance back by the albedo. Specular chains
+    // keep their input: their color is the mirror's own lighting plus the
+    // surface it shows, and the guides only follow the second.
+    parallel_rows(pool, height, [&](int first, int end) {
+        const std::size_t last = static_cast<std::size_t>(end) * width;
+        for (int c = 0; c < 3; ++c) {
+            for (std::size_t i = static_cast<std::size_t>(first) * width; i < last; ++i) {
+                const float filtered = out.channel[c][i] * std::max(min_albedo, guides.albedo.channel[c][i]);
+                out.channel[c][i] = filtered + guides.specular[i] * (in.channel[c][i] - filtered);
+            }
+        }
+    });
+}
+
+void box_blur(std::vector<vec3>& pixels, int width, int height, int radius,
+              thread_pool& pool, workspace& scratch) {
+    to_planes(pixels, width, height, scratch.image, pool);
+    box_blur(scratch.image, scratch.result, radius, pool, scratch.temp);
+    from_planes(scratch.result, pixels, pool);
+}
+
+void gaussian_blur(std::vector<vec3>& pixels, int width, int height, float sigma,
+                   thread_pool& pool, workspace& scratch) {
+    to_planes(pixels, width, height, scratch.image, pool);
+    gaussian_blur(scratch.image, scratch.result, sigma, pool, scratch.temp);
+    from_planes(scratch.result, pixels, pool);
+}
+
+void bilateral_filter(std::vector<vec3>& pixels, int width, int height, float sigma_space, float sigma_color,
+                      thread_pool& pool, workspace& scratch) {
+    to_planes(pixels, width, height, scratch.image, pool);
+    bilateral_filter(scratch.image, scratch.result, sigma_space, sigma_color, pool, scratch.temp, scratch.range);
+    from_planes(scratch.result, pixels, pool);
+}
+
+void bilateral_grid(std::vector<vec3>& pixels, int width, int height, float sigma_space, float sigma_color,
+                    thread_pool& pool, workspace& scratch) {
+    to_planes(pixels, width, height, scratch.image, pool);
+    bilateral_grid(scratch.image, scratch.result, sigma_space, sigma_color, pool);
+    from_planes(scratch.result, pixels, pool);
+}
+
+void atrous_filter(std::vector<vec3>& pixels, int width, int height, const aov::frame& guides,
+                   int samples_per_pixel, float sigma_luminance, thread_pool& pool, workspace& scratch) {
+    to_planes(pixels, width, height, scratch.image, pool);
+    atrous_filter(scratch.image, scratch.result, guides, samples_per_pixel, sigma_luminance, pool, scratch);
+    from_planes(scratch.result, pixels, pool);
 }
 
 } // namespace denoise
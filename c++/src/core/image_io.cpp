@@ -0,0 +1,700 @@
+#include "core/image_io.hpp"
+#include "core/deflate.hpp"
+#include "core/thread_pool.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace image_io {
+
+// Write a complete file from one buffer
+static bool write_file(const std::string& path, const std::vector<std::uint8_t>& data) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+    file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    return static_cast<bool>(file);
+}
+
+std::uint8_t to_byte(real value) {
+    // Same mapping as the former ASCII writer: [0, 0.999] -> [0, 255]
+    return static_cast<std::uint8_t>(256 * std::clamp(value, real(0), real(0.999)));
+}
+
+// Append a big-endian 32-bit value (QOI and PNG headers)
+static void put_u32(std::vector<std::uint8_t>& data, std::uint32_t value) {
+    data.push_back(static_cast<std::uint8_t>(value >> 24));
+    data.push_back(static_cast<std::uint8_t>(value >> 16));
+    data.push_back(static_cast<std::uint8_t>(value >> 8));
+    data.push_back(static_cast<std::uint8_t>(value));
+}
+
+bool format_from_path(const std::string& path, format& fmt) {
+    std::size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos) return false;
+    std::string ext = path.substr(dot + 1);
+    for (char& c : ext) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+
+    if (ext == "ppm") fmt = format::ppm;
+    else if (ext == "png") fmt = format::png;
+    else if (ext == "qoi") fmt = format::qoi;
+    else return false;
+    return true;
+}
+
+void quantize(const vec3* pixels, std::size_t count, std::uint8_t* rgb) {
+    for (std::size_t i = 0; i < count; ++i) {
+        rgb[3 * i + 0] = to_byte(pixels[i].x);
+        rgb[3 * i + 1] = to_byte(pixels[i].y);
+        rgb[3 * i + 2] = to_byte(pixels[i].z);
+    }
+}
+
+// Quantize a frame, rows in parallel
+static std::vector<std::uint8_t> quantize_frame(const std::vector<vec3>& pixels, int width, int height,
+                                                thread_pool& pool) {
+    std::vector<std::uint8_t> rgb(static_cast<std::size_t>(width) * height * 3);
+    pool.parallel_for(static_cast<std::size_t>(height), [&](std::size_t y) {
+        quantize(pixels.data() + y * width, width, rgb.data() + y * width * 3);
+    });
+    return rgb;
+}
+
+static std::vector<std::uint8_t> quantize_frame(const std::vector<vec3>& pixels, int width, int height) {
+    std::vector<std::uint8_t> rgb(static_cast<std::size_t>(width) * height * 3);
+    quantize(pixels.data(), rgb.size() / 3, rgb.data());
+    return rgb;
+}
+
+static bool write_ppm(const std::string& path, const std::uint8_t* rgb, int width, int height);
+static bool write_qoi(const std::string& path, const std::uint8_t* rgb, int width, int height);
+static bool write_png(const std::string& path, const std::uint8_t* rgb, int width, int height, thread_pool& pool);
+
+bool write_image(const std::string& path, const std::vector<std::uint8_t>& rgb, int width, int height,
+                 thread_pool& pool) {
+    format fmt;
+    if (!format_from_path(path, fmt)) return false;
+    switch (fmt) {
+        case format::ppm: return write_ppm(path, rgb.data(), width, height);
+        case format::png: return write_png(path, rgb.data(), width, height, pool);
+        case format::qoi: return write_qoi(path, rgb.data(), width, height);
+    }
+    return false;
+}
+
+bool write_image(const std::string& path, const std::vector<vec3>& pixels, int width, int height,
+                 thread_pool& pool) {
+    format fmt;
+    if (!format_from_path(path, fmt)) return false;
+    return write_image(path, quantize_frame(pixels, width, height, pool), width, height, pool);
+}
+
+// ==================== PPM ====================
+
+static std::string ppm_header(int width, int height) {
+    return "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+}
+
+static bool write_ppm(const std::string& path, const std::uint8_t* rgb, int width, int height) {
+    std::string header = ppm_header(width, height);
+    const std::size_t pixel_count = static_cast<std::size_t>(width) * height;
+
+    std::vector<std::uint8_t> data(header.size() + pixel_count * 3);
+    std::memcpy(data.data(), header.data(), header.size());
+    std::memcpy(data.data() + header.size(), rgb, pixel_count * 3);
+    return write_file(path, data);
+}
+
+bool write_ppm(const std::string& path, const std::vector<vec3>& pixels, int width, int height) {
+    return write_ppm(path, quantize_frame(pixels, width, height).data(), width, height);
+}
+
+// ==================== QOI ====================
+// Format specification: https://qoiformat.org/qoi-specification.pdf
+
+static void qoi_header(int width, int height, std::vector<std::uint8_t>& data) {
+    data.insert(data.end(), {'q', 'o', 'i', 'f'});
+    put_u32(data, static_cast<std::uint32_t>(width));
+    put_u32(data, static_cast<std::uint32_t>(height));
+    data.push_back(3);  // RGB
+    data.push_back(0);  // sRGB with linear alpha
+}
+
+static void qoi_end_marker(std::vector<std::uint8_t>& data) {
+    data.insert(data.end(), {0, 0, 0, 0, 0, 0, 0, 1});
+}
+
+// Encoder state carried from one batch of pixels to the next
+class qoi_encoder {
+public:
+    explicit qoi_encoder(std::size_t pixel_count) : remaining(pixel_count) {}
+
+    void encode(const std::uint8_t* rgb, std::size_t count, std::vector<std::uint8_t>& data) {
+        constexpr std::uint8_t op_index = 0x00, op_diff = 0x40, op_luma = 0x80, op_run = 0xC0, op_rgb = 0xFE;
+
+        for (std::size_t i = 0; i < count; ++i) {
+            const std::uint8_t* px = rgb + 3 * i;
+            const bool last = --remaining == 0;
+
+            if (px[0] == prev[0] && px[1] == prev[1] && px[2] == prev[2]) {
+                ++run;
+                if (run == 62 || last) {
+                    data.push_back(static_cast<std::uint8_t>(op_run | (run - 1)));
+                    run = 0;
+                }
+                continue;
+            }
+            if (run > 0) {
+                data.push_back(static_cast<std::uint8_t>(op_run | (run - 1)));
+                run = 0;
+            }
+
+            const int slot = (px[0] * 3 + px[1] * 5 + px[2] * 7 + 255 * 11) % 64;
+            if (seen[slot][0] == px[0] && seen[slot][1] == px[1] && seen[slot][2] == px[2] && seen[slot][3] == 255) {
+                data.push_back(static_cast<std::uint8_t>(op_index | slot));
+            } else {
+                std::memcpy(seen[slot], px, 3);
+                seen[slot][3] = 255;
+
+                // Channel differences wrap around (signed 8-bit arithmetic)
+                const int dr = static_cast<std::int8_t>(px[0] - prev[0]);
+                const int dg = static_cast<std::int8_t>(px[1] - prev[1]);
+                const int db = static_cast<std::int8_t>(px[2] - prev[2]);
+                const int dr_dg = dr - dg;
+                const int db_dg = db - dg;
+
+                if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                    data.push_back(static_cast<std::uint8_t>(op_diff | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2)));
+                } else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 && db_dg >= -8 && db_dg <= 7) {
+                    data.push_back(static_cast<std::uint8_t>(op_luma | (dg + 32)));
+                    data.push_back(static_cast<std::uint8_t>(((dr_dg + 8) << 4) | (db_dg + 8)));
+                } else {
+                    data.insert(data.end(), {op_rgb, px[0], px[1], px[2]});
+                }
+            }
+            std::memcpy(prev, px, 3);
+        }
+    }
+
+private:
+    std::size_t remaining;
+    // Previously seen pixels as RGBA: the table starts as transparent black,
+    // which never matches an opaque pixel
+    std::uint8_t seen[64][4] = {};
+    std::uint8_t prev[3] = {0, 0, 0};  // Alpha stays 255 throughout
+    int run = 0;
+};
+
+static bool write_qoi(const std::string& path, const std::uint8_t* rgb, int width, int height) {
+    const std::size_t pixel_count = static_cast<std::size_t>(width) * height;
+
+    std::vector<std::uint8_t> data;
+    data.reserve(14 + pixel_count * 4 + 8);  // Worst case: every pixel as QOI_OP_RGB
+    qoi_header(width, height, data);
+    qoi_encoder encoder(pixel_count);
+    encoder.encode(rgb, pixel_count, data);
+    qoi_end_marker(data);
+    return write_file(path, data);
+}
+
+bool write_qoi(const std::string& path, const std::vector<vec3>& pixels, int width, int height) {
+    return write_qoi(path, quantize_frame(pixels, width, height).data(), width, height);
+}
+
+// ==================== PNG ====================
+
+// Rows per compressed band: bands of at least 128 KiB keep the ratio close to
+// a single stream. Fixed by the row size only, so the output is the same for
+// any thread count.
+static std::size_t rows_per_band(std::size_t row_bytes) {
+    return std::max<std::size_t>(1, (std::size_t(128) << 10) / row_bytes);
+}
+
+static int paeth(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) return a;
+    if (pb <= pc) return b;
+    return c;
+}
+
+// Filter one row with each of the five PNG filters and keep the one with the
+// smallest sum of absolute (signed) residuals, the usual libpng heuristic.
+// out has room for the filter byte followed by the row.
+static void filter_row(const std::uint8_t* row, const std::uint8_t* above, std::size_t row_bytes,
+                       std::uint8_t* out, std::vector<std::uint8_t>& scratch) {
+    constexpr std::size_t bpp = 3;
+    scratch.resize(row_bytes);
+    unsigned long best_cost = ~0ul;
+
+    for (int filter = 0; filter < 5; ++filter) {
+        unsigned long cost = 0;
+        for (std::size_t i = 0; i < row_bytes; ++i) {
+            int a = i >= bpp ? row[i - bpp] : 0;
+            int b = above ? above[i] : 0;
+            int c = (above && i >= bpp) ? above[i - bpp] : 0;
+            int predicted = 0;
+            switch (filter) {
+                case 1: predicted = a; break;
+                case 2: predicted = b; break;
+                case 3: predicted = (a + b) >> 1; break;
+                case 4: predicted = paeth(a, b, c); break;
+                default: break;
+            }
+            std::uint8_t residual = static_cast<std::uint8_t>(row[i] - predicted);
+            scratch[i] = residual;
+            cost += static_cast<unsigned long>(std::abs(static_cast<int>(static_cast<std::int8_t>(residual))));
+        }
+        if (cost < best_cost) {
+            best_cost = cost;
+            out[0] = static_cast<std::uint8_t>(filter);
+            std::memcpy(out + 1, scratch.data(), row_bytes);
+        }
+    }
+}
+
+static void put_chunk(std::vector<std::uint8_t>& data, const char* type,
+                      const std::uint8_t* payload, std::size_t size) {
+    put_u32(data, static_cast<std::uint32_t>(size));
+    const std::size_t start = data.size();
+    data.insert(data.end(), type, type + 4);
+    if (size > 0) data.insert(data.end(), payload, payload + size);
+    put_u32(data, deflate::crc32(data.data() + start, size + 4));
+}
+
+// PNG encoder fed rows top to bottom. It keeps what the next rows need: the
+// previous row (filters), the last 32 KiB of filtered data (deflate history)
+// and the running adler32 of the zlib stream.
+class png_encoder {
+public:
+    png_encoder(int width, int height)
+        : width(width), height(height), row_bytes(static_cast<std::size_t>(width) * 3) {}
+
+    // Signature, IHDR and the zlib stream header
+    void begin(std::vector<std::uint8_t>& data) const {
+        data.insert(data.end(), {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'});
+
+        std::vector<std::uint8_t> ihdr;
+        put_u32(ihdr, static_cast<std::uint32_t>(width));
+        put_u32(ihdr, static_cast<std::uint32_t>(height));
+        ihdr.insert(ihdr.end(), {8, 2, 0, 0, 0});  // 8-bit, truecolor, deflate, adaptive filters, no interlace
+        put_chunk(data, "IHDR", ihdr.data(), ihdr.size());
+
+        const std::uint8_t zlib_header[2] = {0x78, 0x01};  // 32 KiB window, no preset dictionary
+        put_chunk(data, "IDAT", zlib_header, 2);
+    }
+
+    // Filter and compress the next count rows of 8-bit RGB: one IDAT per band
+    void encode_rows(const std::uint8_t* rgb, int count, thread_pool& pool, std::vector<std::uint8_t>& data) {
+        const std::size_t line_bytes = row_bytes + 1;  // Filter type byte + row
+        const bool first = rows_done == 0;
+        rows_done += count;
+        const bool final = rows_done == height;
+
+        // Filtered rows go after the deflate history, so bands can reach back
+        // across batch boundaries
+        const std::size_t kept = history.size();
+        std::vector<std::uint8_t> stream(kept + line_bytes * count);
+        std::memcpy(stream.data(), history.data(), kept);
+        pool.parallel_for(static_cast<std::size_t>(count), [&](std::size_t y) {
+            thread_local std::vector<std::uint8_t> scratch;
+            // The first row of a batch sits below the last row of the previous one
+            const std::uint8_t* above = y > 0 ? rgb + (y - 1) * row_bytes : first ? nullptr : last_row.data();
+            filter_row(rgb + y * row_bytes, above, row_bytes,
+                       stream.data() + kept + y * line_bytes, scratch);
+        });
+
+        // Compress the bands independently; each one sees the previous 32 KiB
+        // as history, so matches still cross band boundaries
+        const std::size_t band_rows = rows_per_band(line_bytes);
+        const std::size_t band_count = (static_cast<std::size_t>(count) + band_rows - 1) / band_rows;
+        std::vector<std::vector<std::uint8_t>> compressed(band_count);
+        std::vector<std::uint32_t> band_adler(band_count);
+
+        pool.parallel_for(band_count, [&](std::size_t band) {
+            const std::size_t begin = kept + band * band_rows * line_bytes;
+            const std::size_t end = std::min(stream.size(), begin + band_rows * line_bytes);
+            const std::uint8_t* start = stream.data() + begin;
+            compressed[band] = deflate::compress(start, end - begin, stream.data(), begin,
+                                                 final && band + 1 == band_count);
+            band_adler[band] = deflate::adler32(start, end - begin);
+        });
+
+        for (std::size_t band = 0; band < band_count; ++band) {
+            const std::size_t begin = band * band_rows * line_bytes;
+            const std::size_t size = std::min(line_bytes * count - begin, band_rows * line_bytes);
+            adler = deflate::adler32_combine(adler, band_adler[band], size);
+            put_chunk(data, "IDAT", compressed[band].data(), compressed[band].size());
+        }
+
+        last_row.assign(rgb + (count - 1) * row_bytes, rgb + count * row_bytes);
+        const std::size_t tail = std::min(stream.size(), deflate::window_size);
+        history.assign(stream.end() - tail, stream.end());
+    }
+
+    // zlib checksum and IEND, once all rows are in
+    void finish(std::vector<std::uint8_t>& data) const {
+        std::vector<std::uint8_t> trailer;
+        put_u32(trailer, adler);
+        put_chunk(data, "IDAT", trailer.data(), trailer.size());
+        put_chunk(data, "IEND", nullptr, 0);
+    }
+
+private:
+    int width;
+    int height;
+    std::size_t row_bytes;
+    int rows_done = 0;
+    std::uint32_t adler = 1;
+    std::vector<std::uint8_t> last_row;
+    std::vector<std::uint8_t> history;
+};
+
+static bool write_png(const std::string& path, const std::uint8_t* rgb, int width, int height, thread_pool& pool) {
+    std::vector<std::uint8_t> data;
+    data.reserve(static_cast<std::size_t>(width) * height + 1024);
+    png_encoder encoder(width, height);
+    encoder.begin(data);
+    encoder.encode_rows(rgb, height, pool, data);
+    encoder.finish(data);
+    return write_file(path, data);
+}
+
+bool write_png(const std::string& path, const std::vector<vec3>& pixels, int width, int height,
+               thread_pool& pool) {
+    return write_png(path, quantize_frame(pixels, width, height, pool).data(), width, height, pool);
+}
+
+// ==================== PFM ====================
+
+static std::string pfm_header(int width, int height, int channels = 3) {
+    // Negative scale = little-endian floats
+    const std::uint16_t probe = 1;
+    const bool little_endian = *reinterpret_cast<const std::uint8_t*>(&probe) == 1;
+    return std::string(channels == 1 ? "Pf\n" : "PF\n") + std::to_string(width) + " " + std::to_string(height) + "\n"
+         + (little_endian ? "-1.0\n" : "1.0\n");
+}
+
+static void to_floats(const vec3* row, int width, float* out) {
+    for (int x = 0; x < width; ++x) {
+        out[3 * x + 0] = static_cast<float>(row[x].x);
+        out[3 * x + 1] = static_cast<float>(row[x].y);
+        out[3 * x + 2] = static_cast<float>(row[x].z);
+    }
+}
+
+bool write_pfm(const std::string& path, const std::vector<vec3>& pixels, int width, int height) {
+    std::string header = pfm_header(width, height);
+    const std::size_t row_bytes = static_cast<std::size_t>(width) * 3 * sizeof(float);
+    std::vector<std::uint8_t> data(header.size() + row_bytes * height);
+    std::memcpy(data.data(), header.data(), header.size());
+
+    // Rows are converted in a small buffer (the file buffer is not float-aligned)
+    std::vector<float> row_floats(static_cast<std::size_t>(width) * 3);
+    for (int y = 0; y < height; ++y) {
+        // PFM stores the bottom row first
+        to_floats(pixels.data() + static_cast<std::size_t>(height - 1 - y) * width, width, row_floats.data());
+        std::memcpy(data.data() + header.size() + row_bytes * y, row_floats.data(), row_bytes);
+    }
+    return write_file(path, data);
+}
+
+bool write_pfm(const std::string& path, const float* const* planes, int channels, int width, int height) {
+    if (channels != 1 && channels != 3) return false;
+    std::string header = pfm_header(width, height, channels);
+    const std::size_t row_bytes = static_cast<std::size_t>(width) * channels * sizeof(float);
+    std::vector<std::uint8_t> data(header.size() + row_bytes * height);
+    std::memcpy(data.data(), header.data(), header.size());
+
+    std::vector<float> row_floats(static_cast<std::size_t>(width) * channels);
+    for (int y = 0; y < height; ++y) {
+        // PFM stores the bottom row first; channels are interleaved
+        const std::size_t offset = static_cast<std::size_t>(height - 1 - y) * width;
+        for (int x = 0; x < width; ++x) {
+            for (int c = 0; c < channels; ++c) row_floats[x * channels + c] = planes[c][offset + x];
+        }
+        std::memcpy(data.data() + header.size() + row_bytes * y, row_floats.data(), row_bytes);
+    }
+    return write_file(path, data);
+}
+
+// Whole file in one read
+static bool read_file(const std::string& path, std::vector<std::uint8_t>& data) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) return false;
+    const std::streamsize size = file.tellg();
+    if (size < 0) return false;
+    data.resize(static_cast<std::size_t>(size));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(data.data()), size);
+    return static_cast<bool>(file);
+}
+
+// "PF" / "Pf", width, height and scale, separated by whitespace, then one
+// whitespace character before the floats. Returns the offset of the floats,
+// 0 if the header is not valid or the file too short.
+static std::size_t parse_pfm_header(const std::vector<std::uint8_t>& data, int& channels, int& width, int& height,
+                                    bool& swap_bytes) {
+    if (data.size() < 3 || data[0] != 'P' || (data[1] != 'F' && data[1] != 'f')) return 0;
+    channels = data[1] == 'F' ? 3 : 1;
+
+    std::size_t at = 2;
+    std::string tokens[3];
+    for (std::string& token : tokens) {
+        while (at < data.size() && std::isspace(data[at])) ++at;
+        while (at < data.size() && !std::isspace(data[at])) token += static_cast<char>(data[at++]);
+    }
+    if (at >= data.size()) return 0;
+    ++at;
+
+    width = std::atoi(tokens[0].c_str());
+    height = std::atoi(tokens[1].c_str());
+    const double scale = std::atof(tokens[2].c_str());
+    if (width <= 0 || height <= 0 || scale == 0.0) return 0;
+    if (data.size() - at < static_cast<std::size_t>(width) * height * channels * sizeof(float)) return 0;
+
+    // Negative scale = little-endian floats
+    const std::uint16_t probe = 1;
+    const bool little_endian = *reinterpret_cast<const std::uint8_t*>(&probe) == 1;
+    swap_bytes = (scale < 0.0) != little_endian;
+    return at;
+}
+
+// Row y (top row first) of a PFM as floats in out
+static void pfm_row(const std::uint8_t* floats, std::size_t row_floats, int height, int y, bool swap_bytes,
+                    float* out) {
+    std::memcpy(out, floats + (static_cast<std::size_t>(height - 1 - y)) * row_floats * sizeof(float),
+                row_floats * sizeof(float));
+    if (!swap_bytes) return;
+    for (std::size_t i = 0; i < row_floats; ++i) {
+        std::uint32_t bits;
+        std::memcpy(&bits, out + i, sizeof(bits));
+        bits = (bits >> 24) | ((bits >> 8) & 0xFF00) | ((bits << 8) & 0xFF0000) | (bits << 24);
+        std::memcpy(out + i, &bits, sizeof(bits));
+    }
+}
+
+bool read_pfm(const std::string& path, std::vector<vec3>& pixels, int& width, int& height) {
+    std::vector<std::uint8_t> data;
+    int channels;
+    bool swap_bytes;
+    if (!read_file(path, data)) return false;
+    const std::size_t offset = parse_pfm_header(data, channels, width, height, swap_bytes);
+    if (offset == 0 || channels != 3) return false;
+
+    pixels.resize(static_cast<std::size_t>(width) * height);
+    std::vector<float> row(static_cast<std::size_t>(width) * 3);
+    for (int y = 0; y < height; ++y) {
+        pfm_row(data.data() + offset, row.size(), height, y, swap_bytes, row.data());
+        vec3* out = pixels.data() + static_cast<std::size_t>(y) * width;
+        for (int x = 0; x < width; ++x) out[x] = vec3(row[3 * x + 0], row[3 * x + 1], row[3 * x + 2]);
+    }
+    return true;
+}
+
+bool read_pfm(const std::string& path, float* const* planes, int channels, int width, int height) {
+    std::vector<std::uint8_t> data;
+    int file_channels, file_width, file_height;
+    bool swap_bytes;
+    if (!read_file(path, data)) return false;
+    const std::size_t offset = parse_pfm_header(data, file_channels, file_width, file_height, swap_bytes);
+    if (offset == 0 || file_channels != channels || file_width != width || file_height != height) return false;
+
+    std::vector<float> row(static_cast<std::size_t>(width) * channels);
+    for (int y = 0; y < height; ++y) {
+        pfm_row(data.data() + offset, row.size(), height, y, swap_bytes, row.data());
+        const std::size_t first = static_cast<std::size_t>(y) * width;
+        for (int x = 0; x < width; ++x) {
+            for (int c = 0; c < channels; ++c) planes[c][first + x] = row[x * channels + c];
+        }
+    }
+    return true;
+}
+
+// ==================== STREAMING WRITERS ====================
+
+namespace {
+
+// Common part: the open file, the row count and the encoded batch buffer
+class file_writer : public image_writer {
+public:
+    file_writer(const std::string& path, int width, int height)
+        : file(path, std::ios::binary), width(width), height(height) {}
+
+    bool is_open() const { return file.is_open(); }
+
+    bool write_rows(const vec3* pixels, int count) override {
+        if (!file || count <= 0 || rows_written + count > height) return false;
+        buffer.clear();
+        encode(pixels, count, buffer);
+        rows_written += count;
+        return flush();
+    }
+
+    bool write_rows(const std::uint8_t* rgb, int count) override {
+        if (!file || count <= 0 || rows_written + count > height) return false;
+        buffer.clear();
+        if (!encode_bytes(rgb, count, buffer)) return false;
+        rows_written += count;
+        return flush();
+    }
+
+    bool finish() override {
+        if (rows_written != height) return false;
+        buffer.clear();
+        encode_end(buffer);
+        if (!flush()) return false;
+        file.close();
+        return !file.fail();
+    }
+
+protected:
+    virtual void encode(const vec3* pixels, int count, std::vector<std::uint8_t>& data) = 0;
+    // Rows already quantized; false for formats that store floats
+    virtual bool encode_bytes(const std::uint8_t*, int, std::vector<std::uint8_t>&) { return false; }
+    virtual void encode_end(std::vector<std::uint8_t>&) {}
+
+    bool flush() {
+        file.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+        return static_cast<bool>(file);
+    }
+
+    std::ofstream file;
+    int width;
+    int height;
+    int rows_written = 0;
+    std::vector<std::uint8_t> buffer;
+};
+
+class ppm_writer : public file_writer {
+public:
+    ppm_writer(const std::string& path, int width, int height) : file_writer(path, width, height) {
+        std::string header = ppm_header(width, height);
+        buffer.assign(header.begin(), header.end());
+        flush();
+    }
+
+protected:
+    void encode(const vec3* pixels, int count, std::vector<std::uint8_t>& data) override {
+        data.resize(static_cast<std::size_t>(width) * count * 3);
+        quantize(pixels, static_cast<std::size_t>(width) * count, data.data());
+    }
+    bool encode_bytes(const std::uint8_t* rgb, int count, std::vector<std::uint8_t>& data) override {
+        data.assign(rgb, rgb + static_cast<std::size_t>(width) * count * 3);
+        return true;
+    }
+};
+
+class qoi_writer : public file_writer {
+public:
+    qoi_writer(const std::string& path, int width, int height)
+        : file_writer(path, width, height), encoder(static_cast<std::size_t>(width) * height) {
+        qoi_header(width, height, buffer);
+        flush();
+    }
+
+protected:
+    void encode(const vec3* pixels, int count, std::vector<std::uint8_t>& data) override {
+        const std::size_t pixel_count = static_cast<std::size_t>(width) * count;
+        rgb.resize(pixel_count * 3);
+        quantize(pixels, pixel_count, rgb.data());
+        encode_bytes(rgb.data(), count, data);
+    }
+    bool encode_bytes(const std::uint8_t* bytes, int count, std::vector<std::uint8_t>& data) override {
+        encoder.encode(bytes, static_cast<std::size_t>(width) * count, data);
+        return true;
+    }
+    void encode_end(std::vector<std::uint8_t>& data) override { qoi_end_marker(data); }
+
+private:
+    qoi_encoder encoder;
+    std::vector<std::uint8_t> rgb;
+};
+
+class png_writer : public file_writer {
+public:
+    png_writer(const std::string& path, int width, int height, thread_pool& pool)
+        : file_writer(path, width, height), encoder(width, height), pool(pool) {
+        encoder.begin(buffer);
+        flush();
+    }
+
+protected:
+    void encode(const vec3* pixels, int count, std::vector<std::uint8_t>& data) override {
+        rgb.resize(static_cast<std::size_t>(width) * count * 3);
+        pool.parallel_for(static_cast<std::size_t>(count), [&](std::size_t y) {
+            quantize(pixels + y * width, width, rgb.data() + y * width * 3);
+        });
+        encode_bytes(rgb.data(), count, data);
+    }
+    bool encode_bytes(const std::uint8_t* bytes, int count, std::vector<std::uint8_t>& data) override {
+        encoder.encode_rows(bytes, count, pool, data);
+        return true;
+    }
+    void encode_end(std::vector<std::uint8_t>& data) override { encoder.finish(data); }
+
+private:
+    png_encoder encoder;
+    thread_pool& pool;
+    std::vector<std::uint8_t> rgb;
+};
+
+// PFM is stored bottom row first: the file gets its final size up front and
+// each batch is written at its own offset
+class pfm_writer : public file_writer {
+public:
+    pfm_writer(const std::string& path, int width, int height)
+        : file_writer(path, width, height), header_size(pfm_header(width, height).size()) {
+        std::string header = pfm_header(width, height);
+        buffer.assign(header.begin(), header.end());
+        flush();
+    }
+
+protected:
+    void encode(const vec3* pixels, int count, std::vector<std::uint8_t>& data) override {
+        const std::size_t row_bytes = static_cast<std::size_t>(width) * 3 * sizeof(float);
+        std::vector<float> row_floats(static_cast<std::size_t>(width) * 3);
+
+        // Batch rows [rows_written, rows_written + count) land reversed, ending
+        // at file row height - 1 - rows_written
+        data.resize(row_bytes * count);
+        for (int y = 0; y < count; ++y) {
+            to_floats(pixels + static_cast<std::size_t>(y) * width, width, row_floats.data());
+            std::memcpy(data.data() + row_bytes * (count - 1 - y), row_floats.data(), row_bytes);
+        }
+        const std::size_t first_file_row = static_cast<std::size_t>(height - rows_written - count);
+        file.seekp(static_cast<std::streamoff>(header_size + row_bytes * first_file_row));
+    }
+
+private:
+    std::size_t header_size;
+};
+
+} // namespace
+
+std::unique_ptr<image_writer> open_image_writer(const std::string& path, int width, int height,
+                                                thread_pool& pool) {
+    format fmt;
+    if (!format_from_path(path, fmt)) return nullptr;
+
+    std::unique_ptr<file_writer> writer;
+    switch (fmt) {
+        case format::ppm: writer = std::make_unique<ppm_writer>(path, width, height); break;
+        case format::png: writer = std::make_unique<png_writer>(path, width, height, pool); break;
+        case format::qoi: writer = std::make_unique<qoi_writer>(path, width, height); break;
+    }
+    if (!writer || !writer->is_open()) return nullptr;
+    return writer;
+}
+
+std::unique_ptr<image_writer> open_pfm_writer(const std::string& path, int width, int height) {
+    auto writer = std::make_unique<pfm_writer>(path, width, height);
+    if (!writer->is_open()) return nullptr;
+    return writer;
+}
+
+} // namespace image_io
@@ -0,0 +1,17 @@
+// AVX-512 variant (F/BW/DQ/VL) of the hot kernels (see kernels_impl.inl)
+#include "core/kernels.hpp"
+#include "geometry/hittable.hpp"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512bw,avx512dq,avx512vl,avx2,fma")
+#define RAYT_KERNEL_NAMESPACE kernels_avx512
+#include "kernels_impl.inl"
+#pragma GCC pop_options
+
+#endif
@@ -0,0 +1,10 @@
+// Baseline variant: the compiler's default target (SSE2 on x86-64) of the hot kernels (see kernels_impl.inl)
+#include "core/kernels.hpp"
+#include "geometry/hittable.hpp"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#define RAYT_KERNEL_NAMESPACE kernels_baseline
+#include "kernels_impl.inl"
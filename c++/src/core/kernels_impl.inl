@@ -0,0 +1,382 @@
+// ============================================================================
+// KERNELS_IMPL : body of the hot kernels, compiled once per instruction set
+// ============================================================================
+//
+// Included by kernels_baseline.cpp, kernels_sse42.cpp, kernels_avx2.cpp and
+// kernels_avx512.cpp after '#pragma GCC target(...)' with RAYT_KERNEL_NAMESPACE
+// set to a unique namespace.
+//
+// Rules for this file:
+// - every header must be included by the variant .cpp BEFORE the target pragma,
+//   so no inline function shared with the rest of the program is ever emitted
+//   with AVX instructions (the linker could keep that copy for everyone);
+// - no templates and no inline helpers from headers: plain loops over flat
+//   arrays, so the compiler vectorizes them for the target.
+//
+// ============================================================================
+
+#ifndef RAYT_KERNEL_NAMESPACE
+#error "RAYT_KERNEL_NAMESPACE must be defined before including kernels_impl.inl"
+#endif
+
+namespace RAYT_KERNEL_NAMESPACE {
+
+// Spheres are processed in blocks: a vectorizable pass computes t for the whole
+// block, then a short scalar pass keeps the closest one.
+constexpr std::size_t block_size = 64;
+
+static long hit_spheres(const sphere_soa& spheres, const vec3& origin, const vec3& direction,
+                        real t_max, real& t_hit) {
+    const real ox = origin.x, oy = origin.y, oz = origin.z;
+    const real dx = direction.x, dy = direction.y, dz = direction.z;
+    const real a = dx * dx + dy * dy + dz * dz;
+    const real infinity = std::numeric_limits<real>::infinity();
+
+    real best_t = t_max;
+    long best = -1;
+    real t_block[block_size];
+
+    for (std::size_t base = 0; base < spheres.count; base += block_size) {
+        std::size_t n = spheres.count - base;
+        if (n > block_size) n = block_size;
+        const real* cx = spheres.center_x + base;
+        const real* cy = spheres.center_y + base;
+        const real* cz = spheres.center_z + base;
+        const real* radius = spheres.radius + base;
+
+        // Same arithmetic as sphere::hit (cancellation-free discriminant, stable roots)
+        for (std::size_t i = 0; i < n; ++i) {
+            real ocx = ox - cx[i], ocy = oy - cy[i], ocz = oz - cz[i];
+            real half_b = ocx * dx + ocy * dy + ocz * dz;
+            real r2 = radius[i] * radius[i];
+            real c = ocx * ocx + ocy * ocy + ocz * ocz - r2;
+            real s = half_b / a;
+            real lx = ocx - dx * s, ly = ocy - dy * s, lz = ocz - dz * s;
+            real delta = a * (r2 - (lx * lx + ly * ly + lz * lz));
+            real root = std::sqrt(delta > 0 ? delta : real(0));
+            real q = -(half_b + (half_b < 0 ? -root : root));
+            real t1 = c / q;
+            real t2 = q / a;
+            real lo = t1 < t2 ? t1 : t2;
+            real hi = t1 < t2 ? t2 : t1;
+            real t = lo > 0 ? lo : hi;
+            t_block[i] = (delta >= 0 && t > 0) ? t : infinity;
+        }
+
+        for (std::size_t i = 0; i < n; ++i) {
+            if (t_block[i] < best_t) {
+                best_t = t_block[i];
+                best = static_cast<long>(base + i);
+            }
+        }
+    }
+
+    if (best >= 0) t_hit = best_t;
+    return best;
+}
+
+static long hit_planes(const plane_soa& planes, const vec3& origin, const vec3& direction,
+                       real t_max, real& t_hit) {
+    const real ox = origin.x, oy = origin.y, oz = origin.z;
+    const real dx = direction.x, dy = direction.y, dz = direction.z;
+    const real infinity = std::numeric_limits<real>::infinity();
+    const real parallel = hittable::epsilon;
+
+    real best_t = t_max;
+    long best = -1;
+    real t_block[block_size];
+
+    for (std::size_t base = 0; base < planes.count; base += block_size) {
+        std::size_t n = planes.count - base;
+        if (n > block_size) n = block_size;
+
+        for (std::size_t i = 0; i < n; ++i) {
+            std::size_t k = base + i;
+            real nx = planes.normal_x[k], ny = planes.normal_y[k], nz = planes.normal_z[k];
+            real denom = nx * dx + ny * dy + nz * dz;
+            real num = (planes.anchor_x[k] - ox) * nx + (planes.anchor_y[k] - oy) * ny
+                     + (planes.anchor_z[k] - oz) * nz;
+            real t = num / denom;
+            bool facing = denom > parallel || denom < -parallel;
+            t_block[i] = (facing && t > 0) ? t : infinity;
+        }
+
+        for (std::size_t i = 0; i < n; ++i) {
+            if (t_block[i] < best_t) {
+                best_t = t_block[i];
+                best = static_cast<long>(base + i);
+            }
+        }
+    }
+
+    if (best >= 0) t_hit = best_t;
+    return best;
+}
+
+static std::size_t hit_aabbs(const aabb_soa& boxes, const vec3& origin, const vec3& inv_direction,
+                             real t_max, std::uint8_t* hit) {
+    const real ox = origin.x, oy = origin.y, oz = origin.z;
+    const real ix = inv_direction.x, iy = inv_direction.y, iz = inv_direction.z;
+    std::size_t hits = 0;
+
+    for (std::size_t i = 0; i < boxes.count; ++i) {
+        real tx1 = (boxes.min_x[i] - ox) * ix, tx2 = (boxes.max_x[i] - ox) * ix;
+        real ty1 = (boxes.min_y[i] - oy) * iy, ty2 = (boxes.max_y[i] - oy) * iy;
+        real tz1 = (boxes.min_z[i] - oz) * iz, tz2 = (boxes.max_z[i] - oz) * iz;
+
+        real near_x = tx1 < tx2 ? tx1 : tx2, far_x = tx1 < tx2 ? tx2 : tx1;
+        real near_y = ty1 < ty2 ? ty1 : ty2, far_y = ty1 < ty2 ? ty2 : ty1;
+        real near_z = tz1 < tz2 ? tz1 : tz2, far_z = tz1 < tz2 ? tz2 : tz1;
+
+        real t_enter = near_x > near_y ? near_x : near_y;
+        t_enter = t_enter > near_z ? t_enter : near_z;
+        real t_exit = far_x < far_y ? far_x : far_y;
+        t_exit = t_exit < far_z ? t_exit : far_z;
+        t_exit = t_exit < t_max ? t_exit : t_max;
+
+        std::uint8_t h = (t_enter <= t_exit && t_exit > 0) ? 1 : 0;
+        hit[i] = h;
+        hits += h;
+    }
+    return hits;
+}
+
+static void tonemap(const real* in, real* out, std::size_t count, real exposure, real inv_gamma) {
+    // ACES filmic tone mapping curve (Narkowicz 2015), then gamma
+    const real a = real(2.51), b = real(0.03), c = real(2.43), d = real(0.59), e = real(0.14);
+    for (std::size_t i = 0; i < count; ++i) {
+        real x = in[i] * exposure;
+        real mapped = (x * (x * a + b)) / (x * (x * c + d) + e);
+        out[i] = std::pow(mapped, inv_gamma);
+    }
+}
+
+// Scalar on purpose: the loads from the table would vectorize as gathers,
+// which measured slower than scalar loads (AVX-512) or no faster (AVX2),
+// and at 8K the pass is bound by reading the frame anyway
+static void tonemap_quantize(const real* in, std::size_t count, std::size_t stride, const tonemap_lut& lut,
+                             std::uint8_t* __restrict rgb) {
+    const std::int32_t* thresholds = lut.thresholds;
+    const std::uint8_t* buckets = lut.buckets;
+    for (std::size_t i = 0; i < count; ++i) {
+        for (int c = 0; c < 3; ++c) {
+            // Clamp on the bits: negatives go to the first bucket, +inf and
+            // NaN to the last one. Positive floats compare like their bits.
+            union { float f; std::int32_t i; } value;
+            value.f = static_cast<float>(in[i * stride + c]);
+            std::int32_t bits = value.i < lut.first_bits ? lut.first_bits : value.i;
+            bits = bits > lut.last_bits ? lut.last_bits : bits;
+            int byte = buckets[(bits - lut.first_bits) >> lut.shift];
+            byte += bits >= thresholds[byte + 1];
+            byte += bits >= thresholds[byte + 1];
+            rgb[3 * i + c] = static_cast<std::uint8_t>(byte);
+        }
+    }
+}
+
+static void weighted_row_sum(const float* const* rows, const float* weights, int taps,
+                             float* __restrict out, std::size_t count) {
+    const float* first = rows[0];
+    const float w0 = weights[0];
+    for (std::size_t i = 0; i < count; ++i) out[i] = w0 * first[i];
+
+    for (int k = 1; k < taps; ++k) {
+        const float* row = rows[k];
+        const float w = weights[k];
+        for (std::size_t i = 0; i < count; ++i) out[i] += w * row[i];
+    }
+}
+
+// |v| and max(v, 0) on the bits: GCC does not vectorize a float compare and
+// select (the compare may trap), integer masks vectorize
+static inline float abs_bits(float v) {
+    union { float f; std::int32_t i; } bits;
+    bits.f = v;
+    bits.i &= 0x7FFFFFFF;
+    return bits.f;
+}
+
+static inline float positive_part(float v) {
+    union { float f; std::int32_t i; } bits;
+    bits.f = v;
+    bits.i &= ~(bits.i >> 31);
+    return bits.f;
+}
+
+// exp(e) for e <= 0, relative error < 2e-7. exp(e) = 2^k * 2^f with
+// k = round(e * log2(e)) and |f| <= 0.5: adding 1.5 * 2^23 rounds t to an
+// integer held in the low mantissa bits, 2^f comes from its degree-6 Taylor
+// series and 2^k is built directly in the exponent bits. Static so it is
+// inlined into the loops below and vectorized with them.
+static inline float fast_exp(float e) {
+    // Clamp to -87 on the bits of |e|, which order like |e| (see abs_bits)
+    union { float f; std::int32_t i; } magnitude;
+    magnitude.f = abs_bits(e);
+    magnitude.i = magnitude.i < 0x42AE0000 ? magnitude.i : 0x42AE0000;   // 87.0f
+    float t = magnitude.f * -1.44269504f;
+    union { float f; std::int32_t i; } rounded;
+    rounded.f = t + 12582912.0f;
+    float f = (t - (rounded.f - 12582912.0f)) * 0.693147181f;
+    float p = 1.0f + f * (1.0f + f * (0.5f + f * (1.0f / 6 + f * (1.0f / 24 + f * (1.0f / 120 + f * (1.0f / 720))))));
+    union { std::int32_t i; float f; } scale;
+    scale.i = (rounded.i - 0x4B400000 + 127) << 23;
+    return p * scale.f;
+}
+
+// One tap (dx, dy) of the bilateral filter for a whole row: p* are the tapped
+// pixels, q* the same pixels in the range metric and c* the centers in it.
+// Separate function so the restrict parameters tell the vectorizer that no
+// stream aliases.
+static void bilateral_tap(const float* __restrict pr, const float* __restrict pg, const float* __restrict pb,
+                          const float* __restrict qr, const float* __restrict qg, const float* __restrict qb,
+                          const float* __restrict cr, const float* __restrict cg, const float* __restrict cb,
+                          float spatial_weight, float inv_two_sigma_color_sq, int width,
+                          float* __restrict sum_r, float* __restrict sum_g, float* __restrict sum_b,
+                          float* __restrict sum_w) {
+    for (int x = 0; x < width; ++x) {
+        float dr = qr[x] - cr[x];
+        float dg = qg[x] - cg[x];
+        float db = qb[x] - cb[x];
+        float weight = spatial_weight * fast_exp(-(dr * dr + dg * dg + db * db) * inv_two_sigma_color_sq);
+
+        sum_r[x] += pr[x] * weight;
+        sum_g[x] += pg[x] * weight;
+        sum_b[x] += pb[x] * weight;
+        sum_w[x] += weight;
+    }
+}
+
+static void bilateral_row(const float* const* window, const float* const* range_window, int padded_width,
+                          int width, int radius, const float* spatial, float inv_two_sigma_color_sq,
+                          float* accum, float* const* out) {
+    const int diameter = 2 * radius + 1;
+    const std::size_t stride = static_cast<std::size_t>(padded_width);
+    float* sum_r = accum;
+    float* sum_g = accum + width;
+    float* sum_b = accum + 2 * width;
+    float* sum_w = accum + 3 * width;
+    for (int x = 0; x < 4 * width; ++x) accum[x] = 0.0f;
+
+    const float* center_r = range_window[0] + radius * stride + radius;
+    const float* center_g = range_window[1] + radius * stride + radius;
+    const float* center_b = range_window[2] + radius * stride + radius;
+
+    // Tap by tap over the whole row, so the inner loop runs along x
+    for (int dy = 0; dy < diameter; ++dy) {
+        for (int dx = 0; dx < diameter; ++dx) {
+            const std::size_t tap = dy * stride + dx;
+            bilateral_tap(window[0] + tap, window[1] + tap, window[2] + tap,
+                          range_window[0] + tap, range_window[1] + tap, range_window[2] + tap, center_r, center_g, center_b, spatial[dy * diameter + dx], inv_two_sigma_color_sq,
+                          width, sum_r, sum_g, sum_b, sum_w);
+        }
+    }
+
+    for (int x = 0; x < width; ++x) {
+        float inv = 1.0f / sum_w[x];
+        out[0][x] = sum_r[x] * inv;
+        out[1][x] = sum_g[x] * inv;
+        out[2][x] = sum_b[x] * inv;
+    }
+}
+
+// One tap of an à-trous pass over count columns of a row. The p* streams
+// are the tapped pixels, the c* streams the center pixels and the sums those
+// of the same columns; all start at the first column the tap covers. Separate
+// function for the restrict parameters.
+static void atrous_tap(const float* __restrict pr, const float* __restrict pg, const float* __restrict pb,
+                       const float* __restrict pv, const float* __restrict pnx, const float* __restrict pny,
+                       const float* __restrict pnz, const float* __restrict pz, const float* __restrict ps,
+                       const float* __restrict cr, const float* __restrict cg, const float* __restrict cb,
+                       const float* __restrict cnx, const float* __restrict cny, const float* __restrict cnz,
+                       const float* __restrict cz, const float* __restrict cgrad,
+                       const float* __restrict luminance_scale, float kernel_weight, float distance,
+                       int count, float* __restrict sum_r, float* __restrict sum_g,
+                       float* __restrict sum_b, float* __restrict sum_w, float* __restrict sum_v) {
+    for (int x = 0; x < count; ++x) {
+        // Normals: max(0, dot)^128 by squaring
+        float w_normal = cnx[x] * pnx[x] + cny[x] * pny[x] + cnz[x] * pnz[x];
+        w_normal = positive_part(w_normal);
+        for (int i = 0; i < 7; ++i) w_normal *= w_normal;
+
+        // Depth, against the change expected over that distance on the surface
+        float depth_term = abs_bits(cz[x] - pz[x]) / (cgrad[x] * distance + 1e-3f);
+
+        float dl = abs_bits(0.2126f * (cr[x] - pr[x]) + 0.7152f * (cg[x] - pg[x]) + 0.0722f * (cb[x] - pb[x]));
+
+        float weight = kernel_weight * w_normal * (1.0f - ps[x]) * fast_exp(-depth_term - dl * luminance_scale[x]);
+        sum_r[x] += pr[x] * weight;
+        sum_g[x] += pg[x] * weight;
+        sum_b[x] += pb[x] * weight;
+        sum_w[x] += weight;
+        sum_v[x] += pv[x] * weight * weight;
+    }
+}
+
+static void atrous_row(const float* const* color, const float* variance, const atrous_guides& guides,
+                       int y, int step, const float* luminance_scale, float* accum,
+                       float* const* out, float* out_variance) {
+    static const float b3_spline[5] = {1.0f / 16, 1.0f / 4, 3.0f / 8, 1.0f / 4, 1.0f / 16};
+    const int width = guides.width;
+    const std::size_t stride = static_cast<std::size_t>(width);
+    float* sum_r = accum;
+    float* sum_g = accum + width;
+    float* sum_b = accum + 2 * width;
+    float* sum_w = accum + 3 * width;
+    float* sum_v = accum + 4 * width;
+    for (int x = 0; x < 5 * width; ++x) accum[x] = 0.0f;
+
+    const std::size_t center = static_cast<std::size_t>(y) * stride;
+    for (int j = 0; j < 5; ++j) {
+        const int sy = y + (j - 2) * step;
+        if (sy < 0 || sy >= guides.height) continue;
+        for (int i = 0; i < 5; ++i) {
+            // Taps that fall outside the row are left out of the sums
+            const int dx = (i - 2) * step;
+            const int begin = dx < 0 ? -dx : 0;
+            const int end = dx > 0 ? width - dx : width;
+            if (begin >= end) continue;
+
+            // Both offsets start at column begin, so the tap never points
+            // before its row (begin + dx >= 0)
+            const std::size_t tap = static_cast<std::size_t>(sy) * stride + (begin + dx);
+            const std::size_t at = center + begin;
+            const float distance = std::sqrt(static_cast<float>((i - 2) * (i - 2) + (j - 2) * (j - 2))) * step;
+            atrous_tap(color[0] + tap, color[1] + tap, color[2] + tap, variance + tap,
+                       guides.normal[0] + tap, guides.normal[1] + tap, guides.normal[2] + tap, guides.depth + tap,
+                       guides.specular + tap,
+                       color[0] + at, color[1] + at, color[2] + at,
+                       guides.normal[0] + at, guides.normal[1] + at, guides.normal[2] + at,
+                       guides.depth + at, guides.depth_gradient + at, luminance_scale + begin,
+                       b3_spline[i] * b3_spline[j], distance, end - begin, sum_r + begin, sum_g + begin,
+                       sum_b + begin, sum_w + begin, sum_v + begin);
+        }
+    }
+
+    for (int x = 0; x < width; ++x) {
+        if (sum_w[x] > 0.0f) {
+            float inv = 1.0f / sum_w[x];
+            out[0][x] = sum_r[x] * inv;
+            out[1][x] = sum_g[x] * inv;
+            out[2][x] = sum_b[x] * inv;
+            out_variance[x] = sum_v[x] * inv * inv;
+        } else {
+            out[0][x] = color[0][center + x];
+            out[1][x] = color[1][center + x];
+            out[2][x] = color[2][center + x];
+            out_variance[x] = variance[center + x];
+        }
+    }
+}
+
+extern const kernel_table table = {
+    hit_spheres,
+    hit_planes,
+    hit_aabbs,
+    tonemap,
+    tonemap_quantize,
+    weighted_row_sum,
+    bilateral_row,
+    atrous_row,
+};
+
+} // namespace RAYT_KERNEL_NAMESPACE
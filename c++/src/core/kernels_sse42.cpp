@@ -0,0 +1,17 @@
+// SSE4.2 variant of the hot kernels (see kernels_impl.inl)
+#include "core/kernels.hpp"
+#include "geometry/hittable.hpp"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#pragma GCC push_options
+#pragma GCC target("sse4.2,popcnt")
+#define RAYT_KERNEL_NAMESPACE kernels_sse42
+#include "kernels_impl.inl"
+#pragma GCC pop_options
+
+#endif
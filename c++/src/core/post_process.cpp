@@ -0,0 +1,255 @@
+#include "core/post_process.hpp"
+#include "core/aov.hpp"
+#include "core/cpu_dispatch.hpp"
+#include "core/image_io.hpp"
+#include "core/thread_pool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace post {
+
+// Rows per task of a fused pass: a 4K band of 8 rows stays in the L2 cache
+// from one stage to the next
+static constexpr int rows_per_band = 8;
+
+// Largest input the table tells apart; anything above maps like it
+static constexpr float lut_max_input = 1e15f;
+
+static std::int32_t float_bits(float value) {
+    std::int32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static float bits_float(std::int32_t bits) {
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static const char* stage_name(stage_type type) {
+    switch (type) {
+        case stage_type::denoise: return "denoise";
+        case stage_type::exposure: return "exposure";
+        case stage_type::tonemap: return "tonemap";
+        case stage_type::gamma: return "gamma";
+        case stage_type::quantize: return "quantize";
+    }
+    return "";
+}
+
+pipeline& pipeline::denoise(int type, float strength, const aov::frame* guides, int samples_per_pixel) {
+    stage s{stage_type::denoise};
+    s.denoise_type = type;
+    s.strength = strength;
+    s.guides = guides;
+    s.samples_per_pixel = samples_per_pixel;
+    stages.push_back(s);
+    return *this;
+}
+
+pipeline& pipeline::exposure(real scale) {
+    stage s{stage_type::exposure};
+    s.value = scale;
+    stages.push_back(s);
+    return *this;
+}
+
+pipeline& pipeline::tonemap() {
+    stages.push_back(stage{stage_type::tonemap});
+    return *this;
+}
+
+pipeline& pipeline::gamma(real value) {
+    stage s{stage_type::gamma};
+    s.value = value;
+    stages.push_back(s);
+    return *this;
+}
+
+pipeline& pipeline::quantize() {
+    stages.push_back(stage{stage_type::quantize});
+    return *this;
+}
+
+void pipeline::run(std::vector<vec3>& pixels, int width, int height, thread_pool& pool) {
+    std::vector<std::uint8_t> unused;
+    run(pixels, width, height, pool, unused);
+}
+
+void pipeline::run(std::vector<vec3>& pixels, int width, int height, thread_pool& pool,
+                   std::vector<std::uint8_t>& rgb) {
+    last_timings.clear();
+    std::size_t i = 0;
+    while (i < stages.size()) {
+        auto start = std::chrono::steady_clock::now();
+        pass_timing timing;
+
+        if (stages[i].type == stage_type::denoise) {
+            run_denoise(stages[i], pixels, width, height, pool);
+            timing.name = stage_name(stage_type::denoise);
+            ++i;
+        } else {
+            // Every per-pixel stage up to the next denoise goes in one pass
+            std::size_t end = i;
+            while (end < stages.size() && stages[end].type != stage_type::denoise) {
+                if (!timing.name.empty()) timing.name += '+';
+                timing.name += stage_name(stages[end].type);
+                ++end;
+            }
+            run_pixel_pass(i, end, pixels, width, height, pool, &rgb);
+            i = end;
+        }
+
+        timing.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        last_timings.push_back(timing);
+    }
+}
+
+void pipeline::run_denoise(const stage& s, std::vector<vec3>& pixels, int width, int height, thread_pool& pool) {
+    switch (s.denoise_type) {
+        case 0:
+            denoise::box_blur(pixels, width, height, static_cast<int>(s.strength), pool, scratch);
+            break;
+        case 1:
+            denoise::gaussian_blur(pixels, width, height, s.strength, pool, scratch);
+            break;
+        case 2:
+            denoise::bilateral_filter(pixels, width, height, s.strength, 0.1f, pool, scratch);
+            break;
+        case 3:
+            denoise::bilateral_grid(pixels, width, height, s.strength, 0.1f, pool, scratch);
+            break;
+        case 4:
+            if (s.guides) {
+                denoise::atrous_filter(pixels, width, height, *s.guides, s.samples_per_pixel,
+                                       4.0f * s.strength, pool, scratch);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// Threshold b is the smallest positive float that the tonemap kernel and
+// image_io::to_byte map to byte b or more, found by bisection on the float
+// bits (the chain is monotonic). Buckets start at 64 per octave and are
+// halved until none holds more than the 2 thresholds the kernel steps over.
+void pipeline::build_lut(real exposure, real inv_gamma) {
+    if (exposure == lut_exposure && inv_gamma == lut_inv_gamma) return;
+    lut_exposure = exposure;
+    lut_inv_gamma = inv_gamma;
+
+    const kernel_table& k = kernels();
+    auto byte_of = [&](std::int32_t bits) {
+        real in = bits_float(bits), out;
+        k.tonemap(&in, &out, 1, exposure, inv_gamma);
+        return image_io::to_byte(out);
+    };
+
+    const std::int32_t max_bits = float_bits(lut_max_input);
+    lut_thresholds.assign(258, float_bits(std::numeric_limits<float>::infinity()));
+    lut_thresholds[0] = 0;
+    const int max_byte = byte_of(max_bits);
+    int top = 0;    // Last finite threshold
+    for (int b = 1; b <= max_byte; ++b) {
+        std::int32_t low = lut_thresholds[b - 1], high = max_bits;
+        while (low < high) {
+            std::int32_t mid = low + (high - low) / 2;
+            if (byte_of(mid) >= b) high = mid;
+            else low = mid + 1;
+        }
+        lut_thresholds[b] = low;
+        top = b;
+    }
+
+    const std::int32_t* first_threshold = lut_thresholds.data() + 1;
+    const std::int32_t* end_threshold = lut_thresholds.data() + top + 1;
+    for (int octave_bits = 6;; ++octave_bits) {
+        const int shift = 23 - octave_bits;
+        const std::int32_t mask = (std::int32_t(1) << shift) - 1;
+        const std::int32_t first_bits = lut_thresholds[top > 0 ? 1 : 0] & ~mask;
+        const std::int32_t last_bits = (lut_thresholds[top] + mask) & ~mask;
+        const std::size_t count = static_cast<std::size_t>((last_bits - first_bits) >> shift) + 1;
+
+        lut_buckets.resize(count);
+        bool fits = true;
+        for (std::size_t i = 0; i < count; ++i) {
+            const std::int32_t start = first_bits + static_cast<std::int32_t>(i << shift);
+            const std::int32_t* at_start = std::upper_bound(first_threshold, end_threshold, start);
+            const std::int32_t* at_next = std::lower_bound(first_threshold, end_threshold, start + mask + 1);
+            lut_buckets[i] = static_cast<std::uint8_t>(at_start - first_threshold);
+            if (at_next - at_start > 2) fits = false;
+        }
+        if (fits || octave_bits == 23) {
+            lut = tonemap_lut{lut_thresholds.data(), lut_buckets.data(), first_bits, last_bits, shift};
+            return;
+        }
+    }
+}
+
+// Stages [first, end) on bands of rows. Within a band each stage is a flat
+// loop over the channels; an exposure right before a tonemap and a gamma
+// right after it are folded into the tonemap kernel call. A tonemap whose
+// output is quantized next uses the table kernel instead and ends the pass.
+void pipeline::run_pixel_pass(std::size_t first, std::size_t end, std::vector<vec3>& pixels, int width, int height,
+                              thread_pool& pool, std::vector<std::uint8_t>* rgb) {
+    const kernel_table& k = kernels();
+    const std::size_t stride = sizeof(vec3) / sizeof(real);
+    if (stages[end - 1].type == stage_type::quantize) rgb->resize(static_cast<std::size_t>(width) * height * 3);
+
+    std::size_t direct = end;    // Tonemap stage that writes bytes
+    for (std::size_t i = first; i < end; ++i) {
+        if (stages[i].type != stage_type::tonemap) continue;
+        const bool exposed = i > first && stages[i - 1].type == stage_type::exposure;
+        const bool corrected = i + 1 < end && stages[i + 1].type == stage_type::gamma;
+        const std::size_t next = corrected ? i + 2 : i + 1;
+        if (next < end && stages[next].type == stage_type::quantize) {
+            build_lut(exposed ? stages[i - 1].value : real(1), corrected ? real(1) / stages[i + 1].value : real(1));
+            direct = i;
+            break;
+        }
+    }
+
+    const std::size_t bands = (static_cast<std::size_t>(height) + rows_per_band - 1) / rows_per_band;
+    pool.parallel_for(bands, [&](std::size_t band) {
+        const std::size_t first_pixel = band * rows_per_band * width;
+        const std::size_t count = std::min<std::size_t>(rows_per_band, height - band * rows_per_band) * width;
+        real* channels = reinterpret_cast<real*>(pixels.data() + first_pixel);
+        const std::size_t channel_count = count * stride;
+
+        for (std::size_t i = first; i < direct; ++i) {
+            const stage& s = stages[i];
+            switch (s.type) {
+                case stage_type::exposure:
+                    if (i + 1 < end && stages[i + 1].type == stage_type::tonemap) break;   // Folded
+                    for (std::size_t c = 0; c < channel_count; ++c) channels[c] *= s.value;
+                    break;
+                case stage_type::tonemap: {
+                    const bool exposed = i > first && stages[i - 1].type == stage_type::exposure;
+                    const bool corrected = i + 1 < end && stages[i + 1].type == stage_type::gamma;
+                    k.tonemap(channels, channels, channel_count, exposed ? stages[i - 1].value : real(1),
+                              corrected ? real(1) / stages[i + 1].value : real(1));
+                    break;
+                }
+                case stage_type::gamma: {
+                    if (i > first && stages[i - 1].type == stage_type::tonemap) break;   // Folded
+                    const real inv_gamma = real(1) / s.value;
+                    for (std::size_t c = 0; c < channel_count; ++c) channels[c] = std::pow(channels[c], inv_gamma);
+                    break;
+                }
+                case stage_type::quantize:
+                    image_io::quantize(pixels.data() + first_pixel, count, rgb->data() + 3 * first_pixel);
+                    break;
+                case stage_type::denoise:
+                    break;
+            }
+        }
+        if (direct < end) k.tonemap_quantize(channels, count, stride, lut, rgb->data() + 3 * first_pixel);
+    });
+}
+
+} // namespace post
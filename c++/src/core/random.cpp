@@ -0,0 +1,18 @@
+#include "core/random.hpp"
+
+thread_local pcg32 generator{std::random_device{}()};
+thread_local std::uniform_real_distribution<double> distribution(0.0, 1.0);
+
+// SplitMix64 finalizer: spreads nearby pixel indices over the whole state space
+static std::uint64_t mix64(std::uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+void seed_sample(std::uint64_t seed, std::uint64_t pixel, std::uint32_t sample) {
+    generator.seed(mix64(seed ^ mix64(pixel)), sample);
+    // A distribution may cache values between calls: drop them too
+    distribution.reset();
+}
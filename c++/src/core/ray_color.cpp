@@ -1,4 +1,5 @@
 #include "core/ray_color.hpp"
+#include "core/aov.hpp"
 #include "core/vec3.hpp"
 #include "core/light.hpp"
 #include "geometry/hittable.hpp"
@@ -10,11 +11,11 @@
 #include <algorithm>
 #include <optional>
 
-bool refract(const vec3& v_in_normalized, const vec3& n, double ior_ratio, vec3& refracted_direction) {
-    double cos_theta = std::min((vec3(0.0, 0.0, 0.0)-v_in_normalized).dot(n), 1.0);
+bool refract(const vec3& v_in_normalized, const vec3& n, real ior_ratio, vec3& refracted_direction) {
+    real cos_theta = std::min((vec3(0.0, 0.0, 0.0)-v_in_normalized).dot(n), real(1));
     vec3 r_out_perp = (v_in_normalized + (n * cos_theta)) * ior_ratio;
-    double r_out_parallel_sq = 1.0 - r_out_perp.length_squared();
-    if (r_out_parallel_sq > 0.0) {
+    real r_out_parallel_sq = 1 - r_out_perp.length_squared();
+    if (r_out_parallel_sq > 0) {
         vec3 r_out_parallel = n * -std::sqrt(r_out_parallel_sq);
         refracted_direction = r_out_perp + r_out_parallel;
         return true;
@@ -23,10 +24,10 @@ bool refract(const vec3& v_in_normalized, const vec3& n, double ior_ratio, vec3&
     }
 }
 
-double reflectance(double cosine, double ref_idx_ratio) {
-    double r0 = (1.0 - ref_idx_ratio) / (1.0 + ref_idx_ratio);
+real reflectance(real cosine, real ref_idx_ratio) {
+    real r0 = (1 - ref_idx_ratio) / (1 + ref_idx_ratio);
     r0 = r0 * r0;
-    return r0 + (1.0 - r0) * std::pow((1.0 - cosine), 5);
+    return r0 + (1 - r0) * std::pow((1 - cosine), 5);
 }
 
 vec3 ray_color(
@@ -36,52 +37,68 @@ vec3 ray_color(
     const std::vector<PointLight>& lights,
     const std::optional<DirectionalLight>& sun,
     int depth,
-    double ambient_light
+    real ambient_light,
+    first_hit* first
 ) {
     if (depth <= 0) {
         return vec3(0, 0, 0);
     }
 
-    double t_min = std::numeric_limits<double>::infinity();
-    std::shared_ptr<hittable> closest_object = nullptr;
+    hit_record rec;
+    bool hit_anything = false;
+    real t_closest = std::numeric_limits<real>::infinity();
     for (const auto& obj : scene) {
-        double t_temp = obj->hit(ray_origin, ray_direction);
-        if (t_temp > hittable::epsilon && t_temp < t_min) {
-            t_min = t_temp;
-            closest_object = obj;
+        if (obj->hit(ray_origin, ray_direction, t_closest, rec)) {
+            hit_anything = true;
+            t_closest = rec.t;
         }
     }
 
-    if (closest_object) {
-        vec3 hit_point = ray_origin + (ray_direction * t_min);
-        vec3 hit_normal = closest_object->get_normal(hit_point);
-        vec3 emitted = closest_object->mat->emitted();
+    if (hit_anything) {
+        const vec3& hit_point = rec.point;
+        const vec3& hit_normal = rec.normal;
+        vec3 emitted = rec.mat->emitted();
+
+        // Ids name the visible object. Albedo, normal and depth follow perfect
+        // specular bounces to the first other surface, tinted on the way.
+        if (first) {
+            if (!first->through_specular) {
+                first->albedo = vec3(1, 1, 1);
+                first->object_id = rec.object_id;
+                first->material_id = rec.mat->id;
+                first->specular = rec.mat->is_specular();
+            }
+            first->albedo = first->albedo * rec.mat->base_color();
+            first->normal = hit_normal;
+            first->depth += rec.t * std::sqrt(ray_direction.length_squared());
+            first->through_specular = rec.mat->is_specular();
+        }
 
         vec3 attenuation;
         vec3 scattered_direction;
 
-        if (closest_object->mat->scatter(ray_direction, hit_point, hit_normal, attenuation, scattered_direction)) {
+        if (rec.mat->scatter(ray_direction, hit_point, hit_normal, attenuation, scattered_direction)) {
             
             // ========== DIRECT LIGHTING FROM POINT LIGHTS ==========
             vec3 direct_light(0, 0, 0);
+            hit_record shadow_rec;
             for (const auto& light : lights) {
                 vec3 to_light = light.direction_from(hit_point);
-                double light_distance = light.distance_from(hit_point);
+                real light_distance = light.distance_from(hit_point);
                 
                 // Shadow ray test
-                vec3 shadow_origin = hit_point + (hit_normal * hittable::epsilon);
+                vec3 shadow_origin = offset_ray_origin(hit_point, hit_normal, to_light);
                 bool in_shadow = false;
                 
                 for (const auto& obj : scene) {
-                    double t_shadow = obj->hit(shadow_origin, to_light);
-                    if (t_shadow > hittable::epsilon && t_shadow < light_distance) {
+                    if (obj->hit(shadow_origin, to_light, light_distance, shadow_rec)) {
                         in_shadow = true;
                         break;
                     }
                 }
                 
                 if (!in_shadow) {
-                    double n_dot_l = std::max(0.0, hit_normal.dot(to_light));
+                    real n_dot_l = std::max(real(0), hit_normal.dot(to_light));
                     vec3 light_contribution = light.get_illumination(hit_point);
                     direct_light = direct_light + (attenuation * light_contribution * n_dot_l);
                 }
@@ -90,37 +107,36 @@ vec3 ray_color(
             // ========== DIRECT LIGHTING FROM DIRECTIONAL LIGHT (SUN) ==========
             if (sun.has_value()) {
                 vec3 to_sun = sun->direction_from(hit_point);
-                double sun_distance = sun->distance_from(hit_point);
+                real sun_distance = sun->distance_from(hit_point);
                 
                 // Shadow ray test for sun
-                vec3 shadow_origin = hit_point + (hit_normal * hittable::epsilon);
+                vec3 shadow_origin = offset_ray_origin(hit_point, hit_normal, to_sun);
                 bool in_shadow = false;
                 
                 for (const auto& obj : scene) {
-                    double t_shadow = obj->hit(shadow_origin, to_sun);
-                    if (t_shadow > hittable::epsilon && t_shadow < sun_distance) {
+                    if (obj->hit(shadow_origin, to_sun, sun_distance, shadow_rec)) {
                         in_shadow = true;
                         break;
                     }
                 }
                 
                 if (!in_shadow) {
-                    double n_dot_l = std::max(0.0, hit_normal.dot(to_sun));
+                    real n_dot_l = std::max(real(0), hit_normal.dot(to_sun));
                     vec3 sun_contribution = sun->get_illumination(hit_point);
                     direct_light = direct_light + (attenuation * sun_contribution * n_dot_l);
                 }
             }
             
-            // Recursive path tracing
-            bool same_hemisphere = scattered_direction.dot(hit_normal) > 0;
-            vec3 offset = same_hemisphere ? (hit_normal * hittable::epsilon) : (hit_normal * -hittable::epsilon);
-            vec3 next_origin = hit_point + offset;
+            // Recursive path tracing (origin offset to the side the ray leaves to)
+            vec3 next_origin = offset_ray_origin(hit_point, hit_normal, scattered_direction);
             
-            vec3 color_from_scatter = ray_color(next_origin, scattered_direction, scene, lights, sun, depth - 1, ambient_light);
+            first_hit* next_first = first && first->through_specular ? first : nullptr;
+            vec3 color_from_scatter = ray_color(next_origin, scattered_direction, scene, lights, sun, depth - 1,
+                                                ambient_light, next_first);
             
-            double r = attenuation.x * color_from_scatter.x;
-            double g = attenuation.y * color_from_scatter.y;
-            double b = attenuation.z * color_from_scatter.z;
+            real r = attenuation.x * color_from_scatter.x;
+            real g = attenuation.y * color_from_scatter.y;
+            real b = attenuation.z * color_from_scatter.z;
             
             return vec3(r, g, b) + emitted + direct_light;
         } else {
@@ -128,12 +144,12 @@ vec3 ray_color(
         }
     }
     
-    vec3 unit_direction = ray_direction.normalize();
-    double t_sky = 0.5 * (unit_direction.y + 1.0);
+    vec3 unit_direction = ray_direction.normalize_fast();
+    real t_sky = real(0.5) * (unit_direction.y + real(1));
     vec3 color_white(1.0, 1.0, 1.0);
     vec3 color_blue(0.5, 0.7, 1.0);
-    double r = (1.0 - t_sky) * color_white.x + t_sky * color_blue.x;
-    double g = (1.0 - t_sky) * color_white.y + t_sky * color_blue.y;
-    double b = (1.0 - t_sky) * color_white.z + t_sky * color_blue.z;
+    real r = (1 - t_sky) * color_white.x + t_sky * color_blue.x;
+    real g = (1 - t_sky) * color_white.y + t_sky * color_blue.y;
+    real b = (1 - t_sky) * color_white.z + t_sky * color_blue.z;
     return vec3(r, g, b) * ambient_light;
 }
@@ -0,0 +1,716 @@
+#include "core/scene_desc.hpp"
+#include "core/checkpoint.hpp"
+#include "core/thread_pool.hpp"
+#include "../external/nlohmann/json.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <thread>
+#include <tuple>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using json = nlohmann::json;
+
+static const char magic[8] = {'R', 'A', 'Y', 'T', 'S', 'C', 'N', '\0'};
+static constexpr std::uint32_t format_version = 3;
+
+struct scene_file_header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t header_size;
+    render_settings render;
+    camera_settings camera;
+    std::uint64_t material_count;
+    std::uint64_t materials_offset;
+    std::uint64_t object_count;
+    std::uint64_t objects_offset;
+    std::uint64_t mesh_count;
+    std::uint64_t meshes_offset;
+    std::uint64_t light_count;
+    std::uint64_t lights_offset;
+    std::uint64_t strings_size;
+    std::uint64_t strings_offset;
+};
+
+// The records are written as they are in memory: pin their layout
+static_assert(sizeof(render_settings) == 88, "render_settings layout changed: bump format_version");
+static_assert(sizeof(camera_settings) == 104, "camera_settings layout changed: bump format_version");
+static_assert(sizeof(material_record) == 20, "material_record layout changed: bump format_version");
+static_assert(sizeof(object_record) == 32, "object_record layout changed: bump format_version");
+static_assert(sizeof(mesh_record) == 36, "mesh_record layout changed: bump format_version");
+static_assert(sizeof(light_record) == 28, "light_record layout changed: bump format_version");
+
+static std::string extension_of(const std::string& path) {
+    std::size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos) return "";
+    std::string ext = path.substr(dot + 1);
+    for (char& c : ext) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return ext;
+}
+
+// The material names of the editor (and the English ones)
+static material_kind material_from_name(const std::string& name) {
+    if (name == "Métal") return material_kind::metal;
+    if (name == "Verre") return material_kind::dielectric;
+    if (name == "Néon" || name == "Neon" || name == "Emissive") return material_kind::emissive;
+    if (name == "Miroir" || name == "Mirror") return material_kind::mirror;
+    return material_kind::diffuse;  // "Diffus", and the default for unknown names
+}
+
+// Materials with the same description share an index
+using material_key = std::tuple<material_kind, float, float, float, float>;
+
+static material_key key_of(const material_record& mat) {
+    return material_key{mat.kind, mat.color[0], mat.color[1], mat.color[2], mat.parameter};
+}
+
+// Appends path to the string table of desc and points mesh at it
+static void add_path(scene_desc& desc, mesh_record& mesh, const std::string& path) {
+    mesh.path_offset = static_cast<std::uint32_t>(desc.string_storage.size());
+    mesh.path_size = static_cast<std::uint32_t>(path.size());
+    desc.string_storage.insert(desc.string_storage.end(), path.begin(), path.end());
+}
+
+// ==================== JSON ====================
+
+// Reads the file in chunks for the parser, hashing each chunk as it comes
+class hashed_file_reader {
+public:
+    explicit hashed_file_reader(std::FILE* file) : file(file) { fill(); }
+
+    // Input iterator over the bytes (what nlohmann's iterator adapter needs)
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = char;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const char*;
+        using reference = const char&;
+
+        explicit iterator(hashed_file_reader* reader = nullptr) : reader(reader) {}
+        const char& operator*() const { return reader->buffer[reader->position]; }
+        iterator& operator++() {
+            if (++reader->position == reader->size) reader->fill();
+            return *this;
+        }
+        // Only compared to the end iterator
+        bool operator==(const iterator&) const { return reader->size == 0; }
+        bool operator!=(const iterator& other) const { return !(*this == other); }
+
+    private:
+        hashed_file_reader* reader;
+    };
+
+    iterator begin() { return iterator(this); }
+    iterator end() { return iterator(); }
+    std::uint64_t hash() const { return content_hash; }
+    bool failed() const { return std::ferror(file) != 0; }
+
+private:
+    void fill() {
+        size = std::fread(buffer, 1, sizeof(buffer), file);
+        position = 0;
+        content_hash = hash_scene(buffer, size, content_hash);
+    }
+
+    std::FILE* file;
+    char buffer[1 << 16];
+    std::size_t size = 0;
+    std::size_t position = 0;
+    std::uint64_t content_hash = scene_hash_seed;
+};
+
+// A sub-scene listed by a manifest, placed by p' = rotate_y(scale * p) + translate
+struct scene_part {
+    std::string file;
+    double translate[3] = {0, 0, 0};
+    double scale = 1.0;
+    double rotate_y = 0.0;      // Degrees
+};
+
+// SAX handler: the parser calls it for each token and the values go
+// straight into desc, without building a json tree. Where a value goes is
+// given by the stack of enclosing objects and the last key.
+class scene_sax {
+public:
+    // parts receives the "parts" of a manifest; null where a manifest is not
+    // allowed (inside a part)
+    scene_sax(scene_desc& desc, std::vector<scene_part>* parts, std::filesystem::path base)
+        : desc(desc), parts(parts), base(std::move(base)) {}
+
+    bool null() { return true; }
+    bool boolean(bool value) { return number(value ? 1.0 : 0.0); }
+    bool number_integer(json::number_integer_t value) { return number(static_cast<double>(value)); }
+    bool number_unsigned(json::number_unsigned_t value) { return number(static_cast<double>(value)); }
+    bool number_float(json::number_float_t value, const json::string_t&) { return number(value); }
+    bool binary(json::binary_t&) { return true; }
+
+    bool string(json::string_t& value) {
+        if (context.back() == where::object) {
+            if (last_key == "type") object.type = value;
+            else if (last_key == "material") object.material = value;
+            else if (last_key == "file") object.file = value;
+            else if (last_key == "shape") object.shape = value, object.has_shape = true;
+            else if (last_key == "name") object.name = value;
+        } else if (context.back() == where::part && last_key == "file") {
+            parts->back().file = value;
+        }
+        return true;
+    }
+
+    bool key(json::string_t& value) {
+        last_key = value;
+        return true;
+    }
+
+    bool start_object(std::size_t) {
+        where inside = where::ignored;
+        switch (context.back()) {
+            case where::root:
+                if (last_key == "render") inside = where::render, has_render = true;
+                else if (last_key == "camera") inside = where::camera, has_camera = true;
+                break;
+            case where::document: inside = where::root; break;
+            case where::render:
+                if (last_key == "sun_direction") inside = where::vector, target = desc.render.sun_direction;
+                break;
+            case where::camera:
+                if (last_key == "origin") inside = where::vector, target = desc.camera.origin;
+                else if (last_key == "look_at") inside = where::vector, target = desc.camera.look_at;
+                else if (last_key == "up") inside = where::vector, target = desc.camera.up;
+                break;
+            case where::objects: inside = where::object, object = pending_object(); break;
+            case where::lights: inside = where::light, light = light_record(); break;
+            case where::parts: inside = where::part, parts->emplace_back(); break;
+            case where::part:
+                if (last_key == "translate") inside = where::vector, target = parts->back().translate;
+                break;
+            case where::object:
+                if (last_key == "position") inside = where::vector, target = object.position;
+                else if (last_key == "color") inside = where::color, color_target = object.color;
+                break;
+            case where::light:
+                if (last_key == "position") inside = where::vector, target = light_position;
+                else if (last_key == "color") inside = where::color, color_target = light.color;
+                break;
+            default: break;
+        }
+        context.push_back(inside);
+        return true;
+    }
+
+    bool end_object() {
+        const where closed = context.back();
+        context.pop_back();
+        if (closed == where::object) return add_object();
+        if (closed == where::light) add_light();
+        return true;
+    }
+
+    bool start_array(std::size_t) {
+        where inside = where::ignored;
+        if (context.back() == where::root && last_key == "objects") inside = where::objects;
+        else if (context.back() == where::root && last_key == "lights") inside = where::lights;
+        else if (context.back() == where::root && last_key == "parts") {
+            if (!parts) {
+                error = "JSON error: a manifest part cannot list parts itself";
+                return false;
+            }
+            inside = where::parts;
+        }
+        context.push_back(inside);
+        return true;
+    }
+
+    bool end_array() {
+        context.pop_back();
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string&, const json::exception& e) {
+        error = std::string("JSON error: ") + e.what();
+        return false;
+    }
+
+    // After a successful parse: what a well-formed scene must contain (the
+    // parts of a manifest only bring objects and lights)
+    bool complete(std::string& message) const {
+        const bool settings = !parts || (has_render && has_camera);
+        if (!error.empty()) message = error;
+        else if (!settings) message = "JSON error: the scene has no \"render\" or \"camera\" object";
+        return error.empty() && settings;
+    }
+
+private:
+    enum class where { document, root, render, camera, objects, object, lights, light, parts, part, vector, color, ignored };
+
+    struct pending_object {
+        std::string type, material, file, shape, name;
+        double position[3] = {0, 0, 0};
+        float color[3] = {0, 0, 0};
+        float size = 0.0f;
+        bool has_size = false;
+        bool has_shape = false;
+        float rotate_y = 0.0f;
+        float roughness = 0.0f;
+        float refraction_index = 1.5f;
+        float emission_strength = 5.0f;
+    };
+
+    static int axis(const std::string& key, const char* names) {
+        for (int i = 0; i < 3; ++i) {
+            if (key.size() == 1 && key[0] == names[i]) return i;
+        }
+        return -1;
+    }
+
+    bool number(double value) {
+        render_settings& r = desc.render;
+        camera_settings& c = desc.camera;
+        const std::string& k = last_key;
+        switch (context.back()) {
+            case where::render:
+                if (k == "image_width") r.image_width = static_cast<std::int32_t>(value);
+                else if (k == "image_height") r.image_height = static_cast<std::int32_t>(value);
+                else if (k == "samples_per_pixel") r.samples_per_pixel = static_cast<std::int32_t>(value);
+                else if (k == "max_depth") r.max_depth = static_cast<std::int32_t>(value);
+                else if (k == "num_threads") r.num_threads = static_cast<std::int32_t>(value);
+                else if (k == "enable_denoise") r.enable_denoise = value != 0.0 ? 1 : 0;
+                else if (k == "denoise_type") r.denoise_type = static_cast<std::int32_t>(value);
+                else if (k == "denoise_strength") r.denoise_strength = static_cast<float>(value);
+                else if (k == "gamma") r.gamma = value;
+                else if (k == "exposure") r.exposure = value;
+                else if (k == "ambient_light") r.ambient_light = value;
+                else if (k == "sun_intensity") r.sun_intensity = value;
+                break;
+            case where::camera:
+                if (k == "fov") c.fov = value;
+                else if (k == "aspect_ratio") c.aspect_ratio = value;
+                else if (k == "aperture") c.aperture = value;
+                else if (k == "focus_distance") c.focus_distance = value;
+                break;
+            case where::object:
+                if (k == "size") object.size = static_cast<float>(value), object.has_size = true;
+                else if (k == "rotate_y") object.rotate_y = static_cast<float>(value);
+                else if (k == "roughness") object.roughness = static_cast<float>(value);
+                else if (k == "refraction_index") object.refraction_index = static_cast<float>(value);
+                else if (k == "emission_strength") object.emission_strength = static_cast<float>(value);
+                break;
+            case where::light:
+                if (k == "intensity") light.intensity = static_cast<float>(value);
+                break;
+            case where::part:
+                if (k == "scale") parts->back().scale = value;
+                else if (k == "rotate_y") parts->back().rotate_y = value;
+                break;
+            case where::vector: {
+                int i = axis(k, "xyz");
+                if (i >= 0) target[i] = value;
+                break;
+            }
+            case where::color: {
+                int i = axis(k, "rgb");
+                if (i >= 0) color_target[i] = static_cast<float>(value);
+                break;
+            }
+            default: break;
+        }
+        return true;
+    }
+
+    // How errors name the current object: its "name", else its index
+    std::string object_label() const {
+        if (!object.name.empty()) return "object \"" + object.name + "\"";
+        return "object " + std::to_string(object_id);
+    }
+
+    // Materials with the same description share an index; types other than
+    // spheres, planes and meshes keep their id but are not rendered. A plane
+    // shape must be spelled exactly and bounded shapes need a positive size,
+    // since anything else would quietly become an infinite plane.
+    bool add_object() {
+        shape_kind shape = shape_kind::plane;
+        if (object.type == "Sphère") {
+            shape = shape_kind::sphere;
+        } else if (object.type == "Plan" && object.has_shape) {
+            if (object.shape == "quad") shape = shape_kind::quad;
+            else if (object.shape == "disk") shape = shape_kind::disk;
+            else {
+                error = "JSON error: " + object_label() + " has an unknown \"shape\" \"" + object.shape
+                      + "\" (expected \"quad\" or \"disk\")";
+                return false;
+            }
+            if (!object.has_size || !(object.size > 0.0f)) {
+                error = "JSON error: " + object_label() + " is a " + object.shape + " without a positive \"size\"";
+                return false;
+            }
+        }
+
+        material_record mat{};
+        mat.kind = material_from_name(object.material);
+        std::memcpy(mat.color, object.color, sizeof(mat.color));
+        switch (mat.kind) {
+            case material_kind::metal: mat.parameter = object.roughness; break;
+            case material_kind::dielectric: mat.parameter = object.refraction_index; break;
+            case material_kind::emissive: mat.parameter = object.emission_strength; break;
+            default: break;
+        }
+        auto found = material_index.emplace(key_of(mat), static_cast<std::uint32_t>(desc.material_storage.size()));
+        if (found.second) desc.material_storage.push_back(mat);
+
+        if (object.type == "Sphère" || object.type == "Plan") {
+            object_record record{};
+            record.shape = shape;
+            record.material = found.first->second;
+            record.id = object_id;
+            for (int i = 0; i < 3; ++i) record.position[i] = static_cast<float>(object.position[i]);
+            record.size = record.shape == shape_kind::plane ? 0.0f : object.size;
+            record.rotate_y = record.shape == shape_kind::quad ? object.rotate_y : 0.0f;
+            desc.object_storage.push_back(record);
+        } else if ((object.type == "Maillage" || object.type == "Mesh") && !object.file.empty()) {
+            mesh_record record{};
+            record.material = found.first->second;
+            record.id = object_id;
+            for (int i = 0; i < 3; ++i) record.position[i] = static_cast<float>(object.position[i]);
+            record.scale = object.has_size ? object.size : 1.0f;
+            record.rotate_y = object.rotate_y;
+            add_path(desc, record, (base / object.file).lexically_normal().string());
+            desc.mesh_storage.push_back(record);
+        }
+        ++object_id;
+        return true;
+    }
+
+    void add_light() {
+        for (int i = 0; i < 3; ++i) light.position[i] = static_cast<float>(light_position[i]);
+        desc.light_storage.push_back(light);
+    }
+
+    scene_desc& desc;
+    std::vector<scene_part>* parts;
+    std::filesystem::path base;         // Directory of the scene file
+    std::vector<where> context{where::document};
+    std::string last_key;
+    double* target = nullptr;           // Vector being read
+    float* color_target = nullptr;      // Color being read
+    pending_object object;
+    light_record light{};
+    double light_position[3] = {0, 0, 0};
+    std::map<material_key, std::uint32_t> material_index;
+    std::int32_t object_id = 0;
+    bool has_render = false;
+    bool has_camera = false;
+    std::string error;
+};
+
+static void view_storage(scene_desc& desc) {
+    desc.materials = {desc.material_storage.data(), desc.material_storage.size()};
+    desc.objects = {desc.object_storage.data(), desc.object_storage.size()};
+    desc.meshes = {desc.mesh_storage.data(), desc.mesh_storage.size()};
+    desc.lights = {desc.light_storage.data(), desc.light_storage.size()};
+    desc.strings = {desc.string_storage.data(), desc.string_storage.size()};
+}
+
+static bool load_json(const std::string& path, scene_desc& desc, std::string& error, std::vector<scene_part>* parts) {
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> file(std::fopen(path.c_str(), "rb"), std::fclose);
+    if (!file) {
+        error = "Unable to open file " + path;
+        return false;
+    }
+    // The hash of the text ties a checkpoint to this exact scene
+    hashed_file_reader reader(file.get());
+    scene_sax handler(desc, parts, std::filesystem::path(path).parent_path());
+    const bool parsed = json::sax_parse(reader.begin(), reader.end(), &handler);
+    if (reader.failed()) {
+        error = "Unable to read file " + path;
+        return false;
+    }
+    if (!handler.complete(error) || !parsed) return false;
+    desc.content_hash = reader.hash();
+    view_storage(desc);
+    return true;
+}
+
+// ==================== BINARY ====================
+
+// Whole file read-only in memory: mapped where mmap exists, read otherwise
+static std::shared_ptr<const void> map_file(const std::string& path, std::size_t& size) {
+#if defined(__unix__) || defined(__APPLE__)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || info.st_size <= 0) {
+        ::close(fd);
+        return nullptr;
+    }
+    size = static_cast<std::size_t>(info.st_size);
+    void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);   // The mapping keeps the file
+    if (data == MAP_FAILED) return nullptr;
+    return std::shared_ptr<const void>(data, [size](const void* p) { ::munmap(const_cast<void*>(p), size); });
+#else
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) return nullptr;
+    size = static_cast<std::size_t>(file.tellg());
+    auto data = std::make_shared<std::vector<char>>(size);
+    file.seekg(0);
+    if (!file.read(data->data(), static_cast<std::streamsize>(size))) return nullptr;
+    return std::shared_ptr<const void>(data, data->data());
+#endif
+}
+
+// An array of count T at offset lies in the file and is aligned for T
+template <typename T>
+static bool array_fits(std::uint64_t offset, std::uint64_t count, std::size_t file_size) {
+    if (offset % alignof(T) != 0 || offset > file_size) return false;
+    return count <= (file_size - offset) / sizeof(T);
+}
+
+static bool load_binary(const std::string& path, scene_desc& desc, std::string& error) {
+    std::size_t size = 0;
+    std::shared_ptr<const void> mapping = map_file(path, size);
+    if (!mapping) {
+        error = "Unable to open file " + path;
+        return false;
+    }
+    const char* bytes = static_cast<const char*>(mapping.get());
+
+    scene_file_header header;
+    if (size < sizeof(header)) {
+        error = path + " is not a binary scene file";
+        return false;
+    }
+    std::memcpy(&header, bytes, sizeof(header));
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0) {
+        error = path + " is not a binary scene file";
+        return false;
+    }
+    if (header.version != format_version || header.header_size != sizeof(header)) {
+        error = path + " has scene format version " + std::to_string(header.version) + ", expected "
+              + std::to_string(format_version) + " (convert the JSON scene again)";
+        return false;
+    }
+    if (!array_fits<material_record>(header.materials_offset, header.material_count, size)
+        || !array_fits<object_record>(header.objects_offset, header.object_count, size)
+        || !array_fits<mesh_record>(header.meshes_offset, header.mesh_count, size)
+        || !array_fits<light_record>(header.lights_offset, header.light_count, size)
+        || !array_fits<char>(header.strings_offset, header.strings_size, size)) {
+        error = path + " is truncated or corrupt";
+        return false;
+    }
+
+    desc.render = header.render;
+    desc.camera = header.camera;
+    desc.materials = {reinterpret_cast<const material_record*>(bytes + header.materials_offset),
+                      static_cast<std::size_t>(header.material_count)};
+    desc.objects = {reinterpret_cast<const object_record*>(bytes + header.objects_offset),
+                    static_cast<std::size_t>(header.object_count)};
+    desc.lights = {reinterpret_cast<const light_record*>(bytes + header.lights_offset),
+                   static_cast<std::size_t>(header.light_count)};
+    for (const object_record& object : desc.objects) {
+        if (object.shape > shape_kind::disk) {
+            error = path + " is truncated or corrupt";
+            return false;
+        }
+        if (object.material >= desc.materials.size) {
+            error = path + " has an object with an unknown material";
+            return false;
+        }
+    }
+
+    // The few mesh records are copied: their paths are made relative to the
+    // current directory, like those read from JSON
+    const std::filesystem::path base = std::filesystem::path(path).parent_path();
+    const mesh_record* meshes = reinterpret_cast<const mesh_record*>(bytes + header.meshes_offset);
+    const char* strings = bytes + header.strings_offset;
+    for (std::uint64_t i = 0; i < header.mesh_count; ++i) {
+        mesh_record mesh = meshes[i];
+        if (mesh.material >= desc.materials.size || std::uint64_t(mesh.path_offset) + mesh.path_size > header.strings_size) {
+            error = path + " has a mesh with an unknown material or path";
+            return false;
+        }
+        const std::string file(strings + mesh.path_offset, mesh.path_size);
+        add_path(desc, mesh, (base / file).lexically_normal().string());
+        desc.mesh_storage.push_back(mesh);
+    }
+    desc.meshes = {desc.mesh_storage.data(), desc.mesh_storage.size()};
+    desc.strings = {desc.string_storage.data(), desc.string_storage.size()};
+
+    desc.content_hash = hash_scene(bytes, size);
+    desc.mapping = std::move(mapping);
+    return true;
+}
+
+// ==================== MANIFEST ====================
+
+static bool load_part(const std::string& path, scene_desc& desc, std::string& error) {
+    return extension_of(path) == "rscn" ? load_binary(path, desc, error) : load_json(path, desc, error, nullptr);
+}
+
+// Appends part to desc, placed by its transform. Materials are matched
+// against those already in desc, objects ids follow the ids already used.
+static void merge_part(const scene_part& placement, const scene_desc& part, scene_desc& desc,
+                       std::map<material_key, std::uint32_t>& material_index, std::int32_t& next_id) {
+    const double angle = placement.rotate_y * 3.14159265358979323846 / 180.0;
+    const double cos_a = std::cos(angle), sin_a = std::sin(angle), scale = placement.scale;
+    auto place = [&](const float in[3], float out[3]) {
+        const double x = scale * in[0], y = scale * in[1], z = scale * in[2];
+        out[0] = static_cast<float>(cos_a * x + sin_a * z + placement.translate[0]);
+        out[1] = static_cast<float>(y + placement.translate[1]);
+        out[2] = static_cast<float>(-sin_a * x + cos_a * z + placement.translate[2]);
+    };
+
+    std::vector<std::uint32_t> remap(part.materials.size);
+    for (std::size_t i = 0; i < part.materials.size; ++i) {
+        auto found = material_index.emplace(key_of(part.materials[i]), static_cast<std::uint32_t>(desc.material_storage.size()));
+        if (found.second) desc.material_storage.push_back(part.materials[i]);
+        remap[i] = found.first->second;
+    }
+
+    std::int32_t last_id = -1;
+    desc.object_storage.reserve(desc.object_storage.size() + part.objects.size);
+    for (const object_record& object : part.objects) {
+        object_record record = object;
+        place(object.position, record.position);
+        record.size = static_cast<float>(object.size * scale);
+        if (object.shape == shape_kind::quad) record.rotate_y = static_cast<float>(object.rotate_y + placement.rotate_y);
+        record.material = remap[object.material];
+        record.id = next_id + object.id;
+        last_id = std::max(last_id, object.id);
+        desc.object_storage.push_back(record);
+    }
+    for (const mesh_record& mesh : part.meshes) {
+        mesh_record record = mesh;
+        place(mesh.position, record.position);
+        record.scale = static_cast<float>(mesh.scale * scale);
+        record.rotate_y = static_cast<float>(mesh.rotate_y + placement.rotate_y);
+        record.material = remap[mesh.material];
+        record.id = next_id + mesh.id;
+        last_id = std::max(last_id, mesh.id);
+        add_path(desc, record, part.path_of(mesh));
+        desc.mesh_storage.push_back(record);
+    }
+    next_id += last_id + 1;
+
+    for (const light_record& light : part.lights) {
+        light_record record = light;
+        place(light.position, record.position);
+        desc.light_storage.push_back(record);
+    }
+}
+
+// The parts are loaded concurrently, each into its own description, then
+// appended in the order of the manifest so the result does not depend on
+// which part finished first
+static bool load_parts(const std::string& manifest_path, const std::vector<scene_part>& parts, scene_desc& desc,
+                       std::string& error, int threads) {
+    const std::filesystem::path base = std::filesystem::path(manifest_path).parent_path();
+    std::vector<scene_desc> loaded(parts.size());
+    std::vector<std::string> errors(parts.size());
+    std::vector<char> ok(parts.size(), 0);
+    auto load = [&](std::size_t i) {
+        const std::string path = (base / parts[i].file).string();
+        ok[i] = load_part(path, loaded[i], errors[i]);
+    };
+    if (threads == 1 || parts.size() == 1) {
+        for (std::size_t i = 0; i < parts.size(); ++i) load(i);
+    } else {
+        const int hardware = static_cast<int>(std::thread::hardware_concurrency());
+        const int count = threads > 0 ? threads : std::max(1, hardware);
+        thread_pool pool(std::min<int>(count, static_cast<int>(parts.size())));
+        pool.parallel_for(parts.size(), load);
+    }
+
+    std::map<material_key, std::uint32_t> material_index;
+    for (std::size_t i = 0; i < desc.material_storage.size(); ++i) {
+        material_index.emplace(key_of(desc.material_storage[i]), static_cast<std::uint32_t>(i));
+    }
+    std::int32_t next_id = 0;
+    for (const object_record& object : desc.object_storage) next_id = std::max(next_id, object.id + 1);
+    for (const mesh_record& mesh : desc.mesh_storage) next_id = std::max(next_id, mesh.id + 1);
+
+    std::uint64_t hash = desc.content_hash;
+    for (std::size_t i = 0; i < parts.size(); ++i) {
+        if (!ok[i]) {
+            error = "Part '" + parts[i].file + "' of " + manifest_path + ": " + errors[i];
+            return false;
+        }
+        merge_part(parts[i], loaded[i], desc, material_index, next_id);
+        hash = hash_scene(&loaded[i].content_hash, sizeof(loaded[i].content_hash), hash);
+        loaded[i] = scene_desc();   // Unmap or free as soon as it is merged
+    }
+    desc.content_hash = hash;
+    view_storage(desc);
+    return true;
+}
+
+bool load_scene(const std::string& path, scene_desc& desc, std::string& error, int threads) {
+    desc = scene_desc();
+    if (extension_of(path) == "rscn") return load_binary(path, desc, error);
+    std::vector<scene_part> parts;
+    if (!load_json(path, desc, error, &parts)) return false;
+    return parts.empty() || load_parts(path, parts, desc, error, threads);
+}
+
+static std::uint64_t align8(std::uint64_t offset) {
+    return (offset + 7) & ~std::uint64_t(7);
+}
+
+bool save_scene_binary(const std::string& path, const scene_desc& desc) {
+    // Mesh paths, relative to the directory of the new file
+    const std::filesystem::path base = std::filesystem::absolute(path).parent_path();
+    scene_desc paths;
+    std::vector<mesh_record> meshes(desc.meshes.begin(), desc.meshes.end());
+    for (mesh_record& mesh : meshes) {
+        const std::filesystem::path file = std::filesystem::absolute(desc.path_of(mesh));
+        add_path(paths, mesh, file.lexically_proximate(base).string());
+    }
+    const std::vector<char>& strings = paths.string_storage;
+
+    scene_file_header header{};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = format_version;
+    header.header_size = sizeof(header);
+    header.render = desc.render;
+    header.camera = desc.camera;
+    header.material_count = desc.materials.size;
+    header.materials_offset = align8(sizeof(header));
+    header.object_count = desc.objects.size;
+    header.objects_offset = align8(header.materials_offset + desc.materials.size * sizeof(material_record));
+    header.mesh_count = meshes.size();
+    header.meshes_offset = align8(header.objects_offset + desc.objects.size * sizeof(object_record));
+    header.light_count = desc.lights.size;
+    header.lights_offset = align8(header.meshes_offset + meshes.size() * sizeof(mesh_record));
+    header.strings_size = strings.size();
+    header.strings_offset = header.lights_offset + desc.lights.size * sizeof(light_record);
+    const std::uint64_t file_size = header.strings_offset + strings.size();
+
+    // One buffer, one write (zeros in the alignment gaps)
+    std::vector<char> data(static_cast<std::size_t>(file_size), 0);
+    auto put = [&](std::uint64_t offset, const void* source, std::size_t bytes) {
+        if (bytes > 0) std::memcpy(data.data() + offset, source, bytes);
+    };
+    put(0, &header, sizeof(header));
+    put(header.materials_offset, desc.materials.data, desc.materials.size * sizeof(material_record));
+    put(header.objects_offset, desc.objects.data, desc.objects.size * sizeof(object_record));
+    put(header.meshes_offset, meshes.data(), meshes.size() * sizeof(mesh_record));
+    put(header.lights_offset, desc.lights.data, desc.lights.size * sizeof(light_record));
+    put(header.strings_offset, strings.data(), strings.size());
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+    file.write(data.data(), static_cast<std::streamsize>(data.size()));
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,86 @@
+#include "core/thread_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+thread_pool::thread_pool(int num_threads) {
+    if (num_threads <= 0) {
+        num_threads = static_cast<int>(std::thread::hardware_concurrency());
+        if (num_threads <= 0) num_threads = 1;
+    }
+    // The calling thread takes part in parallel_for, so spawn one less
+    for (int i = 1; i < num_threads; ++i) {
+        workers.emplace_back([this] { worker_loop(); });
+    }
+}
+
+thread_pool::~thread_pool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    task_available.notify_all();
+    for (std::thread& worker : workers) worker.join();
+}
+
+void thread_pool::worker_loop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            task_available.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) return;
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task();
+    }
+}
+
+void thread_pool::submit(std::function<void()> fn) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push(std::move(fn));
+    }
+    task_available.notify_one();
+}
+
+void thread_pool::parallel_for(std::size_t count, const std::function<void(std::size_t)>& fn) {
+    if (count == 0) return;
+
+    // Shared with the helpers: a helper that only starts once everything is
+    // done finds no index left and returns without touching fn
+    struct job_state {
+        std::atomic<std::size_t> next{0};
+        std::atomic<std::size_t> done{0};
+        std::size_t count = 0;
+        const std::function<void(std::size_t)>* fn = nullptr;
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    auto state = std::make_shared<job_state>();
+    state->count = count;
+    state->fn = &fn;
+
+    auto run = [](job_state& s) {
+        while (true) {
+            std::size_t i = s.next.fetch_add(1);
+            if (i >= s.count) return;
+            (*s.fn)(i);
+            if (s.done.fetch_add(1) + 1 == s.count) {
+                std::lock_guard<std::mutex> lock(s.mutex);
+                s.finished.notify_all();
+            }
+        }
+    };
+
+    std::size_t helpers = std::min(workers.size(), count - 1);
+    for (std::size_t h = 0; h < helpers; ++h) {
+        submit([state, run] { run(*state); });
+    }
+
+    run(*state);
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&] { return state->done.load() == state->count; });
+}
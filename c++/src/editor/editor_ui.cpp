@@ -6,10 +6,41 @@
 #include "../../external/nlohmann/json.hpp"
 #include <fstream>
 #include <filesystem>
+#include <cstdlib>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/wait.h>
+#endif
 
 
 using json = nlohmann::json;
 
+// Scène et image du ray tracer lancé par l'éditeur : le bouton
+// "Re-post-traiter" relit les tampons de ce même rendu
+static const std::string render_scene_path = "../c++/src/data/save/demo_scene.json";
+static const std::string render_output_path = "image.ppm";
+
+// Runs ./main on the editor's scene and output with the extra arguments.
+// Returns false, with the reason in status, if it could not be started or
+// did not exit with 0.
+static bool run_tracer(const std::string& arguments, std::string& status) {
+    const std::string command = "./main --scene " + render_scene_path + " --output " + render_output_path + " " + arguments;
+    const int result = std::system(command.c_str());
+    if (result == -1) {
+        status = "Impossible de lancer : " + command;
+        return false;
+    }
+#if defined(__unix__) || defined(__APPLE__)
+    const bool ok = WIFEXITED(result) && WEXITSTATUS(result) == 0;
+    const int code = WIFEXITED(result) ? WEXITSTATUS(result) : result;
+#else
+    const bool ok = result == 0;
+    const int code = result;
+#endif
+    status = ok ? "OK : " + command : "Échec (code " + std::to_string(code) + ") : " + command;
+    return ok;
+}
+
 // ============================================================================
 // CONSTRUCTEUR
 // ============================================================================
@@ -220,7 +251,15 @@ void EditorUI::render_properties() {
         if (obj->type == ObjectType::SPHERE) {
             ImGui::SliderFloat("Rayon", &obj->size, 0.1f, 5.0f);
         } else if (obj->type == ObjectType::PLANE) {
-            ImGui::SliderFloat("Échelle", &obj->size, 1.0f, 20.0f);
+            // Fini, le plan a une boîte englobante : le tracer peut l'écarter
+            const char* shapes[] = { "Infini", "Carré", "Disque" };
+            int current_shape = (int)obj->plane_shape;
+            if (ImGui::Combo("Forme", &current_shape, shapes, IM_ARRAYSIZE(shapes))) {
+                obj->plane_shape = (PlaneShape)current_shape;
+            }
+            const char* label = obj->plane_shape == PlaneShape::DISK ? "Diamètre"
+                              : obj->plane_shape == PlaneShape::QUAD ? "Côté" : "Échelle";
+            ImGui::SliderFloat(label, &obj->size, 1.0f, 20.0f);
         }
         
         ImGui::Spacing();
@@ -356,11 +395,12 @@ void EditorUI::render_actions() {
             ImGui::Spacing();
             ImGui::Text("Post-Processing");
             ImGui::SliderFloat("Gamma", &gamma, 1.0f, 3.0f);
+            ImGui::SliderFloat("Exposition", &exposure, 0.1f, 4.0f);
             
             ImGui::Checkbox("Denoise (Anti-Bruit)", &enable_denoise);
             if (enable_denoise) {
-                const char* denoise_types[] = { "Box Blur", "Gaussian (Recommandé)", "Bilateral (Lent)" };
-                ImGui::Combo("Type", &denoise_type, denoise_types, 3);
+                const char* denoise_types[] = { "Box Blur", "Gaussian (Recommandé)", "Bilateral (Lent)", "Bilateral Grid (Rapide)", "À-trous (Guidé)" };
+                ImGui::Combo("Type", &denoise_type, denoise_types, 5);
                 ImGui::SliderFloat("Force", &denoise_strength, 0.5f, 3.0f);
                 ImGui::TextColored(ImVec4(0.7f, 0.7f, 0.7f, 1.0f), "Réduit le bruit des néons");
             }
@@ -406,6 +446,7 @@ void EditorUI::render_actions() {
                 scene_data["render"]["sun_direction"]["z"] = sun_direction_z;
                 scene_data["render"]["ambient_light"] = ambient_light;
                 scene_data["render"]["gamma"] = gamma;
+                scene_data["render"]["exposure"] = exposure;
                 scene_data["render"]["enable_denoise"] = enable_denoise;
                 scene_data["render"]["denoise_type"] = denoise_type;
                 scene_data["render"]["denoise_strength"] = denoise_strength;
@@ -429,6 +470,9 @@ void EditorUI::render_actions() {
                     obj_data["color"]["g"] = obj->color.g;
                     obj_data["color"]["b"] = obj->color.b;
                     obj_data["size"] = obj->size;
+                    if (!obj->get_plane_shape_name().empty()) {
+                        obj_data["shape"] = obj->get_plane_shape_name();
+                    }
                     obj_data["material"] = obj->get_material_name();
                     if (obj->material == MaterialType::METAL) {
                         obj_data["roughness"] = obj->roughness;
@@ -495,6 +539,8 @@ void EditorUI::render_actions() {
                         ambient_light = scene_data["render"]["ambient_light"];
                     if (scene_data["render"].contains("gamma"))
                         gamma = scene_data["render"]["gamma"];
+                    if (scene_data["render"].contains("exposure"))
+                        exposure = scene_data["render"]["exposure"];
                     if (scene_data["render"].contains("enable_denoise"))
                         enable_denoise = scene_data["render"]["enable_denoise"];
                     if (scene_data["render"].contains("denoise_type"))
@@ -550,6 +596,10 @@ void EditorUI::render_actions() {
                 scene_data["render"]["sun_direction"]["z"] = sun_direction_z;
                 scene_data["render"]["ambient_light"] = ambient_light;
                 scene_data["render"]["gamma"] = gamma;
+                scene_data["render"]["exposure"] = exposure;
+                scene_data["render"]["enable_denoise"] = enable_denoise;
+                scene_data["render"]["denoise_type"] = denoise_type;
+                scene_data["render"]["denoise_strength"] = denoise_strength;
                 scene_data["render"]["num_threads"] = num_threads;
 
                 //scene_data["environment"]["background"] = background_color;
@@ -568,6 +618,9 @@ void EditorUI::render_actions() {
                     obj_data["color"]["g"] = obj->color.g;
                     obj_data["color"]["b"] = obj->color.b;
                     obj_data["size"] = obj->size;
+                    if (!obj->get_plane_shape_name().empty()) {
+                        obj_data["shape"] = obj->get_plane_shape_name();
+                    }
                     obj_data["material"] = obj->get_material_name();
                     if (obj->material == MaterialType::METAL) {
                         obj_data["roughness"] = obj->roughness;
@@ -579,7 +632,7 @@ void EditorUI::render_actions() {
                     scene_data["objects"].push_back(obj_data);
                 }
 
-                std::string save_path = "../c++/src/data/save/demo_scene.json";
+                const std::string& save_path = render_scene_path;
 
                 // Save lights to JSON
                 scene_data["lights"] = json::array();
@@ -599,12 +652,49 @@ void EditorUI::render_actions() {
                 ofs << scene_data.dump(4);
                 ofs.close();
 
-                //lancer le render
-                system("make run");
+                // Lancer le render, en gardant les tampons pour "Re-post-traiter"
+                tracer_ok = run_tracer("--save-buffers", tracer_status);
 
             } catch (const std::exception& e) {
                 std::cerr << "Erreur lors de la sauvegarde de la scène : " << e.what() << std::endl;
+                tracer_ok = false;
+                tracer_status = std::string("Erreur lors de la sauvegarde de la scène : ") + e.what();
         }   
         }
+
+        // Bouton Post-traitement : gamma, exposition et denoise sur les
+        // tampons du dernier rendu lancé par l'éditeur (image.pfm + AOVs),
+        // sans relancer le path tracing
+        if (ImGui::Button("Re-post-traiter (sans re-rendu)", ImVec2(-1, 0))) {
+            try {
+                const std::string& scene_path = render_scene_path;
+                std::ifstream ifs(scene_path);
+                json scene_data = json::parse(ifs);
+                ifs.close();
+
+                scene_data["render"]["gamma"] = gamma;
+                scene_data["render"]["exposure"] = exposure;
+                scene_data["render"]["enable_denoise"] = enable_denoise;
+                scene_data["render"]["denoise_type"] = denoise_type;
+                scene_data["render"]["denoise_strength"] = denoise_strength;
+
+                std::ofstream ofs(scene_path);
+                ofs << scene_data.dump(4);
+                ofs.close();
+
+                tracer_ok = run_tracer("--post-only", tracer_status);
+            } catch (const std::exception& e) {
+                std::cerr << "[POST] Erreur lors du post-traitement : " << e.what() << std::endl;
+                tracer_ok = false;
+                tracer_status = std::string("Erreur lors du post-traitement : ") + e.what();
+            }
+        }
+
+        // Résultat du dernier lancement du ray tracer
+        if (!tracer_status.empty()) {
+            ImGui::PushStyleColor(ImGuiCol_Text, tracer_ok ? ImVec4(0.5f, 1.0f, 0.5f, 1.0f) : ImVec4(1.0f, 0.4f, 0.4f, 1.0f));
+            ImGui::TextWrapped("%s", tracer_status.c_str());
+            ImGui::PopStyleColor();
+        }
     }
 }
@@ -39,7 +39,7 @@ int main() {
     // 3. CRÉER LA GÉOMÉTRIE (sphère + plan)
     // ====================================================================
     Sphere sphere_mesh;
-    Plane plane_mesh(10.0f);  // Plan de 10x10 unités
+    Plane plane_mesh(1.0f);   // Plan unité : l'échelle de l'objet donne son côté, comme pour le picking et le tracer
     Grid grid(100.0f, 100);     // Grille de 10x10 unités, 10 divisions
     
     // ====================================================================
@@ -242,6 +242,11 @@ int Scene::pick_object(glm::vec3 ray_origin, glm::vec3 ray_direction) {
             hit = ray_sphere_intersection(ray_origin, ray_direction, obj->position, effective_radius, t_hit);
         }else if( obj -> type == ObjectType::PLANE){
             hit = ray_plane_intersection(ray_origin, ray_direction, obj->position, glm::vec3(0,1,0), obj->size, t_hit);
+            // Le disque est inscrit dans le carré
+            if (hit && obj->plane_shape == PlaneShape::DISK) {
+                glm::vec3 local = ray_origin + ray_direction * t_hit - obj->position;
+                hit = glm::dot(local, local) <= obj->size * obj->size / 4.0f;
+            }
         }
         if (hit && t_hit < closest_distance){
             closest_distance = t_hit;
@@ -299,6 +304,13 @@ void Scene::load_from_json(const std::string& filepath) {
                 if (obj_data.contains("size")) {
                     obj->size = obj_data["size"];
                 }
+
+                // Étendue d'un plan (absente : infini)
+                if (obj_type == ObjectType::PLANE && obj_data.contains("shape")) {
+                    std::string shape = obj_data["shape"];
+                    if (shape == "quad") obj->plane_shape = PlaneShape::QUAD;
+                    else if (shape == "disk") obj->plane_shape = PlaneShape::DISK;
+                }
                 
                 // Matériau
                 if (obj_data.contains("material")) {
@@ -15,6 +15,7 @@ SceneObject::SceneObject()
     , position(0.0f, 0.0f, 0.0f)
     , color(1.0f, 1.0f, 1.0f)  // Blanc
     , size(1.0f)               // Rayon = 1
+    , plane_shape(PlaneShape::INFINITE_PLANE)
     , material(MaterialType::DIFFUSE)
     , roughness(0.0f)
     , refraction_index(1.5f)   // Verre normal
@@ -33,6 +34,7 @@ SceneObject::SceneObject(ObjectType t, const std::string& n)
     , position(0.0f, 0.0f, 0.0f)
     , color(1.0f, 1.0f, 1.0f)
     , size(1.0f)
+    , plane_shape(PlaneShape::INFINITE_PLANE)
     , material(MaterialType::DIFFUSE)
     , roughness(0.0f)
     , refraction_index(1.5f)
@@ -88,3 +90,12 @@ std::string SceneObject::get_material_name() const {
         default:                        return "Inconnu";
     }
 }
+
+std::string SceneObject::get_plane_shape_name() const {
+    if (type != ObjectType::PLANE) return "";
+    switch (plane_shape) {
+        case PlaneShape::QUAD: return "quad";
+        case PlaneShape::DISK: return "disk";
+        default:               return "";
+    }
+}
@@ -0,0 +1,198 @@
+#include "geometry/bvh.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace {
+
+constexpr int bin_count = 16;
+
+struct bin {
+    aabb bounds = aabb::empty();
+    std::uint32_t count = 0;
+};
+
+// A range of order[] to turn into the subtree of nodes[node]
+struct build_task {
+    std::uint32_t node;
+    std::uint32_t begin, end;
+    int depth;
+};
+
+} // namespace
+
+// Each node is split at the best of the bin_count - 1 planes between bins of
+// centroids along its widest axis, by the cost left area * left count +
+// right area * right count. Ranges whose centroids coincide, or where SAH
+// puts everything on one side, are split in two halves instead.
+void bvh::build(const std::vector<aabb>& boxes, std::vector<std::uint32_t>& order, int max_leaf_size) {
+    nodes.clear();
+    qnodes.clear();
+    order.resize(boxes.size());
+    std::iota(order.begin(), order.end(), 0u);
+    root_bounds = aabb::empty();
+    if (boxes.empty()) return;
+
+    nodes.reserve(2 * boxes.size() / std::max(1, max_leaf_size / 2));
+    nodes.push_back(node{});
+    std::vector<build_task> tasks{{0, 0, static_cast<std::uint32_t>(boxes.size()), 1}};
+    while (!tasks.empty()) {
+        const build_task task = tasks.back();
+        tasks.pop_back();
+
+        aabb bounds = aabb::empty(), centroids = aabb::empty();
+        for (std::uint32_t i = task.begin; i < task.end; ++i) {
+            const aabb& box = boxes[order[i]];
+            bounds.grow(box);
+            centroids.grow(vec3(box.centroid(0), box.centroid(1), box.centroid(2)));
+        }
+        node& current = nodes[task.node];
+        for (int axis = 0; axis < 3; ++axis) {
+            current.min[axis] = bounds.min[axis];
+            current.max[axis] = bounds.max[axis];
+        }
+        if (task.node == 0) root_bounds = bounds;
+
+        const std::uint32_t count = task.end - task.begin;
+        if (count <= static_cast<std::uint32_t>(max_leaf_size) || task.depth >= max_depth) {
+            current.index = task.begin;
+            current.count = count;
+            continue;
+        }
+
+        int axis = 0;
+        for (int a = 1; a < 3; ++a) {
+            if (centroids.max[a] - centroids.min[a] > centroids.max[axis] - centroids.min[axis]) axis = a;
+        }
+        const real extent = centroids.max[axis] - centroids.min[axis];
+
+        std::uint32_t middle = task.begin + count / 2;
+        bool binned = false;
+        if (extent > 0) {
+            const real scale = real(bin_count) / extent;
+            auto bin_of = [&](std::uint32_t primitive) {
+                int b = static_cast<int>((boxes[primitive].centroid(axis) - centroids.min[axis]) * scale);
+                return std::min(b, bin_count - 1);
+            };
+            bin bins[bin_count];
+            for (std::uint32_t i = task.begin; i < task.end; ++i) {
+                bin& b = bins[bin_of(order[i])];
+                b.bounds.grow(boxes[order[i]]);
+                ++b.count;
+            }
+
+            // Costs of the planes, sweeping from the right then from the left
+            real right_cost[bin_count];
+            aabb right = aabb::empty();
+            std::uint32_t right_count = 0;
+            for (int b = bin_count - 1; b > 0; --b) {
+                right.grow(bins[b].bounds);
+                right_count += bins[b].count;
+                right_cost[b] = right_count ? right.half_area() * right_count : 0;
+            }
+            aabb left = aabb::empty();
+            std::uint32_t left_count = 0;
+            real best_cost = std::numeric_limits<real>::infinity();
+            int best_plane = -1;
+            for (int b = 1; b < bin_count; ++b) {
+                left.grow(bins[b - 1].bounds);
+                left_count += bins[b - 1].count;
+                if (left_count == 0 || left_count == count) continue;
+                const real cost = left.half_area() * left_count + right_cost[b];
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    best_plane = b;
+                }
+            }
+            if (best_plane > 0) {
+                binned = true;
+                middle = static_cast<std::uint32_t>(
+                    std::partition(order.begin() + task.begin, order.begin() + task.end,
+                                   [&](std::uint32_t primitive) { return bin_of(primitive) < best_plane; })
+                    - order.begin());
+            }
+        }
+        if (!binned) {
+            std::nth_element(order.begin() + task.begin, order.begin() + middle, order.begin() + task.end,
+                             [&](std::uint32_t a, std::uint32_t b) { return boxes[a].centroid(axis) < boxes[b].centroid(axis); });
+        }
+
+        const std::uint32_t children = static_cast<std::uint32_t>(nodes.size());
+        nodes[task.node].index = children;
+        nodes[task.node].count = 0;
+        nodes.push_back(node{});
+        nodes.push_back(node{});
+        tasks.push_back({children, task.begin, middle, task.depth + 1});
+        tasks.push_back({children + 1, middle, task.end, task.depth + 1});
+    }
+    nodes.shrink_to_fit();
+}
+
+namespace {
+
+// Child bounds [min, max] on one axis as 8-bit steps from the parent's
+// decoded min, rounded outwards and then checked against the decoding
+// itself. False if the parent's range cannot hold them.
+bool quantize_axis(real parent_min, real parent_max, real min, real max, std::uint8_t& lo, std::uint8_t& hi) {
+    const real step = bvh::quantization_step(parent_min, parent_max);
+    int q_lo = 0, q_hi = 255;
+    if (step > 0) {
+        q_lo = std::clamp(static_cast<int>(std::floor((min - parent_min) / step)), 0, 255);
+        q_hi = std::clamp(static_cast<int>(std::ceil((max - parent_min) / step)), 0, 255);
+    }
+    while (q_lo > 0 && bvh::dequantize(parent_min, step, std::uint8_t(q_lo)) > min) --q_lo;
+    while (q_hi < 255 && bvh::dequantize(parent_min, step, std::uint8_t(q_hi)) < max) ++q_hi;
+    lo = std::uint8_t(q_lo);
+    hi = std::uint8_t(q_hi);
+    return bvh::dequantize(parent_min, step, lo) <= min && bvh::dequantize(parent_min, step, hi) >= max;
+}
+
+} // namespace
+
+// Records are written top down, because a child is quantized against its
+// parent's decoded box, not its exact one. Siblings' records are adjacent.
+bool bvh::compress() {
+    if (nodes.empty() || nodes[0].count > 0) return false;
+
+    struct task {
+        std::uint32_t node, record;
+        aabb box;           // Decoded box of node
+    };
+    std::vector<qnode> records(1);
+    std::vector<task> tasks{{0, 0, root_bounds}};
+    while (!tasks.empty()) {
+        const task t = tasks.back();
+        tasks.pop_back();
+        const node& parent = nodes[t.node];
+        qnode packed{};
+        for (int c = 0; c < 2; ++c) {
+            const node& n = nodes[parent.index + c];
+            aabb decoded;
+            for (int axis = 0; axis < 3; ++axis) {
+                if (!quantize_axis(t.box.min[axis], t.box.max[axis], n.min[axis], n.max[axis],
+                                   packed.lo[c][axis], packed.hi[c][axis])) {
+                    return false;
+                }
+                const real step = quantization_step(t.box.min[axis], t.box.max[axis]);
+                decoded.min[axis] = dequantize(t.box.min[axis], step, packed.lo[c][axis]);
+                decoded.max[axis] = dequantize(t.box.min[axis], step, packed.hi[c][axis]);
+            }
+            if (n.count > 0) {
+                if (n.count > max_compressed_leaf || n.index >= max_compressed_first) return false;
+                packed.child[c] = leaf_bit | (n.count - 1) << 27 | n.index;
+            } else {
+                packed.child[c] = static_cast<std::uint32_t>(records.size());
+                records.emplace_back();
+                tasks.push_back({parent.index + c, packed.child[c], decoded});
+            }
+        }
+        records[t.record] = packed;
+    }
+
+    records.shrink_to_fit();
+    qnodes = std::move(records);
+    nodes.clear();
+    nodes.shrink_to_fit();
+    return true;
+}
@@ -0,0 +1,79 @@
+#include "geometry/bvh_accel.hpp"
+#include "core/thread_pool.hpp"
+#include <utility>
+
+bvh_accel::bvh_accel(std::vector<std::shared_ptr<hittable>> objects, bool quantized_nodes) {
+    std::vector<aabb> boxes;
+    std::vector<std::shared_ptr<hittable>> boxed;
+    for (std::shared_ptr<hittable>& object : objects) {
+        aabb box;
+        if (object->bounding_box(box)) {
+            boxes.push_back(box);
+            boxed.push_back(std::move(object));
+        } else {
+            unbounded.push_back(std::move(object));
+        }
+    }
+
+    std::vector<std::uint32_t> order;
+    tree.build(boxes, order);
+    bounded.reserve(boxed.size());
+    for (std::uint32_t i : order) bounded.push_back(std::move(boxed[i]));
+    if (quantized_nodes) tree.compress();
+}
+
+// The same steps with the per-object ones on the pool
+bvh_accel::bvh_accel(std::vector<std::shared_ptr<hittable>> objects, thread_pool& pool, int code_bits,
+                     int treelet_rounds) {
+    std::vector<aabb> all_boxes(objects.size());
+    std::vector<char> has_box(objects.size());
+    pool.parallel_ranges(objects.size(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) has_box[i] = objects[i]->bounding_box(all_boxes[i]);
+    });
+    std::vector<aabb> boxes;
+    std::vector<std::shared_ptr<hittable>> boxed;
+    boxes.reserve(objects.size());
+    boxed.reserve(objects.size());
+    for (std::size_t i = 0; i < objects.size(); ++i) {
+        if (has_box[i]) {
+            boxes.push_back(all_boxes[i]);
+            boxed.push_back(std::move(objects[i]));
+        } else {
+            unbounded.push_back(std::move(objects[i]));
+        }
+    }
+
+    std::vector<std::uint32_t> order;
+    tree.build_lbvh(boxes, order, pool, code_bits, treelet_rounds);
+    bounded.resize(boxed.size());
+    pool.parallel_ranges(order.size(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) bounded[i] = std::move(boxed[order[i]]);
+    });
+}
+
+bool bvh_accel::bounding_box(aabb& box) const {
+    box = tree.bounds();
+    return unbounded.empty() && !tree.empty();
+}
+
+bool bvh_accel::hit(const vec3& ray_origin, const vec3& ray_direction, real t_max, hit_record& rec) const {
+    const vec3 inv_direction(1 / ray_direction.x, 1 / ray_direction.y, 1 / ray_direction.z);
+    real t_closest = t_max;
+    bool found = false;
+    tree.traverse(ray_origin, inv_direction, t_max, [&](std::uint32_t first, std::uint32_t count, real& t_limit) {
+        for (std::uint32_t i = first; i < first + count; ++i) {
+            if (bounded[i]->hit(ray_origin, ray_direction, t_limit, rec)) {
+                t_limit = t_closest = rec.t;
+                found = true;
+            }
+        }
+        return false;
+    });
+    for (const std::shared_ptr<hittable>& object : unbounded) {
+        if (object->hit(ray_origin, ray_direction, t_closest, rec)) {
+            t_closest = rec.t;
+            found = true;
+        }
+    }
+    return found;
+}
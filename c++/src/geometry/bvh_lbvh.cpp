@@ -0,0 +1,422 @@
+#include "geometry/bvh.hpp"
+#include "core/thread_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
+
+namespace {
+
+// Treelets of up to this many leaves are restructured (all 2^7 subsets are
+// costed), under nodes of at least treelet_min_count primitives: smaller
+// subtrees end up in one or two leaves anyway
+constexpr int treelet_leaves = 7;
+constexpr std::uint32_t treelet_min_count = 32;
+
+// Child reference of the binary tree: a sorted primitive, else a node
+constexpr std::uint32_t primitive_bit = 0x80000000u;
+constexpr std::uint32_t no_parent = 0xffffffffu;
+
+// Moves the low 10 (21) bits of x to every third bit
+std::uint32_t spread_bits(std::uint32_t x) {
+    x &= 0x3ffu;
+    x = (x | x << 16) & 0x030000ffu;
+    x = (x | x << 8) & 0x0300f00fu;
+    x = (x | x << 4) & 0x030c30c3u;
+    x = (x | x << 2) & 0x09249249u;
+    return x;
+}
+
+std::uint64_t spread_bits(std::uint64_t x) {
+    x &= 0x1fffffull;
+    x = (x | x << 32) & 0x1f00000000ffffull;
+    x = (x | x << 16) & 0x1f0000ff0000ffull;
+    x = (x | x << 8) & 0x100f00f00f00f00full;
+    x = (x | x << 4) & 0x10c30c30c30c30c3ull;
+    x = (x | x << 2) & 0x1249249249249249ull;
+    return x;
+}
+
+// Index of the lowest set bit of a non-empty treelet subset
+int lowest_leaf(unsigned subset) {
+    int leaf = 0;
+    while (!(subset & 1u << leaf)) ++leaf;
+    return leaf;
+}
+
+// The fixed blocks of [0, count) the sort keeps per-block histograms for
+std::size_t block_count(std::size_t count, const thread_pool& pool) {
+    return std::max<std::size_t>(1, std::min<std::size_t>(count / 4096, 4 * pool.size()));
+}
+
+// Stable LSD radix sort of keys, carrying values, radix_bits per pass (3
+// passes for 30-bit codes): each block counts its digits, then writes its
+// keys at its offsets. A pass whose digit is the same for every key is
+// skipped.
+constexpr int radix_bits = 11;
+constexpr std::uint32_t radix = 1u << radix_bits;
+
+template <typename Code>
+void radix_sort(std::vector<Code>& keys, std::vector<std::uint32_t>& values, int bits, thread_pool& pool) {
+    const std::size_t count = keys.size(), blocks = block_count(count, pool);
+    std::vector<Code> keys_out(count);
+    std::vector<std::uint32_t> values_out(count);
+    std::vector<std::uint32_t> offsets(blocks * radix);
+    for (int shift = 0; shift < bits; shift += radix_bits) {
+        pool.parallel_for(blocks, [&](std::size_t b) {
+            std::uint32_t* histogram = offsets.data() + radix * b;
+            std::fill(histogram, histogram + radix, 0u);
+            for (std::size_t i = count * b / blocks; i < count * (b + 1) / blocks; ++i) ++histogram[(keys[i] >> shift) & (radix - 1)];
+        });
+        bool uniform = false;
+        std::uint32_t running = 0;
+        for (std::uint32_t digit = 0; digit < radix; ++digit) {
+            const std::uint32_t digit_start = running;
+            for (std::size_t b = 0; b < blocks; ++b) {
+                const std::uint32_t n = offsets[radix * b + digit];
+                offsets[radix * b + digit] = running;
+                running += n;
+            }
+            uniform = uniform || running - digit_start == count;
+        }
+        if (uniform) continue;
+        pool.parallel_for(blocks, [&](std::size_t b) {
+            std::uint32_t* offset = offsets.data() + radix * b;
+            for (std::size_t i = count * b / blocks; i < count * (b + 1) / blocks; ++i) {
+                const std::uint32_t k = offset[(keys[i] >> shift) & (radix - 1)]++;
+                keys_out[k] = keys[i];
+                values_out[k] = values[i];
+            }
+        });
+        keys.swap(keys_out);
+        values.swap(values_out);
+    }
+}
+
+// Binary tree over the sorted primitives, count - 1 nodes. Node k first
+// splits the primitives between sorted positions k and k + 1.
+struct binary_tree {
+    struct node {
+        std::uint32_t child[2];
+        std::uint32_t parent;
+        std::uint32_t count;    // Primitives below
+        std::uint32_t records;  // bvh nodes the subtree becomes
+        aabb box;
+        real cost;              // Sum of the half areas of the subtree's boxes
+    };
+
+    std::vector<std::uint32_t> sorted;          // Primitive at each sorted position
+    std::vector<aabb> boxes;                    // Box at each sorted position
+    std::vector<node> nodes;
+    std::vector<std::uint32_t> leaf_parent;     // Per sorted position
+    std::uint32_t root = 0;
+    std::uint32_t max_leaf_size = 4;
+
+    const aabb& box(std::uint32_t ref) const { return ref & primitive_bit ? boxes[ref & ~primitive_bit] : nodes[ref].box; }
+    real cost(std::uint32_t ref) const { return ref & primitive_bit ? box(ref).half_area() : nodes[ref].cost; }
+    std::uint32_t count(std::uint32_t ref) const { return ref & primitive_bit ? 1 : nodes[ref].count; }
+    std::uint32_t records(std::uint32_t ref) const { return ref & primitive_bit ? 1 : nodes[ref].records; }
+    void set_parent(std::uint32_t ref, std::uint32_t parent) {
+        (ref & primitive_bit ? leaf_parent[ref & ~primitive_bit] : nodes[ref].parent) = parent;
+    }
+
+    void refit(std::uint32_t i) {
+        node& n = nodes[i];
+        n.box = box(n.child[0]);
+        n.box.grow(box(n.child[1]));
+        n.count = count(n.child[0]) + count(n.child[1]);
+        n.records = n.count <= max_leaf_size ? 1 : 1 + records(n.child[0]) + records(n.child[1]);
+        n.cost = n.box.half_area() + cost(n.child[0]) + cost(n.child[1]);
+    }
+
+    template <typename Code, typename Visit>
+    void emit(const std::vector<Code>& codes, thread_pool& pool, Visit&& visit);
+
+    template <typename Visit>
+    void bottom_up(thread_pool& pool, Visit&& visit);
+
+    void restructure(std::uint32_t root);
+};
+
+// Apetrei, "Fast and Simple Agglomerative LBVH Construction" (2014): the
+// walk from each primitive joins its range [l, r] to the neighbour sharing
+// the longer code prefix, node r (as its left child) or node l - 1 (right
+// child). The second walk to reach a node has both children's ranges and
+// trees complete: it fits the node, visit()s it and goes on up. Equal
+// codes are told apart by position.
+template <typename Code, typename Visit>
+void binary_tree::emit(const std::vector<Code>& codes, thread_pool& pool, Visit&& visit) {
+    const std::uint32_t last = static_cast<std::uint32_t>(codes.size() - 1);
+    auto joins_right = [&](std::uint32_t l, std::uint32_t r) {
+        if (l == 0) return true;
+        if (r == last) return false;
+        const Code right = codes[r] ^ codes[r + 1], left = codes[l - 1] ^ codes[l];
+        return right != left ? right < left : (r ^ (r + 1)) < ((l - 1) ^ l);
+    };
+    constexpr std::uint32_t unset = 0xffffffffu;
+    std::unique_ptr<std::atomic<std::uint32_t>[]> other_end(new std::atomic<std::uint32_t>[last]);
+    pool.parallel_ranges(last, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) other_end[i].store(unset, std::memory_order_relaxed);
+    });
+    nodes.resize(last);
+    leaf_parent.resize(codes.size());
+    pool.parallel_ranges(codes.size(), [&](std::size_t begin, std::size_t end) {
+        for (std::uint32_t k = static_cast<std::uint32_t>(begin); k < end; ++k) {
+            std::uint32_t l = k, r = k, current = primitive_bit | k;
+            while (l != 0 || r != last) {
+                std::uint32_t parent, other;
+                if (joins_right(l, r)) {
+                    parent = r;
+                    nodes[parent].child[0] = current;
+                    set_parent(current, parent);
+                    if ((other = other_end[parent].exchange(l, std::memory_order_acq_rel)) == unset) break;
+                    r = other;
+                } else {
+                    parent = l - 1;
+                    nodes[parent].child[1] = current;
+                    set_parent(current, parent);
+                    if ((other = other_end[parent].exchange(r, std::memory_order_acq_rel)) == unset) break;
+                    l = other;
+                }
+                refit(parent);
+                visit(parent);
+                current = parent;
+            }
+            if (l == 0 && r == last) {
+                root = current;
+                nodes[root].parent = no_parent;
+            }
+        }
+    });
+}
+
+// visit(i) on every node after both its children, in parallel, by the
+// second walk up from the primitives to reach it
+template <typename Visit>
+void binary_tree::bottom_up(thread_pool& pool, Visit&& visit) {
+    std::unique_ptr<std::atomic<std::uint32_t>[]> visits(new std::atomic<std::uint32_t>[nodes.size()]);
+    pool.parallel_ranges(nodes.size(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) visits[i].store(0, std::memory_order_relaxed);
+    });
+    pool.parallel_ranges(leaf_parent.size(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t k = begin; k < end; ++k) {
+            for (std::uint32_t i = leaf_parent[k]; i != no_parent; i = nodes[i].parent) {
+                if (visits[i].fetch_add(1, std::memory_order_acq_rel) == 0) break;
+                visit(i);
+            }
+        }
+    });
+}
+
+// Grows a treelet from root by opening its largest leaf until it has
+// treelet_leaves leaves, finds the topology of least cost over them by
+// dynamic programming over the subsets, and rewires the treelet's own
+// nodes into it. The leaves' subtrees are kept as they are.
+void binary_tree::restructure(std::uint32_t root) {
+    std::uint32_t inner[treelet_leaves - 1] = {root};
+    std::uint32_t leaves[treelet_leaves] = {nodes[root].child[0], nodes[root].child[1]};
+    int inner_count = 1, leaf_count = 2;
+    while (leaf_count < treelet_leaves) {
+        int widest = -1;
+        for (int l = 0; l < leaf_count; ++l) {
+            if (!(leaves[l] & primitive_bit)
+                && (widest < 0 || box(leaves[l]).half_area() > box(leaves[widest]).half_area())) {
+                widest = l;
+            }
+        }
+        if (widest < 0) break;
+        const std::uint32_t opened = leaves[widest];
+        inner[inner_count++] = opened;
+        leaves[widest] = nodes[opened].child[0];
+        leaves[leaf_count++] = nodes[opened].child[1];
+    }
+    if (leaf_count < 3) return;
+
+    // Cheapest cost of every subset and its split; the split keeps the
+    // lowest leaf on its side so each partition is tried once
+    constexpr int subset_count = 1 << treelet_leaves;
+    aabb subset_box[subset_count];
+    real subset_cost[subset_count];
+    unsigned split[subset_count] = {};
+    const unsigned full = (1u << leaf_count) - 1;
+    for (unsigned s = 1; s <= full; ++s) {
+        const unsigned low = s & (0u - s);
+        if (s == low) {
+            subset_box[s] = box(leaves[lowest_leaf(s)]);
+            subset_cost[s] = cost(leaves[lowest_leaf(s)]);
+            continue;
+        }
+        subset_box[s] = subset_box[s ^ low];
+        subset_box[s].grow(subset_box[low]);
+        real best = std::numeric_limits<real>::infinity();
+        for (unsigned part = (s - 1) & s; part; part = (part - 1) & s) {
+            if (!(part & low)) continue;
+            const real c = subset_cost[part] + subset_cost[s ^ part];
+            if (c < best) {
+                best = c;
+                split[s] = part;
+            }
+        }
+        subset_cost[s] = subset_box[s].half_area() + best;
+    }
+    if (!(subset_cost[full] < nodes[root].cost)) return;
+
+    // Nodes take their subsets top down, so refitting in reverse goes up
+    struct placed { unsigned set; std::uint32_t node; };
+    placed order[treelet_leaves - 1] = {{full, root}};
+    int placed_count = 1;
+    for (int p = 0; p < placed_count; ++p) {
+        const unsigned sides[2] = {split[order[p].set], order[p].set ^ split[order[p].set]};
+        for (int c = 0; c < 2; ++c) {
+            std::uint32_t ref;
+            if ((sides[c] & (sides[c] - 1)) == 0) {
+                ref = leaves[lowest_leaf(sides[c])];
+            } else {
+                ref = inner[placed_count];
+                order[placed_count++] = {sides[c], ref};
+            }
+            nodes[order[p].node].child[c] = ref;
+            set_parent(ref, order[p].node);
+        }
+    }
+    for (int p = placed_count - 1; p >= 0; --p) refit(order[p].node);
+}
+
+// Sorts the primitives by the Morton code of their centroid over the
+// centroid bounds, then emits and fits the tree
+template <typename Code>
+void build_tree(binary_tree& tree, const std::vector<aabb>& boxes, int bits_per_axis, bool restructure,
+                thread_pool& pool) {
+    const std::size_t count = boxes.size(), blocks = block_count(count, pool);
+    std::vector<aabb> block_bounds(blocks, aabb::empty());
+    pool.parallel_for(blocks, [&](std::size_t b) {
+        for (std::size_t i = count * b / blocks; i < count * (b + 1) / blocks; ++i) {
+            block_bounds[b].grow(vec3(boxes[i].centroid(0), boxes[i].centroid(1), boxes[i].centroid(2)));
+        }
+    });
+    aabb centroids = aabb::empty();
+    for (const aabb& bounds : block_bounds) centroids.grow(bounds);
+    const Code cells = Code(1) << bits_per_axis;
+    real scale[3];
+    for (int axis = 0; axis < 3; ++axis) {
+        const real extent = centroids.max[axis] - centroids.min[axis];
+        scale[axis] = extent > 0 ? real(cells) / extent : 0;
+    }
+
+    std::vector<Code> codes(count);
+    tree.sorted.resize(count);
+    pool.parallel_ranges(count, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            Code code = 0;
+            for (int axis = 0; axis < 3; ++axis) {
+                const real q = (boxes[i].centroid(axis) - centroids.min[axis]) * scale[axis];
+                const Code cell = q > 0 ? std::min(static_cast<Code>(q), Code(cells - 1)) : 0;
+                code |= spread_bits(cell) << (2 - axis);
+            }
+            codes[i] = code;
+            tree.sorted[i] = static_cast<std::uint32_t>(i);
+        }
+    });
+    radix_sort(codes, tree.sorted, 3 * bits_per_axis, pool);
+
+    tree.boxes.resize(count);
+    pool.parallel_ranges(count, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t k = begin; k < end; ++k) tree.boxes[k] = boxes[tree.sorted[k]];
+    });
+    tree.emit(codes, pool, [&](std::uint32_t i) {
+        if (restructure && tree.nodes[i].count >= treelet_min_count) tree.restructure(i);
+    });
+}
+
+} // namespace
+
+// The binary tree (one primitive per leaf) is built in parallel, then
+// written out top down as the usual nodes, with subtrees of up to
+// max_leaf_size primitives turned into leaves. Each subtree knows its
+// record and primitive counts, so where it goes is known before it is
+// written and the subtrees below the first levels are written in parallel.
+void bvh::build_lbvh(const std::vector<aabb>& boxes, std::vector<std::uint32_t>& order, thread_pool& pool,
+                     int code_bits, int treelet_rounds, int max_leaf_size) {
+    nodes.clear();
+    qnodes.clear();
+    order.clear();
+    root_bounds = aabb::empty();
+    max_leaf_size = std::max(max_leaf_size, 1);
+    if (boxes.size() <= static_cast<std::size_t>(max_leaf_size)) {
+        build(boxes, order, max_leaf_size);
+        return;
+    }
+
+    binary_tree tree;
+    tree.max_leaf_size = static_cast<std::uint32_t>(max_leaf_size);
+    if (code_bits > 30) {
+        build_tree<std::uint64_t>(tree, boxes, 21, treelet_rounds > 0, pool);
+    } else {
+        build_tree<std::uint32_t>(tree, boxes, 10, treelet_rounds > 0, pool);
+    }
+    for (int round = 1; round < treelet_rounds; ++round) {
+        tree.bottom_up(pool, [&](std::uint32_t i) {
+            tree.refit(i);
+            if (tree.nodes[i].count >= treelet_min_count) tree.restructure(i);
+        });
+    }
+
+    // A subtree's record goes at node, its descendants' from first_child
+    // on (left subtree first) and its primitives from first_primitive on.
+    // Leaves cut at max_depth leave unused records behind them.
+    struct emit_task {
+        std::uint32_t ref, node, first_child, first_primitive;
+        int depth;
+    };
+    auto emit = [&](const emit_task& task, std::vector<emit_task>& tasks, std::vector<std::uint32_t>& below) {
+        node& out = nodes[task.node];
+        const aabb& box = tree.box(task.ref);
+        for (int axis = 0; axis < 3; ++axis) {
+            out.min[axis] = box.min[axis];
+            out.max[axis] = box.max[axis];
+        }
+        if (tree.count(task.ref) <= tree.max_leaf_size || task.depth >= max_depth) {
+            out.index = task.first_primitive;
+            out.count = tree.count(task.ref);
+            std::uint32_t k = task.first_primitive;
+            below.assign(1, task.ref);
+            while (!below.empty()) {
+                const std::uint32_t ref = below.back();
+                below.pop_back();
+                if (ref & primitive_bit) {
+                    order[k++] = tree.sorted[ref & ~primitive_bit];
+                } else {
+                    below.push_back(tree.nodes[ref].child[1]);
+                    below.push_back(tree.nodes[ref].child[0]);
+                }
+            }
+            return;
+        }
+        out.index = task.first_child;
+        out.count = 0;
+        const std::uint32_t left = tree.nodes[task.ref].child[0], right = tree.nodes[task.ref].child[1];
+        tasks.push_back({right, task.first_child + 1, task.first_child + 1 + tree.records(left),
+                         task.first_primitive + tree.count(left), task.depth + 1});
+        tasks.push_back({left, task.first_child, task.first_child + 2, task.first_primitive, task.depth + 1});
+    };
+
+    nodes.resize(tree.records(tree.root));
+    order.resize(boxes.size());
+    std::vector<emit_task> subtrees{{tree.root, 0, 1, 0, 1}}, next_level;
+    std::vector<std::uint32_t> below;
+    while (!subtrees.empty() && subtrees.size() < 8 * static_cast<std::size_t>(pool.size())) {
+        for (const emit_task& task : subtrees) emit(task, next_level, below);
+        subtrees.swap(next_level);
+        next_level.clear();
+    }
+    pool.parallel_for(subtrees.size(), [&](std::size_t t) {
+        std::vector<emit_task> tasks{subtrees[t]};
+        std::vector<std::uint32_t> below;
+        while (!tasks.empty()) {
+            const emit_task task = tasks.back();
+            tasks.pop_back();
+            emit(task, tasks, below);
+        }
+    });
+    root_bounds = tree.box(tree.root);
+}
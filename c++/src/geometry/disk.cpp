@@ -0,0 +1,37 @@
+#include "geometry/disk.hpp"
+#include <algorithm>
+#include <cmath>
+
+disk::disk(const vec3& center, const vec3& normal, real radius, std::shared_ptr<material> mat)
+    : center(center), normal(normal.normalize()), radius(radius) {
+    this->mat = mat;
+}
+
+bool disk::hit(const vec3& ray_origin, const vec3& ray_direction, real t_max, hit_record& rec) const {
+    real denom = normal.dot(ray_direction);
+    if (std::abs(denom) <= epsilon) return false;
+
+    real t = (center - ray_origin).dot(normal) / denom;
+    if (t <= 0 || t >= t_max) return false;
+
+    vec3 point = ray_origin + ray_direction * t;
+    if ((point - center).length_squared() > radius * radius) return false;
+
+    rec.t = t;
+    rec.point = point;
+    rec.normal = normal;
+    rec.mat = mat.get();
+    rec.object_id = object_id;
+    return true;
+}
+
+// Along each axis the disk reaches radius * sqrt(1 - n_axis^2) from its center
+bool disk::bounding_box(aabb& box) const {
+    const vec3 reach(radius * std::sqrt(std::max(real(0), 1 - normal.x * normal.x)),
+                     radius * std::sqrt(std::max(real(0), 1 - normal.y * normal.y)),
+                     radius * std::sqrt(std::max(real(0), 1 - normal.z * normal.z)));
+    box = aabb::empty();
+    box.grow(center - reach);
+    box.grow(center + reach);
+    return true;
+}
@@ -0,0 +1,182 @@
+#include "geometry/grid_accel.hpp"
+#include "core/thread_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace {
+
+// Finer than this per axis and the cell coordinates stop being worth hashing
+constexpr int max_cells_per_axis = 1 << 16;
+
+} // namespace
+
+// Counting sort of the (bucket, object) references, all passes parallel:
+// each object writes its references at its prefix offset, buckets count
+// them with atomics, then each reference moves to its bucket's list. The
+// lists are sorted so the image does not depend on the thread timing.
+grid_accel::grid_accel(std::vector<std::shared_ptr<hittable>> objects, thread_pool& pool, real density) {
+    std::vector<aabb> all_boxes(objects.size());
+    std::vector<char> has_box(objects.size());
+    pool.parallel_ranges(objects.size(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) has_box[i] = objects[i]->bounding_box(all_boxes[i]);
+    });
+    std::vector<aabb> boxes;
+    bounds = aabb::empty();
+    for (std::size_t i = 0; i < objects.size(); ++i) {
+        if (has_box[i]) {
+            boxes.push_back(all_boxes[i]);
+            bounds.grow(all_boxes[i]);
+            bounded.push_back(std::move(objects[i]));
+        } else {
+            unbounded.push_back(std::move(objects[i]));
+        }
+    }
+    if (bounded.empty()) return;
+
+    // Cells of about equal sides; flat scenes get a thickness so the volume is not 0
+    real extent[3];
+    const real largest = std::max({bounds.max[0] - bounds.min[0], bounds.max[1] - bounds.min[1], bounds.max[2] - bounds.min[2]});
+    for (int axis = 0; axis < 3; ++axis) {
+        extent[axis] = std::max(bounds.max[axis] - bounds.min[axis], largest > 0 ? largest * real(1e-3) : real(1));
+    }
+    const real per_unit = std::cbrt(density * real(bounded.size()) / (extent[0] * extent[1] * extent[2]));
+    for (int axis = 0; axis < 3; ++axis) {
+        cells[axis] = std::clamp(static_cast<int>(std::ceil(extent[axis] * per_unit)), 1, max_cells_per_axis);
+        cell_size[axis] = extent[axis] / cells[axis];
+        inv_cell_size[axis] = 1 / cell_size[axis];
+    }
+    auto cell_of = [&](const aabb& box, bool upper, int axis) {
+        const real p = upper ? box.max[axis] : box.min[axis];
+        return std::clamp(static_cast<int>((p - bounds.min[axis]) * inv_cell_size[axis]), 0, cells[axis] - 1);
+    };
+
+    // References per object, then where each object's references start
+    std::vector<std::uint64_t> first_reference(bounded.size() + 1, 0);
+    pool.parallel_ranges(bounded.size(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            std::uint64_t count = 1;
+            for (int axis = 0; axis < 3; ++axis) count *= cell_of(boxes[i], true, axis) - cell_of(boxes[i], false, axis) + 1;
+            first_reference[i + 1] = count;
+        }
+    });
+    for (std::size_t i = 0; i < bounded.size(); ++i) first_reference[i + 1] += first_reference[i];
+    const std::size_t reference_total = first_reference.back();
+
+    std::size_t bucket_count = 1;
+    while (bucket_count < reference_total) bucket_count *= 2;
+    bucket_mask = static_cast<std::uint32_t>(bucket_count - 1);
+
+    std::vector<std::uint32_t> reference_bucket(reference_total), reference_object(reference_total);
+    std::vector<std::atomic<std::uint32_t>> fill(bucket_count);
+    pool.parallel_ranges(bucket_count, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t b = begin; b < end; ++b) fill[b].store(0, std::memory_order_relaxed);
+    });
+    pool.parallel_ranges(bounded.size(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            std::size_t k = first_reference[i];
+            const int x0 = cell_of(boxes[i], false, 0), x1 = cell_of(boxes[i], true, 0);
+            const int y0 = cell_of(boxes[i], false, 1), y1 = cell_of(boxes[i], true, 1);
+            const int z0 = cell_of(boxes[i], false, 2), z1 = cell_of(boxes[i], true, 2);
+            for (int z = z0; z <= z1; ++z) {
+                for (int y = y0; y <= y1; ++y) {
+                    for (int x = x0; x <= x1; ++x, ++k) {
+                        reference_bucket[k] = bucket_of(x, y, z);
+                        reference_object[k] = static_cast<std::uint32_t>(i);
+                        fill[reference_bucket[k]].fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+            }
+        }
+    });
+
+    bucket_start.resize(bucket_count + 1);
+    bucket_start[0] = 0;
+    for (std::size_t b = 0; b < bucket_count; ++b) {
+        bucket_start[b + 1] = bucket_start[b] + fill[b].load(std::memory_order_relaxed);
+        fill[b].store(bucket_start[b], std::memory_order_relaxed);
+    }
+    references.resize(reference_total);
+    pool.parallel_ranges(reference_total, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t k = begin; k < end; ++k) {
+            references[fill[reference_bucket[k]].fetch_add(1, std::memory_order_relaxed)] = reference_object[k];
+        }
+    });
+    pool.parallel_ranges(bucket_count, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t b = begin; b < end; ++b) {
+            std::sort(references.begin() + bucket_start[b], references.begin() + bucket_start[b + 1]);
+        }
+    });
+}
+
+bool grid_accel::bounding_box(aabb& box) const {
+    box = bounds;
+    return unbounded.empty() && !bounded.empty();
+}
+
+bool grid_accel::hit(const vec3& ray_origin, const vec3& ray_direction, real t_max, hit_record& rec) const {
+    real t_closest = t_max;
+    bool found = false;
+
+    // Part of the ray inside the grid (a NaN from 0 * inf keeps the interval)
+    const real o[3] = {ray_origin.x, ray_origin.y, ray_origin.z};
+    const real d[3] = {ray_direction.x, ray_direction.y, ray_direction.z};
+    real t_enter = 0, t_exit = t_max;
+    for (int axis = 0; axis < 3 && !bounded.empty(); ++axis) {
+        const real inv = 1 / d[axis];
+        real near = (bounds.min[axis] - o[axis]) * inv, far = (bounds.max[axis] - o[axis]) * inv;
+        if (near > far) std::swap(near, far);
+        t_enter = near > t_enter ? near : t_enter;
+        t_exit = far < t_exit ? far : t_exit;
+    }
+
+    if (!bounded.empty() && t_enter <= t_exit) {
+        int cell[3], step[3], stop[3];
+        real t_next[3], t_delta[3];
+        for (int axis = 0; axis < 3; ++axis) {
+            const real p = o[axis] + d[axis] * t_enter;
+            cell[axis] = std::clamp(static_cast<int>((p - bounds.min[axis]) * inv_cell_size[axis]), 0, cells[axis] - 1);
+            const real inf = std::numeric_limits<real>::infinity();
+            if (d[axis] > 0) {
+                step[axis] = 1, stop[axis] = cells[axis];
+                t_next[axis] = (bounds.min[axis] + (cell[axis] + 1) * cell_size[axis] - o[axis]) / d[axis];
+                t_delta[axis] = cell_size[axis] / d[axis];
+            } else if (d[axis] < 0) {
+                step[axis] = -1, stop[axis] = -1;
+                t_next[axis] = (bounds.min[axis] + cell[axis] * cell_size[axis] - o[axis]) / d[axis];
+                t_delta[axis] = -cell_size[axis] / d[axis];
+            } else {
+                step[axis] = 0, stop[axis] = -1;
+                t_next[axis] = inf;
+                t_delta[axis] = inf;
+            }
+        }
+
+        for (;;) {
+            const std::uint32_t bucket = bucket_of(cell[0], cell[1], cell[2]);
+            for (std::uint32_t k = bucket_start[bucket]; k < bucket_start[bucket + 1]; ++k) {
+                if (bounded[references[k]]->hit(ray_origin, ray_direction, t_closest, rec)) {
+                    t_closest = rec.t;
+                    found = true;
+                }
+            }
+            // A hit before the ray leaves this cell cannot be beaten by a later
+            // cell; a degenerate ray (zero or NaN direction) steps on no axis
+            const int axis = t_next[0] < t_next[1] ? (t_next[0] < t_next[2] ? 0 : 2) : (t_next[1] < t_next[2] ? 1 : 2);
+            if (step[axis] == 0 || t_closest <= t_next[axis] || t_next[axis] > t_exit) break;
+            cell[axis] += step[axis];
+            if (cell[axis] == stop[axis]) break;
+            t_next[axis] += t_delta[axis];
+        }
+    }
+
+    for (const std::shared_ptr<hittable>& object : unbounded) {
+        if (object->hit(ray_origin, ray_direction, t_closest, rec)) {
+            t_closest = rec.t;
+            found = true;
+        }
+    }
+    return found;
+}
@@ -0,0 +1,49 @@
+#include "geometry/hittable.hpp"
+#include "core/vec3.hpp"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+namespace {
+
+// Integer type with the same width as real, used to step a value by ULPs
+using real_bits = std::conditional_t<sizeof(real) == sizeof(std::int64_t), std::int64_t, std::int32_t>;
+
+// Below this magnitude a coordinate gets an absolute offset instead of a ULP offset
+constexpr real origin_threshold = real(1.0 / 32.0);
+
+// Absolute offset near the origin: 1/65536 in float, scaled by the precision ratio in double
+constexpr real float_scale = real(1.0 / 65536.0)
+    * (std::numeric_limits<real>::epsilon() / std::numeric_limits<float>::epsilon());
+
+// Offset in ULPs applied away from the origin
+constexpr real int_scale = real(256.0);
+
+real offset_coordinate(real p, real n) {
+    if (std::abs(p) < origin_threshold) {
+        return p + float_scale * n;
+    }
+
+    real_bits bits;
+    std::memcpy(&bits, &p, sizeof(p));
+    real_bits ulps = static_cast<real_bits>(int_scale * n);
+    bits += (p < 0) ? -ulps : ulps;
+
+    real result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+} // namespace
+
+vec3 offset_ray_origin(const vec3& hit_point, const vec3& normal, const vec3& direction) {
+    // Offset towards the side the new ray is leaving to
+    vec3 n = (normal.dot(direction) < 0) ? normal * real(-1) : normal;
+    return vec3(
+        offset_coordinate(hit_point.x, n.x),
+        offset_coordinate(hit_point.y, n.y),
+        offset_coordinate(hit_point.z, n.z)
+    );
+}
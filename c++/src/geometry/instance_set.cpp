@@ -0,0 +1,89 @@
+#include "geometry/instance_set.hpp"
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+// Index of item in list, appended if missing. Callers add instances of few
+// distinct geometries and materials, most often the last one again.
+template <typename T>
+std::uint32_t index_of(std::vector<T>& list, const T& item) {
+    if (!list.empty() && list.back() == item) return static_cast<std::uint32_t>(list.size() - 1);
+    auto found = std::find(list.begin(), list.end(), item);
+    if (found != list.end()) return static_cast<std::uint32_t>(found - list.begin());
+    list.push_back(item);
+    return static_cast<std::uint32_t>(list.size() - 1);
+}
+
+} // namespace
+
+void instance_set::add(std::shared_ptr<const hittable> geometry, const affine& world_from_object,
+                       std::shared_ptr<material> material, int id) {
+    instance added;
+    added.object_from_world = world_from_object.inverse();
+    added.world_from_object = world_from_object;
+    added.geometry = index_of(geometries, geometry);
+    added.material = index_of(materials, material);
+    added.id = id;
+    instances.push_back(added);
+}
+
+void instance_set::build() {
+    std::vector<aabb> object_boxes(geometries.size());
+    std::vector<bool> bounded(geometries.size());
+    for (std::size_t g = 0; g < geometries.size(); ++g) bounded[g] = geometries[g]->bounding_box(object_boxes[g]);
+    instances.erase(std::remove_if(instances.begin(), instances.end(),
+                                   [&](const instance& i) { return !bounded[i.geometry]; }),
+                    instances.end());
+
+    std::vector<aabb> boxes(instances.size());
+    for (std::size_t i = 0; i < instances.size(); ++i) {
+        boxes[i] = instances[i].world_from_object.bounds(object_boxes[instances[i].geometry]);
+    }
+    // Small leaves: an instance test is a transform and a whole bottom-level traversal
+    std::vector<std::uint32_t> order;
+    tree.build(boxes, order, 2);
+
+    std::vector<instance> sorted;
+    sorted.reserve(instances.size());
+    for (std::uint32_t i : order) sorted.push_back(instances[i]);
+    instances = std::move(sorted);
+}
+
+std::size_t instance_set::memory_bytes() const {
+    return instances.capacity() * sizeof(instance) + tree.memory_bytes();
+}
+
+bool instance_set::bounding_box(aabb& box) const {
+    box = tree.bounds();
+    return !tree.empty();
+}
+
+bool instance_set::hit(const vec3& ray_origin, const vec3& ray_direction, real t_max, hit_record& rec) const {
+    const vec3 inv_direction(1 / ray_direction.x, 1 / ray_direction.y, 1 / ray_direction.z);
+
+    long closest = -1;
+    hit_record local;
+    tree.traverse(ray_origin, inv_direction, t_max, [&](std::uint32_t first, std::uint32_t count, real& t_limit) {
+        for (std::uint32_t i = first; i < first + count; ++i) {
+            const instance& candidate = instances[i];
+            const vec3 origin = candidate.object_from_world.point(ray_origin);
+            const vec3 direction = candidate.object_from_world.vector(ray_direction);
+            if (geometries[candidate.geometry]->hit(origin, direction, t_limit, local)) {
+                t_limit = local.t;
+                closest = i;
+            }
+        }
+        return false;
+    });
+    if (closest < 0) return false;
+
+    // local holds the closest hit: every later one was closer
+    const instance& found = instances[closest];
+    rec.t = local.t;
+    rec.point = found.world_from_object.point(local.point);
+    rec.normal = found.object_from_world.transpose_vector(local.normal).normalize();
+    rec.mat = materials[found.material] ? materials[found.material].get() : local.mat;
+    rec.object_id = found.id;
+    return true;
+}
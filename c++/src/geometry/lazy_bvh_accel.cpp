@@ -0,0 +1,138 @@
+#include "geometry/lazy_bvh_accel.hpp"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+lazy_bvh_accel::lazy_bvh_accel(std::vector<std::shared_ptr<hittable>> objects, std::uint32_t cluster_size) {
+    std::vector<aabb> boxed_boxes;
+    std::vector<std::shared_ptr<hittable>> boxed;
+    aabb centroids = aabb::empty();
+    for (std::shared_ptr<hittable>& object : objects) {
+        aabb box;
+        if (object->bounding_box(box)) {
+            centroids.grow(vec3(box.centroid(0), box.centroid(1), box.centroid(2)));
+            boxed_boxes.push_back(box);
+            boxed.push_back(std::move(object));
+        } else {
+            unbounded.push_back(std::move(object));
+        }
+    }
+    if (boxed.empty()) return;
+
+    // Cells of about equal sides over the centroids, cluster_size objects
+    // each on average; flat scenes get a thickness so the volume is not 0
+    real extent[3];
+    const real largest = std::max({centroids.max[0] - centroids.min[0], centroids.max[1] - centroids.min[1],
+                                   centroids.max[2] - centroids.min[2]});
+    for (int axis = 0; axis < 3; ++axis) {
+        extent[axis] = std::max(centroids.max[axis] - centroids.min[axis], largest > 0 ? largest * real(1e-3) : real(1));
+    }
+    const real clusters = real(boxed.size()) / real(std::max(cluster_size, 1u));
+    const real per_unit = std::cbrt(clusters / (extent[0] * extent[1] * extent[2]));
+    int cells[3];
+    real scale[3];
+    for (int axis = 0; axis < 3; ++axis) {
+        cells[axis] = std::clamp(static_cast<int>(std::ceil(extent[axis] * per_unit)), 1, 1024);
+        scale[axis] = cells[axis] / extent[axis];
+    }
+    auto cell_of = [&](const aabb& box) {
+        int index = 0;
+        for (int axis = 2; axis >= 0; --axis) {
+            const int c = static_cast<int>((box.centroid(axis) - centroids.min[axis]) * scale[axis]);
+            index = index * cells[axis] + std::clamp(c, 0, cells[axis] - 1);
+        }
+        return index;
+    };
+
+    // Counting sort of the objects by cell
+    std::vector<std::uint32_t> cell(boxed.size());
+    std::vector<std::uint32_t> start(static_cast<std::size_t>(cells[0]) * cells[1] * cells[2] + 1, 0);
+    for (std::size_t i = 0; i < boxed.size(); ++i) {
+        cell[i] = static_cast<std::uint32_t>(cell_of(boxed_boxes[i]));
+        ++start[cell[i] + 1];
+    }
+    for (std::size_t c = 1; c < start.size(); ++c) start[c] += start[c - 1];
+    std::vector<std::uint32_t> fill(start.begin(), start.end() - 1);
+    bounded.resize(boxed.size());
+    boxes.resize(boxed.size());
+    for (std::size_t i = 0; i < boxed.size(); ++i) {
+        const std::uint32_t k = fill[cell[i]]++;
+        bounded[k] = std::move(boxed[i]);
+        boxes[k] = boxed_boxes[i];
+    }
+
+    // Top tree over the non-empty cells
+    std::vector<aabb> cluster_boxes;
+    std::vector<std::uint32_t> firsts, lengths;
+    for (std::size_t c = 0; c + 1 < start.size(); ++c) {
+        if (start[c] == start[c + 1]) continue;
+        aabb box = aabb::empty();
+        for (std::uint32_t i = start[c]; i < start[c + 1]; ++i) box.grow(boxes[i]);
+        cluster_boxes.push_back(box);
+        firsts.push_back(start[c]);
+        lengths.push_back(start[c + 1] - start[c]);
+    }
+    std::vector<std::uint32_t> order;
+    top.build(cluster_boxes, order, 1);
+    for (std::uint32_t c : order) {
+        cluster_first.push_back(firsts[c]);
+        cluster_length.push_back(lengths[c]);
+    }
+    subtrees = std::make_unique<subtree[]>(cluster_first.size());
+}
+
+const lazy_bvh_accel::subtree& lazy_bvh_accel::expand(std::uint32_t cluster) const {
+    subtree& s = subtrees[cluster];
+    if (s.ready.load(std::memory_order_acquire)) return s;
+    std::call_once(s.once, [&] {
+        const std::uint32_t first = cluster_first[cluster];
+        std::vector<aabb> range(boxes.begin() + first, boxes.begin() + first + cluster_length[cluster]);
+        std::vector<std::uint32_t> order;
+        s.tree.build(range, order);
+        s.objects.reserve(order.size());
+        for (std::uint32_t i : order) s.objects.push_back(bounded[first + i].get());
+        built.fetch_add(1, std::memory_order_relaxed);
+        s.ready.store(true, std::memory_order_release);
+    });
+    return s;
+}
+
+std::size_t lazy_bvh_accel::node_memory_bytes() const {
+    std::size_t bytes = top.memory_bytes();
+    for (std::size_t c = 0; c < cluster_first.size(); ++c) bytes += subtrees[c].tree.memory_bytes();
+    return bytes;
+}
+
+bool lazy_bvh_accel::bounding_box(aabb& box) const {
+    box = top.bounds();
+    return unbounded.empty() && !top.empty();
+}
+
+bool lazy_bvh_accel::hit(const vec3& ray_origin, const vec3& ray_direction, real t_max, hit_record& rec) const {
+    const vec3 inv_direction(1 / ray_direction.x, 1 / ray_direction.y, 1 / ray_direction.z);
+    real t_closest = t_max;
+    bool found = false;
+    top.traverse(ray_origin, inv_direction, t_max, [&](std::uint32_t first, std::uint32_t count, real& t_limit) {
+        for (std::uint32_t c = first; c < first + count; ++c) {
+            const subtree& s = expand(c);
+            s.tree.traverse(ray_origin, inv_direction, t_limit,
+                            [&](std::uint32_t leaf_first, std::uint32_t leaf_count, real& t_leaf) {
+                for (std::uint32_t i = leaf_first; i < leaf_first + leaf_count; ++i) {
+                    if (s.objects[i]->hit(ray_origin, ray_direction, t_leaf, rec)) {
+                        t_leaf = t_limit = t_closest = rec.t;
+                        found = true;
+                    }
+                }
+                return false;
+            });
+        }
+        return false;
+    });
+    for (const std::shared_ptr<hittable>& object : unbounded) {
+        if (object->hit(ray_origin, ray_direction, t_closest, rec)) {
+            t_closest = rec.t;
+            found = true;
+        }
+    }
+    return found;
+}
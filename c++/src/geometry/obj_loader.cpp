@@ -0,0 +1,193 @@
+#include "geometry/obj_loader.hpp"
+#include "core/thread_pool.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+// Chunks below this size are not worth a task
+constexpr std::size_t min_chunk_bytes = 1 << 20;
+
+struct chunk {
+    const char* begin = nullptr;
+    const char* end = nullptr;
+    std::size_t vertices = 0;           // Counted by the first pass
+    std::size_t triangles = 0;
+    std::size_t vertex_base = 0;        // Where the second pass writes
+    std::size_t triangle_base = 0;
+    std::string error;
+};
+
+bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+const char* skip_spaces(const char* p, const char* end) {
+    while (p < end && is_space(*p)) ++p;
+    return p;
+}
+
+const char* skip_token(const char* p, const char* end) {
+    while (p < end && !is_space(*p)) ++p;
+    return p;
+}
+
+const char* find_line_end(const char* p, const char* end) {
+    const void* newline = std::memchr(p, '\n', static_cast<std::size_t>(end - p));
+    return newline ? static_cast<const char*>(newline) : end;
+}
+
+// "v" or "f" followed by a space: the only lines that are read
+char line_kind(const char* p, const char* end) {
+    if (end - p >= 2 && (p[0] == 'v' || p[0] == 'f') && is_space(p[1])) return p[0];
+    return 0;
+}
+
+std::string line_error(const char* what, const char* line, const char* end) {
+    return std::string(what) + ": '" + std::string(line, std::min<std::size_t>(end - line, 60)) + "'";
+}
+
+void count_chunk(chunk& c) {
+    for (const char* line = c.begin; line < c.end;) {
+        const char* end = find_line_end(line, c.end);
+        const char* p = skip_spaces(line, end);
+        const char kind = line_kind(p, end);
+        if (kind == 'v') {
+            ++c.vertices;
+        } else if (kind == 'f') {
+            std::size_t corners = 0;
+            for (p = skip_spaces(p + 1, end); p < end; p = skip_spaces(skip_token(p, end), end)) ++corners;
+            if (corners < 3) {
+                c.error = line_error("face with fewer than 3 vertices", line, end);
+                return;
+            }
+            c.triangles += corners - 2;
+        }
+        line = end + 1;
+    }
+}
+
+void parse_chunk(chunk& c, obj_mesh& mesh) {
+    std::size_t vertex = c.vertex_base;
+    std::uint32_t* triangle = mesh.indices.data() + 3 * c.triangle_base;
+    for (const char* line = c.begin; line < c.end;) {
+        const char* end = find_line_end(line, c.end);
+        const char* p = skip_spaces(line, end);
+        const char kind = line_kind(p, end);
+        if (kind == 'v') {
+            p = skip_spaces(p + 1, end);
+            for (int axis = 0; axis < 3; ++axis) {
+                real value;
+                auto parsed = std::from_chars(p, end, value);
+                if (parsed.ec != std::errc()) {
+                    c.error = line_error("bad vertex", line, end);
+                    return;
+                }
+                mesh.positions[3 * vertex + axis] = value;
+                p = skip_spaces(parsed.ptr, end);
+            }
+            ++vertex;
+        } else if (kind == 'f') {
+            // Fan around the first corner; negative indices count back from
+            // the vertices read so far
+            std::uint32_t first = 0, previous = 0;
+            int corner = 0;
+            for (p = skip_spaces(p + 1, end); p < end; p = skip_spaces(skip_token(p, end), end), ++corner) {
+                long long index = 0;
+                auto parsed = std::from_chars(p, end, index);
+                if (parsed.ec != std::errc() || index == 0) {
+                    c.error = line_error("bad face index", line, end);
+                    return;
+                }
+                const long long resolved = index > 0 ? index - 1 : static_cast<long long>(vertex) + index;
+                if (resolved < 0) {
+                    c.error = line_error("face index before the first vertex", line, end);
+                    return;
+                }
+                const std::uint32_t current = static_cast<std::uint32_t>(resolved);
+                if (corner == 0) {
+                    first = current;
+                } else if (corner >= 2) {
+                    triangle[0] = first;
+                    triangle[1] = previous;
+                    triangle[2] = current;
+                    triangle += 3;
+                }
+                previous = current;
+            }
+        }
+        line = end + 1;
+    }
+}
+
+} // namespace
+
+bool load_obj(const std::string& path, obj_mesh& mesh, thread_pool& pool, std::string& error) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        error = "Unable to open " + path;
+        return false;
+    }
+    std::vector<char> text;
+    if (std::fseek(file, 0, SEEK_END) == 0) {
+        long size = std::ftell(file);
+        if (size > 0) text.resize(static_cast<std::size_t>(size));
+        std::fseek(file, 0, SEEK_SET);
+    }
+    const bool read = std::fread(text.data(), 1, text.size(), file) == text.size();
+    std::fclose(file);
+    if (!read) {
+        error = "Unable to read " + path;
+        return false;
+    }
+
+    // Chunks end after a newline, so no line is cut
+    const char* begin = text.data();
+    const char* end = begin + text.size();
+    const std::size_t wanted = std::max<std::size_t>(1, std::min<std::size_t>(4 * pool.size(), text.size() / min_chunk_bytes));
+    std::vector<chunk> chunks;
+    for (const char* start = begin; start < end;) {
+        const char* stop = start + std::max<std::size_t>(1, text.size() / wanted);
+        stop = stop >= end ? end : std::min(end, find_line_end(stop, end) + 1);
+        chunks.emplace_back();
+        chunks.back().begin = start;
+        chunks.back().end = stop;
+        start = stop;
+    }
+
+    pool.parallel_for(chunks.size(), [&](std::size_t i) { count_chunk(chunks[i]); });
+    std::size_t vertices = 0, triangles = 0;
+    for (chunk& c : chunks) {
+        if (!c.error.empty()) {
+            error = path + ": " + c.error;
+            return false;
+        }
+        c.vertex_base = vertices;
+        c.triangle_base = triangles;
+        vertices += c.vertices;
+        triangles += c.triangles;
+    }
+    if (vertices > UINT32_MAX) {
+        error = path + ": more than 2^32 vertices";
+        return false;
+    }
+
+    mesh.positions.assign(3 * vertices, 0);
+    mesh.indices.assign(3 * triangles, 0);
+    pool.parallel_for(chunks.size(), [&](std::size_t i) { parse_chunk(chunks[i], mesh); });
+    for (const chunk& c : chunks) {
+        if (!c.error.empty()) {
+            error = path + ": " + c.error;
+            return false;
+        }
+    }
+    for (std::uint32_t index : mesh.indices) {
+        if (index >= vertices) {
+            error = path + ": face index " + std::to_string(index + 1) + " past the last vertex";
+            return false;
+        }
+    }
+    return true;
+}
@@ -9,16 +9,18 @@ plane::plane(const vec3& anchor, const vec3& normal, std::shared_ptr<material> m
     this->mat = mat;
 }
 
-double plane::hit(const vec3& ray_origin, const vec3& ray_direction) {
-    double denom = this->normal.dot(ray_direction);
-    if (std::abs(denom) > epsilon) {
-        vec3 num = this->anchor - ray_origin;
-        double t = num.dot(this->normal) / denom;
-        return (t >= epsilon) ? t : -1.0;
-    }
-    return -1.0;
-}
+bool plane::hit(const vec3& ray_origin, const vec3& ray_direction, real t_max, hit_record& rec) const {
+    real denom = this->normal.dot(ray_direction);
+    if (std::abs(denom) <= epsilon) return false;
+
+    vec3 num = this->anchor - ray_origin;
+    real t = num.dot(this->normal) / denom;
+    if (t <= 0 || t >= t_max) return false;
 
-vec3 plane::get_normal(const vec3& hit_point) {
-    return this->normal;
+    rec.t = t;
+    rec.point = ray_origin + ray_direction * t;
+    rec.normal = this->normal;
+    rec.mat = this->mat.get();
+    rec.object_id = object_id;
+    return true;
 }
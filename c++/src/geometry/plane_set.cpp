@@ -0,0 +1,33 @@
+#include "geometry/plane_set.hpp"
+#include "core/cpu_dispatch.hpp"
+#include <memory>
+
+void plane_set::add(const vec3& anchor, const vec3& normal, std::shared_ptr<material> material, int id) {
+    vec3 n = normal.normalize();
+    this->anchor_x.push_back(anchor.x);
+    this->anchor_y.push_back(anchor.y);
+    this->anchor_z.push_back(anchor.z);
+    this->normal_x.push_back(n.x);
+    this->normal_y.push_back(n.y);
+    this->normal_z.push_back(n.z);
+    this->materials.push_back(material);
+    this->ids.push_back(id);
+}
+
+bool plane_set::hit(const vec3& ray_origin, const vec3& ray_direction, real t_max, hit_record& rec) const {
+    plane_soa planes = {
+        anchor_x.data(), anchor_y.data(), anchor_z.data(),
+        normal_x.data(), normal_y.data(), normal_z.data(),
+        materials.size()
+    };
+    real t = 0;
+    long index = kernels().hit_planes(planes, ray_origin, ray_direction, t_max, t);
+    if (index < 0) return false;
+
+    rec.t = t;
+    rec.point = ray_origin + ray_direction * t;
+    rec.normal = vec3(normal_x[index], normal_y[index], normal_z[index]);
+    rec.mat = materials[index].get();
+    rec.object_id = ids[index];
+    return true;
+}
@@ -0,0 +1,37 @@
+#include "geometry/quad.hpp"
+#include <cmath>
+
+quad::quad(const vec3& center, const vec3& edge_u, const vec3& edge_v, std::shared_ptr<material> mat)
+    : center(center), edge_u(edge_u), edge_v(edge_v), normal(edge_u.cross(edge_v).normalize()),
+      dual_u(edge_u / edge_u.length_squared()), dual_v(edge_v / edge_v.length_squared()) {
+    this->mat = mat;
+}
+
+bool quad::hit(const vec3& ray_origin, const vec3& ray_direction, real t_max, hit_record& rec) const {
+    real denom = normal.dot(ray_direction);
+    if (std::abs(denom) <= epsilon) return false;
+
+    real t = (center - ray_origin).dot(normal) / denom;
+    if (t <= 0 || t >= t_max) return false;
+
+    vec3 point = ray_origin + ray_direction * t;
+    vec3 local = point - center;
+    if (std::abs(local.dot(dual_u)) > real(0.5) || std::abs(local.dot(dual_v)) > real(0.5)) return false;
+
+    rec.t = t;
+    rec.point = point;
+    rec.normal = normal;
+    rec.mat = mat.get();
+    rec.object_id = object_id;
+    return true;
+}
+
+bool quad::bounding_box(aabb& box) const {
+    const vec3 half_u = edge_u * real(0.5), half_v = edge_v * real(0.5);
+    box = aabb::empty();
+    box.grow(center - half_u - half_v);
+    box.grow(center - half_u + half_v);
+    box.grow(center + half_u - half_v);
+    box.grow(center + half_u + half_v);
+    return true;
+}
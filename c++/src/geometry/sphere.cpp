@@ -5,31 +5,55 @@
 #include <algorithm>
 #include <memory>
 
-sphere::sphere(vec3 origin, double radius, std::shared_ptr<material> material) 
+sphere::sphere(vec3 origin, real radius, std::shared_ptr<material> material) 
     : origin(origin), radius(radius) {
     this->mat = material;
 }
 
-vec3 sphere::get_normal(const vec3& hit_point) {
-    return (hit_point - this->origin).normalize();
-}
-
-double sphere::hit(const vec3& ray_origin, const vec3& ray_direction) {
+bool sphere::hit(const vec3& ray_origin, const vec3& ray_direction, real t_max, hit_record& rec) const {
     vec3 oc = ray_origin - this->origin;
-    double a = ray_direction.dot(ray_direction);
-    double b = 2.0 * oc.dot(ray_direction);
-    double c = oc.dot(oc) - this->radius * this->radius;
-    double delta = b * b - 4.0 * a * c;
-    
-    if (delta < 0.0) return -1.0;
-    
-    double t1 = (-b - std::sqrt(delta)) / (2.0 * a);
-    double t2 = (-b + std::sqrt(delta)) / (2.0 * a);
+    real a = ray_direction.dot(ray_direction);
+    real half_b = oc.dot(ray_direction);
+    real c = oc.dot(oc) - this->radius * this->radius;
+
+    // Discriminant from the distance between the center and the ray
+    // (Ray Tracing Gems ch. 7): avoids the cancellation in b² - 4ac,
+    // which matters in float for spheres far from the camera.
+    vec3 l = oc - ray_direction * (half_b / a);
+    real delta = a * (this->radius * this->radius - l.length_squared());
     
-    if (t1 > epsilon) {
-        return (t2 > epsilon) ? std::min(t1, t2) : t1;
-    } else if (t2 > epsilon) {
-        return t2;
-    }
-    return -1.0;
+    if (delta < 0) return false;
+
+    // Stable roots: never subtract two nearly equal values
+    real q = -(half_b + std::copysign(std::sqrt(delta), half_b));
+    real t1 = c / q;
+    real t2 = q / a;
+    if (t1 > t2) std::swap(t1, t2);
+
+    real t = (t1 > 0) ? t1 : t2;
+    if (t <= 0 || t >= t_max) return false;
+
+    fill_record(this->origin, this->radius, this->mat.get(), ray_origin, ray_direction, t, rec);
+    rec.object_id = object_id;
+    return true;
+}
+
+bool sphere::bounding_box(aabb& box) const {
+    box = aabb::empty();
+    box.grow(origin - vec3(radius, radius, radius));
+    box.grow(origin + vec3(radius, radius, radius));
+    return true;
+}
+
+void sphere::fill_record(const vec3& center, real radius, const material* mat,
+                         const vec3& ray_origin, const vec3& ray_direction, real t, hit_record& rec) {
+    // Re-project the hit point onto the surface so its error stays within
+    // a few ULPs, which is what offset_ray_origin() is calibrated for
+    vec3 p = ray_origin + ray_direction * t;
+    vec3 n = (p - center).normalize();
+
+    rec.t = t;
+    rec.point = center + n * radius;
+    rec.normal = n;
+    rec.mat = mat;
 }
@@ -0,0 +1,86 @@
+#include "geometry/sphere_set.hpp"
+#include "geometry/sphere.hpp"
+#include "core/cpu_dispatch.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+
+void sphere_set::add(const vec3& center, real radius, std::shared_ptr<material> material, int id) {
+    if (this->radius.size() % block_size == 0) {
+        block_min_x.push_back(center.x - radius);
+        block_min_y.push_back(center.y - radius);
+        block_min_z.push_back(center.z - radius);
+        block_max_x.push_back(center.x + radius);
+        block_max_y.push_back(center.y + radius);
+        block_max_z.push_back(center.z + radius);
+    } else {
+        block_min_x.back() = std::min(block_min_x.back(), center.x - radius);
+        block_min_y.back() = std::min(block_min_y.back(), center.y - radius);
+        block_min_z.back() = std::min(block_min_z.back(), center.z - radius);
+        block_max_x.back() = std::max(block_max_x.back(), center.x + radius);
+        block_max_y.back() = std::max(block_max_y.back(), center.y + radius);
+        block_max_z.back() = std::max(block_max_z.back(), center.z + radius);
+    }
+
+    this->center_x.push_back(center.x);
+    this->center_y.push_back(center.y);
+    this->center_z.push_back(center.z);
+    this->radius.push_back(radius);
+    this->materials.push_back(material);
+    this->ids.push_back(id);
+}
+
+bool sphere_set::bounding_box(aabb& box) const {
+    box = aabb::empty();
+    for (std::size_t b = 0; b < block_min_x.size(); ++b) {
+        box.grow(vec3(block_min_x[b], block_min_y[b], block_min_z[b]));
+        box.grow(vec3(block_max_x[b], block_max_y[b], block_max_z[b]));
+    }
+    return !block_min_x.empty();
+}
+
+bool sphere_set::hit(const vec3& ray_origin, const vec3& ray_direction, real t_max, hit_record& rec) const {
+    const kernel_table& k = kernels();
+    const std::size_t block_count = block_min_x.size();
+
+    vec3 inv_direction(1 / ray_direction.x, 1 / ray_direction.y, 1 / ray_direction.z);
+    real t_closest = t_max;
+    long closest = -1;
+
+    // Cull whole blocks first, a chunk of block boxes at a time (no allocation per ray)
+    constexpr std::size_t chunk = 256;
+    std::uint8_t block_hit[chunk];
+
+    for (std::size_t chunk_first = 0; chunk_first < block_count; chunk_first += chunk) {
+        std::size_t chunk_count = std::min(chunk, block_count - chunk_first);
+        aabb_soa boxes = {
+            block_min_x.data() + chunk_first, block_min_y.data() + chunk_first, block_min_z.data() + chunk_first,
+            block_max_x.data() + chunk_first, block_max_y.data() + chunk_first, block_max_z.data() + chunk_first,
+            chunk_count
+        };
+        if (k.hit_aabbs(boxes, ray_origin, inv_direction, t_closest, block_hit) == 0) continue;
+
+        for (std::size_t i = 0; i < chunk_count; ++i) {
+            if (!block_hit[i]) continue;
+
+            std::size_t first = (chunk_first + i) * block_size;
+            std::size_t count = std::min(block_size, radius.size() - first);
+            sphere_soa spheres = {
+                center_x.data() + first, center_y.data() + first, center_z.data() + first,
+                radius.data() + first, count
+            };
+            real t = 0;
+            long index = k.hit_spheres(spheres, ray_origin, ray_direction, t_closest, t);
+            if (index >= 0) {
+                t_closest = t;
+                closest = static_cast<long>(first) + index;
+            }
+        }
+    }
+    if (closest < 0) return false;
+
+    vec3 center(center_x[closest], center_y[closest], center_z[closest]);
+    sphere::fill_record(center, radius[closest], materials[closest].get(), ray_origin, ray_direction, t_closest, rec);
+    rec.object_id = ids[closest];
+    return true;
+}
@@ -0,0 +1,128 @@
+#include "geometry/triangle_mesh.hpp"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace {
+
+// Per-ray part of the watertight test: the axis the ray is most aligned
+// with becomes z, and the shear that maps the ray onto that axis
+struct ray_shear {
+    int kx, ky, kz;
+    real sx, sy, sz;
+};
+
+ray_shear make_shear(const vec3& direction) {
+    const real d[3] = {direction.x, direction.y, direction.z};
+    const real ax = std::abs(d[0]), ay = std::abs(d[1]), az = std::abs(d[2]);
+    ray_shear s;
+    s.kz = ax > ay ? (ax > az ? 0 : 2) : (ay > az ? 1 : 2);
+    s.kx = (s.kz + 1) % 3;
+    s.ky = (s.kx + 1) % 3;
+    if (d[s.kz] < 0) std::swap(s.kx, s.ky);     // Keeps the winding
+    s.sx = d[s.kx] / d[s.kz];
+    s.sy = d[s.ky] / d[s.kz];
+    s.sz = real(1) / d[s.kz];
+    return s;
+}
+
+// a, b, c: vertices relative to the ray origin. On a hit with 0 < t < t_max,
+// t and the barycentric weights of a, b and c.
+bool intersect(const vec3& a, const vec3& b, const vec3& c, const ray_shear& s, real t_max,
+               real& t, real& u, real& v, real& w) {
+    const real pa[3] = {a.x, a.y, a.z}, pb[3] = {b.x, b.y, b.z}, pc[3] = {c.x, c.y, c.z};
+    const real ax = pa[s.kx] - s.sx * pa[s.kz], ay = pa[s.ky] - s.sy * pa[s.kz];
+    const real bx = pb[s.kx] - s.sx * pb[s.kz], by = pb[s.ky] - s.sy * pb[s.kz];
+    const real cx = pc[s.kx] - s.sx * pc[s.kz], cy = pc[s.ky] - s.sy * pc[s.kz];
+
+    real eu = cx * by - cy * bx;
+    real ev = ax * cy - ay * cx;
+    real ew = bx * ay - by * ax;
+    // On an edge in float: decide it in double so both triangles agree
+    if (sizeof(real) < sizeof(double) && (eu == 0 || ev == 0 || ew == 0)) {
+        eu = real(double(cx) * double(by) - double(cy) * double(bx));
+        ev = real(double(ax) * double(cy) - double(ay) * double(cx));
+        ew = real(double(bx) * double(ay) - double(by) * double(ax));
+    }
+    if ((eu < 0 || ev < 0 || ew < 0) && (eu > 0 || ev > 0 || ew > 0)) return false;
+    const real det = eu + ev + ew;
+    if (det == 0) return false;
+
+    // Distance scaled by det, compared without dividing
+    const real az = s.sz * pa[s.kz], bz = s.sz * pb[s.kz], cz = s.sz * pc[s.kz];
+    const real scaled_t = eu * az + ev * bz + ew * cz;
+    if (det > 0 ? (scaled_t <= 0 || scaled_t >= t_max * det) : (scaled_t >= 0 || scaled_t <= t_max * det)) return false;
+
+    const real inv_det = real(1) / det;
+    t = scaled_t * inv_det;
+    u = eu * inv_det;
+    v = ev * inv_det;
+    w = ew * inv_det;
+    return true;
+}
+
+} // namespace
+
+triangle_mesh::triangle_mesh(std::vector<real> positions, std::vector<std::uint32_t> indices,
+                             std::shared_ptr<material> material, int id)
+    : positions(std::move(positions)), indices(std::move(indices)) {
+    this->mat = material;
+    this->object_id = id;
+
+    const std::size_t count = triangle_count();
+    std::vector<aabb> boxes(count, aabb::empty());
+    for (std::size_t i = 0; i < count; ++i) {
+        for (int corner = 0; corner < 3; ++corner) boxes[i].grow(vertex(this->indices[3 * i + corner]));
+    }
+    std::vector<std::uint32_t> order;
+    tree.build(boxes, order);
+
+    // Triangles in leaf order
+    std::vector<std::uint32_t> sorted(this->indices.size());
+    for (std::size_t i = 0; i < count; ++i) {
+        std::copy_n(this->indices.begin() + 3 * order[i], 3, sorted.begin() + 3 * i);
+    }
+    this->indices = std::move(sorted);
+}
+
+bool triangle_mesh::bounding_box(aabb& box) const {
+    box = tree.bounds();
+    return !tree.empty();
+}
+
+std::size_t triangle_mesh::memory_bytes() const {
+    return positions.capacity() * sizeof(real) + indices.capacity() * sizeof(std::uint32_t) + tree.memory_bytes();
+}
+
+bool triangle_mesh::hit(const vec3& ray_origin, const vec3& ray_direction, real t_max, hit_record& rec) const {
+    const ray_shear shear = make_shear(ray_direction);
+    const vec3 inv_direction(1 / ray_direction.x, 1 / ray_direction.y, 1 / ray_direction.z);
+
+    long closest = -1;
+    real t_closest = t_max, u = 0, v = 0, w = 0;
+    tree.traverse(ray_origin, inv_direction, t_max, [&](std::uint32_t first, std::uint32_t count, real& t_limit) {
+        for (std::uint32_t i = first; i < first + count; ++i) {
+            const std::uint32_t* corner = &indices[3 * i];
+            real t, bu, bv, bw;
+            if (intersect(vertex(corner[0]) - ray_origin, vertex(corner[1]) - ray_origin, vertex(corner[2]) - ray_origin,
+                          shear, t_limit, t, bu, bv, bw)) {
+                t_limit = t_closest = t;
+                u = bu, v = bv, w = bw;
+                closest = i;
+            }
+        }
+        return false;
+    });
+    if (closest < 0) return false;
+
+    // The point from the barycentric weights is within a few ULPs of the
+    // plane, which offset_ray_origin() expects
+    const std::uint32_t* corner = &indices[3 * closest];
+    const vec3 a = vertex(corner[0]), b = vertex(corner[1]), c = vertex(corner[2]);
+    rec.t = t_closest;
+    rec.point = a * u + b * v + c * w;
+    rec.normal = (b - a).cross(c - a).normalize();
+    rec.mat = mat.get();
+    rec.object_id = object_id;
+    return true;
+}